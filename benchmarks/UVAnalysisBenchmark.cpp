@@ -0,0 +1,139 @@
+#include "assets/UVAnalyzer.hpp"
+#include "core/ThreadPool.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+
+using namespace VulkanViewer;
+
+namespace {
+
+// Jittered grid with one UV island per mesh, so the scores look like a real unwrap. V grows with +Y
+// while the imported convention has V pointing down the image, so seen from the +Z normals the
+// texture is mirrored and flipping V has to win.
+Mesh makeGridMesh(uint32_t size, uint32_t seed) {
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> jitter(-0.002f, 0.002f);
+
+    Mesh mesh;
+    mesh.vertices.reserve(static_cast<size_t>(size) * size);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            Vertex vertex{};
+            vertex.pos = glm::vec3(x * 0.01f, y * 0.01f, jitter(random));
+            vertex.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+            vertex.texCoord = glm::vec2(static_cast<float>(x) / size + jitter(random),
+                                        static_cast<float>(y) / size + jitter(random));
+            mesh.vertices.push_back(vertex);
+        }
+    }
+    mesh.indices.reserve(static_cast<size_t>(size - 1) * (size - 1) * 6);
+    for (uint32_t y = 0; y + 1 < size; y++) {
+        for (uint32_t x = 0; x + 1 < size; x++) {
+            uint32_t corner = y * size + x;
+            mesh.indices.insert(mesh.indices.end(), {corner, corner + 1, corner + size,
+                                                     corner + 1, corner + size + 1, corner + size});
+        }
+    }
+    return mesh;
+}
+
+// The kernels only differ in summation order, so every score of every variant has to agree
+bool scoresMatch(const UVAnalysis& a, const UVAnalysis& b, const char* label) {
+    constexpr float TOLERANCE = 1.0e-4f;
+    bool match = true;
+    for (int variant = 0; variant < UVStatistics::VARIANT_COUNT; variant++) {
+        const UVVariantScore& x = a.variants[variant];
+        const UVVariantScore& y = b.variants[variant];
+        const float pairs[][2] = {{x.coherence, y.coherence}, {x.clustering, y.clustering}, {x.geometry, y.geometry},
+                                  {x.coverage, y.coverage},   {x.scrambling, y.scrambling}, {x.handedness, y.handedness},
+                                  {x.total, y.total}};
+        for (const auto& pair : pairs) {
+            if (std::abs(pair[0] - pair[1]) > TOLERANCE) {
+                std::cerr << label << ": variant " << variant << " scores " << pair[0] << " and " << pair[1] << std::endl;
+                match = false;
+            }
+        }
+    }
+    return match;
+}
+
+// Best of several runs, in triangles per second
+double measure(uint64_t triangles, int runs, const std::function<void()>& body) {
+    double bestSeconds = 0.0;
+    for (int run = 0; run < runs; run++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        body();
+        double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+        if (run == 0 || seconds < bestSeconds) {
+            bestSeconds = seconds;
+        }
+    }
+    return bestSeconds > 0.0 ? triangles / bestSeconds : 0.0;
+}
+
+}
+
+// Usage: UVAnalysisBenchmark [grid size per mesh] [mesh count] [runs]
+int main(int argc, char** argv) {
+    uint32_t gridSize = argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 1024;
+    uint32_t meshCount = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 8;
+    int runs = argc > 3 ? std::atoi(argv[3]) : 5;
+    if (gridSize < 2 || meshCount == 0 || runs <= 0) {
+        std::cerr << "Usage: UVAnalysisBenchmark [grid size >= 2] [mesh count >= 1] [runs >= 1]" << std::endl;
+        return 1;
+    }
+
+    std::vector<Mesh> meshes;
+    std::vector<const Mesh*> meshPointers;
+    uint64_t triangles = 0;
+    for (uint32_t i = 0; i < meshCount; i++) {
+        meshes.push_back(makeGridMesh(gridSize, i + 1));
+    }
+    for (const auto& mesh : meshes) {
+        meshPointers.push_back(&mesh);
+        triangles += mesh.indices.size() / 3;
+    }
+    std::cout << meshCount << " meshes, " << triangles << " triangles, "
+              << ThreadPool::get().getThreadCount() << " pool threads" << std::endl;
+
+    auto singleThreaded = [&](bool simd) {
+        UVStatistics stats;
+        for (const auto& mesh : meshes) {
+            UVAnalyzer::accumulateTriangles(mesh, 0, mesh.indices.size() / 3, stats, simd);
+            UVAnalyzer::accumulateVertices(mesh, 0, mesh.vertices.size(), stats);
+        }
+        return UVAnalyzer::score(stats);
+    };
+
+    UVAnalysis scalarResult;
+    UVAnalysis simdResult;
+    UVAnalysis parallelResult;
+    double scalar = measure(triangles, runs, [&]() { scalarResult = singleThreaded(false); });
+    double simd = measure(triangles, runs, [&]() { simdResult = singleThreaded(true); });
+    double parallel = measure(triangles, runs, [&]() { parallelResult = UVAnalyzer::analyze(meshPointers); });
+
+    std::cout << "Scalar, 1 thread:   " << scalar / 1.0e6 << " M triangles/s" << std::endl;
+    std::cout << "SIMD, 1 thread:     " << simd / 1.0e6 << " M triangles/s" << std::endl;
+    std::cout << "SIMD, thread pool:  " << parallel / 1.0e6 << " M triangles/s" << std::endl;
+
+    if (!scoresMatch(scalarResult, simdResult, "Scalar vs SIMD") ||
+        !scoresMatch(simdResult, parallelResult, "SIMD vs thread pool")) {
+        return 1;
+    }
+    for (int variant = 0; variant < UVStatistics::VARIANT_COUNT; variant++) {
+        const UVVariantScore& score = parallelResult.variants[variant];
+        std::cout << "Variant " << variant << ": total " << score.total << ", handedness " << score.handedness << std::endl;
+    }
+    if (parallelResult.bestVariant != 1) {
+        std::cerr << "Expected the V flip to win on the mirrored grid, got variant " << parallelResult.bestVariant << std::endl;
+        return 1;
+    }
+    std::cout << "Best variant " << parallelResult.bestVariant << ", score "
+              << parallelResult.variants[parallelResult.bestVariant].total << std::endl;
+    return 0;
+}
@@ -7,6 +7,11 @@ layout(binding = 0) uniform UniformBufferObject {
 
 layout(push_constant) uniform PushConstants {
     mat4 model;
+    vec3 quantScale;
+    vec3 quantOffset;
+    // 1 when U and V are swapped before uvTransform
+    float uvSwap;
+    vec4 uvTransform;
 } push;
 
 layout(location = 0) in vec3 inPosition;
@@ -23,5 +28,6 @@ void main() {
     
     fragWorldPos = worldPos.xyz;
     fragNormal = mat3(transpose(inverse(push.model))) * inNormal;
-    fragTexCoord = inTexCoord;
+    vec2 texCoord = push.uvSwap > 0.5 ? inTexCoord.yx : inTexCoord;
+    fragTexCoord = texCoord * push.uvTransform.xy + push.uvTransform.zw;
 }
\ No newline at end of file
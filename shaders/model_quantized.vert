@@ -0,0 +1,43 @@
+#version 450
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout(push_constant) uniform PushConstants {
+    mat4 model;
+    vec3 quantScale;
+    vec3 quantOffset;
+    // 1 when U and V are swapped before uvTransform
+    float uvSwap;
+    vec4 uvTransform;
+} push;
+
+// QuantizedVertex: 16-bit position relative to the mesh bounds, octahedral normal, half-float UV
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+layout(location = 2) in vec2 inTexCoord;
+
+layout(location = 0) out vec3 fragNormal;
+layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) out vec3 fragWorldPos;
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+void main() {
+    vec3 position = push.quantOffset + inPosition.xyz * push.quantScale;
+    vec4 worldPos = push.model * vec4(position, 1.0);
+    gl_Position = ubo.proj * ubo.view * worldPos;
+    
+    fragWorldPos = worldPos.xyz;
+    fragNormal = mat3(transpose(inverse(push.model))) * decodeOctahedral(inNormal);
+    vec2 texCoord = push.uvSwap > 0.5 ? inTexCoord.yx : inTexCoord;
+    fragTexCoord = texCoord * push.uvTransform.xy + push.uvTransform.zw;
+}
@@ -0,0 +1,131 @@
+#include "ImportJobs.hpp"
+#include "../core/ThreadPool.hpp"
+#include "../core/VulkanDevice.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <iostream>
+
+namespace VulkanViewer {
+
+ImportJobQueue::ImportJobQueue(VulkanDevice& device) : m_device(device) {
+}
+
+ImportJobQueue::~ImportJobQueue() {
+    for (auto& job : m_jobs) {
+        job->progress.cancel = true;
+    }
+    for (auto& job : m_jobs) {
+        if (job->worker.valid()) {
+            job->worker.wait();
+        }
+    }
+
+
+    // Whatever was still waiting for the GPU may already own part of its geometry
+    m_finished.exchange(nullptr, std::memory_order_acquire);
+    for (auto& job : m_jobs) {
+        if (job->model) {
+            job->model->cleanup(m_device);
+        }
+    }
+}
+
+void ImportJobQueue::submit(const std::string& filepath, const ImportOptions& options) {
+    auto job = std::make_shared<ImportJob>();
+    job->filepath = filepath;
+    size_t lastSlash = filepath.find_last_of("/\\");
+    job->name = lastSlash == std::string::npos ? filepath : filepath.substr(lastSlash + 1);
+    m_jobs.push_back(job);
+
+    // A dedicated transfer queue cannot blit, so mips are built next to the decode instead
+    ImportOptions jobOptions = options;
+    jobOptions.mipmapsOnCPU = options.mipmapsOnCPU || m_device.hasDedicatedTransferQueue();
+
+    job->worker = ThreadPool::get().submit([this, job, jobOptions]() {
+        auto model = std::make_unique<Model>();
+        bool loaded = false;
+        try {
+            loaded = model->importFromFile(job->filepath, jobOptions, &job->progress);
+        } catch (const std::exception& error) {
+            std::cerr << "Import of " << job->filepath << " failed: " << error.what() << std::endl;
+        }
+
+        if (loaded) {
+            job->model = std::move(model);
+            job->progress.stage = "Waiting for upload";
+            job->state = ImportState::Uploading;
+        } else {
+            job->state = job->progress.cancel ? ImportState::Cancelled : ImportState::Failed;
+        }
+        publish(job.get());
+    });
+    std::cout << "Queued import: " << filepath << std::endl;
+}
+
+void ImportJobQueue::publish(ImportJob* job) {
+    job->nextFinished = m_finished.load(std::memory_order_relaxed);
+    while (!m_finished.compare_exchange_weak(job->nextFinished, job, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+    }
+}
+
+void ImportJobQueue::update(const std::function<void(std::unique_ptr<Model>)>& onReady) {
+
+    // The stack comes out newest first; reverse it so uploads start in completion order
+    ImportJob* finished = m_finished.exchange(nullptr, std::memory_order_acquire);
+    std::vector<ImportJob*> arrived;
+    for (ImportJob* job = finished; job; job = job->nextFinished) {
+        arrived.push_back(job);
+    }
+    for (auto it = arrived.rbegin(); it != arrived.rend(); ++it) {
+        ImportJob* job = *it;
+        if (job->worker.valid()) {
+            job->worker.get();
+        }
+        if (job->state == ImportState::Uploading) {
+            m_uploads.push_back(job);
+        } else {
+            retire(job, job->state);
+        }
+    }
+
+
+    // One model at a time, so a large import cannot take more than the budget out of any frame
+    if (!m_uploads.empty()) {
+        ImportJob* job = m_uploads.front();
+        if (job->progress.cancel) {
+            job->model->cleanup(m_device);
+            job->model.reset();
+            m_uploads.pop_front();
+            retire(job, ImportState::Cancelled);
+        } else {
+            job->progress.stage = "Uploading to GPU";
+            if (job->model->uploadPending(m_device, UPLOAD_BYTES_PER_FRAME)) {
+                onReady(std::move(job->model));
+                m_uploads.pop_front();
+                retire(job, ImportState::Done);
+            }
+        }
+    }
+}
+
+void ImportJobQueue::retire(ImportJob* job, ImportState state) {
+    job->state = state;
+    switch (state) {
+    case ImportState::Done:
+        std::cout << "Successfully loaded model to asset browser: " << job->filepath << std::endl;
+        break;
+    case ImportState::Cancelled:
+        std::cout << "Import cancelled: " << job->filepath << std::endl;
+        break;
+    default:
+        std::cerr << "Failed to load model: " << job->filepath << std::endl;
+        break;
+    }
+    m_jobs.erase(std::remove_if(m_jobs.begin(), m_jobs.end(),
+                                [job](const std::shared_ptr<ImportJob>& entry) { return entry.get() == job; }),
+                 m_jobs.end());
+}
+
+}
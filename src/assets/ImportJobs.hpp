@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../scene/Model.hpp"
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace VulkanViewer {
+
+class VulkanDevice;
+
+enum class ImportState {
+    Importing,
+    Uploading,
+    Done,
+    Failed,
+    Cancelled
+};
+
+struct ImportJob {
+    std::string filepath;
+    std::string name;
+    ImportProgress progress;
+    std::atomic<ImportState> state{ImportState::Importing};
+
+    // Owned by the worker until the job is published, then by the render thread
+    std::unique_ptr<Model> model;
+    std::future<void> worker;
+    ImportJob* nextFinished = nullptr;
+};
+
+// Imports models on the thread pool so the window keeps drawing. Workers publish finished
+// CPU-side models on a lock-free list; update() collects them on the render thread and
+// uploads them a slice per frame before handing each one over.
+class ImportJobQueue {
+public:
+    static constexpr VkDeviceSize UPLOAD_BYTES_PER_FRAME = 32ull * 1024 * 1024;
+
+    explicit ImportJobQueue(VulkanDevice& device);
+    ~ImportJobQueue();
+
+    ImportJobQueue(const ImportJobQueue&) = delete;
+    ImportJobQueue& operator=(const ImportJobQueue&) = delete;
+
+    void submit(const std::string& filepath, const ImportOptions& options = ImportOptions());
+    void cancel(ImportJob& job) { job.progress.cancel = true; }
+
+    // Call once per frame on the render thread while no command buffer is being recorded
+    void update(const std::function<void(std::unique_ptr<Model>)>& onReady);
+
+    const std::vector<std::shared_ptr<ImportJob>>& getJobs() const { return m_jobs; }
+
+private:
+    void publish(ImportJob* job);
+    void retire(ImportJob* job, ImportState state);
+
+    VulkanDevice& m_device;
+    std::vector<std::shared_ptr<ImportJob>> m_jobs;
+    std::deque<ImportJob*> m_uploads;
+
+    // Intrusive stack of jobs whose worker is done; pushed by workers, drained by update()
+    std::atomic<ImportJob*> m_finished{nullptr};
+};
+
+}
@@ -0,0 +1,538 @@
+#include "MeshCache.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+namespace fs = std::filesystem;
+
+namespace VulkanViewer {
+
+namespace {
+
+constexpr char CACHE_MAGIC[8] = {'V', 'V', 'M', 'E', 'S', 'H', 'C', '\0'};
+constexpr uint64_t BLOB_ALIGNMENT = 16;
+constexpr const char* CACHE_EXTENSION = ".vvmesh";
+
+struct FileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexStride;
+    uint64_t sourceSize;
+    int64_t sourceMtime;
+    uint64_t settingsHash;
+    uint32_t meshCount;
+    uint32_t materialCount;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint32_t sourcePathString;
+    uint32_t instanceCount;
+    uint64_t meshTableOffset;
+    uint64_t materialTableOffset;
+    uint64_t instanceTableOffset;
+    uint64_t stringTableOffset;
+    uint64_t stringTableSize;
+    uint64_t fileSize;
+};
+
+struct MeshRecord {
+    uint64_t vertexOffset;
+    uint64_t vertexCount;
+    uint64_t indexOffset;
+    uint64_t indexCount;
+    uint32_t materialIndex;
+    uint32_t lodCount;
+    uint64_t sourceVertexCount;
+    uint64_t lodTableOffset;
+    uint64_t lodIndexOffset;
+    uint64_t lodIndexCount;
+    uint64_t meshletOffset;
+    uint64_t meshletCount;
+};
+
+struct MaterialRecord {
+    float ambient[3];
+    float diffuse[3];
+    float specular[3];
+    float shininess;
+    uint32_t nameString;
+    uint32_t diffuseTextureString;
+    uint32_t normalTextureString;
+    uint32_t specularTextureString;
+};
+
+struct InstanceRecord {
+    uint32_t meshIndex;
+    uint32_t reserved;
+    float transform[16];
+};
+
+static_assert(sizeof(Vertex) == 32, "mesh cache layout assumes a tightly packed 32-byte Vertex");
+static_assert(sizeof(MeshLod) == 12, "mesh cache layout assumes a tightly packed 12-byte MeshLod");
+static_assert(sizeof(Meshlet) == 40, "mesh cache layout assumes a tightly packed 40-byte Meshlet");
+
+uint64_t alignUp(uint64_t value, uint64_t alignment) {
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+class StringTable {
+public:
+    uint32_t add(const std::string& value) {
+        uint32_t offset = static_cast<uint32_t>(m_data.size());
+        uint32_t length = static_cast<uint32_t>(value.size());
+        m_data.append(reinterpret_cast<const char*>(&length), sizeof(length));
+        m_data.append(value);
+        return offset;
+    }
+
+    const std::string& data() const { return m_data; }
+
+private:
+    std::string m_data;
+};
+
+bool readString(const uint8_t* table, uint64_t tableSize, uint32_t offset, std::string& out) {
+    uint32_t length;
+    if (offset > tableSize || tableSize - offset < sizeof(length)) {
+        return false;
+    }
+    memcpy(&length, table + offset, sizeof(length));
+    if (tableSize - offset - sizeof(length) < length) {
+        return false;
+    }
+    out.assign(reinterpret_cast<const char*>(table + offset + sizeof(length)), length);
+    return true;
+}
+
+void writePadding(std::ofstream& file, uint64_t& position, uint64_t target) {
+    static const char zeros[BLOB_ALIGNMENT] = {};
+    while (position < target) {
+        uint64_t count = std::min<uint64_t>(target - position, BLOB_ALIGNMENT);
+        file.write(zeros, static_cast<std::streamsize>(count));
+        position += count;
+    }
+}
+
+}
+
+MeshCache& MeshCache::get() {
+    static MeshCache cache;
+    return cache;
+}
+
+MeshCache::MeshCache() : m_directory("cache/meshes") {
+}
+
+void MeshCache::setDirectory(const std::string& directory) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_directory = directory;
+}
+
+bool MeshCache::querySource(const std::string& sourcePath, SourceKey& key) const {
+    std::error_code error;
+    fs::path path = fs::absolute(fs::path(sourcePath), error).lexically_normal();
+    if (error) {
+        return false;
+    }
+
+    key.path = path.generic_string();
+    key.size = fs::file_size(path, error);
+    if (error) {
+        return false;
+    }
+    key.mtime = static_cast<int64_t>(fs::last_write_time(path, error).time_since_epoch().count());
+    return !error;
+}
+
+std::string MeshCache::cacheFileFor(const SourceKey& key, uint64_t settingsHash) const {
+    uint64_t hash = fnv1a(key.path.data(), key.path.size());
+    hash = fnv1a(&key.size, sizeof(key.size), hash);
+    hash = fnv1a(&key.mtime, sizeof(key.mtime), hash);
+    hash = fnv1a(&settingsHash, sizeof(settingsHash), hash);
+
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash << CACHE_EXTENSION;
+    return (fs::path(m_directory) / name.str()).string();
+}
+
+bool MeshCache::load(const std::string& sourcePath, uint64_t settingsHash, CachedModel& out) {
+    SourceKey key;
+    if (!querySource(sourcePath, key)) {
+        m_misses++;
+        return false;
+    }
+
+    std::string cachePath;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        cachePath = cacheFileFor(key, settingsHash);
+    }
+
+    std::error_code error;
+    if (!fs::exists(cachePath, error)) {
+        m_misses++;
+        return false;
+    }
+
+
+    // Touch the entry so eviction treats it as recently used
+    fs::last_write_time(cachePath, fs::file_time_type::clock::now(), error);
+
+    auto file = std::make_unique<MappedFile>();
+    if (!file->open(cachePath)) {
+        m_misses++;
+        return false;
+    }
+
+    const uint8_t* base = file->data();
+    const uint64_t fileSize = file->size();
+    auto inBounds = [fileSize](uint64_t offset, uint64_t size) {
+        return offset <= fileSize && size <= fileSize - offset;
+    };
+
+    auto reject = [&](const char* reason) {
+        std::cerr << "Mesh cache entry rejected (" << reason << "): " << cachePath << std::endl;
+        file->close();
+        fs::remove(cachePath, error);
+        m_misses++;
+        return false;
+    };
+
+    if (!inBounds(0, sizeof(FileHeader))) {
+        return reject("truncated header");
+    }
+
+    FileHeader header;
+    memcpy(&header, base, sizeof(header));
+
+    if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != FORMAT_VERSION ||
+        header.vertexStride != sizeof(Vertex) || header.fileSize != fileSize) {
+        return reject("format mismatch");
+    }
+    if (header.sourceSize != key.size || header.sourceMtime != key.mtime || header.settingsHash != settingsHash) {
+        return reject("stale");
+    }
+    if (!inBounds(header.stringTableOffset, header.stringTableSize) ||
+        !inBounds(header.meshTableOffset, static_cast<uint64_t>(header.meshCount) * sizeof(MeshRecord)) ||
+        !inBounds(header.materialTableOffset, static_cast<uint64_t>(header.materialCount) * sizeof(MaterialRecord)) ||
+        !inBounds(header.instanceTableOffset, static_cast<uint64_t>(header.instanceCount) * sizeof(InstanceRecord))) {
+        return reject("corrupt tables");
+    }
+
+    const uint8_t* strings = base + header.stringTableOffset;
+    std::string storedPath;
+    if (!readString(strings, header.stringTableSize, header.sourcePathString, storedPath) || storedPath != key.path) {
+        return reject("hash collision");
+    }
+
+    CachedModel result;
+
+    const MaterialRecord* materialRecords = reinterpret_cast<const MaterialRecord*>(base + header.materialTableOffset);
+    result.materials.resize(header.materialCount);
+    for (uint32_t i = 0; i < header.materialCount; i++) {
+        const MaterialRecord& record = materialRecords[i];
+        Material& material = result.materials[i];
+        material.ambient = glm::vec3(record.ambient[0], record.ambient[1], record.ambient[2]);
+        material.diffuse = glm::vec3(record.diffuse[0], record.diffuse[1], record.diffuse[2]);
+        material.specular = glm::vec3(record.specular[0], record.specular[1], record.specular[2]);
+        material.shininess = record.shininess;
+
+        if (!readString(strings, header.stringTableSize, record.nameString, material.name) ||
+            !readString(strings, header.stringTableSize, record.diffuseTextureString, material.diffuseTexture) ||
+            !readString(strings, header.stringTableSize, record.normalTextureString, material.normalTexture) ||
+            !readString(strings, header.stringTableSize, record.specularTextureString, material.specularTexture)) {
+            return reject("corrupt strings");
+        }
+    }
+
+    const MeshRecord* meshRecords = reinterpret_cast<const MeshRecord*>(base + header.meshTableOffset);
+    result.meshes.resize(header.meshCount);
+    for (uint32_t i = 0; i < header.meshCount; i++) {
+        const MeshRecord& record = meshRecords[i];
+        if (!inBounds(record.vertexOffset, record.vertexCount * sizeof(Vertex)) ||
+            !inBounds(record.indexOffset, record.indexCount * sizeof(uint32_t)) ||
+            !inBounds(record.lodTableOffset, static_cast<uint64_t>(record.lodCount) * sizeof(MeshLod)) ||
+            !inBounds(record.lodIndexOffset, record.lodIndexCount * sizeof(uint32_t)) ||
+            !inBounds(record.meshletOffset, record.meshletCount * sizeof(Meshlet))) {
+            return reject("corrupt mesh table");
+        }
+
+        CachedMesh& mesh = result.meshes[i];
+        mesh.vertices = reinterpret_cast<const Vertex*>(base + record.vertexOffset);
+        mesh.vertexCount = record.vertexCount;
+        mesh.indices = reinterpret_cast<const uint32_t*>(base + record.indexOffset);
+        mesh.indexCount = record.indexCount;
+        mesh.lods = reinterpret_cast<const MeshLod*>(base + record.lodTableOffset);
+        mesh.lodCount = record.lodCount;
+        mesh.lodIndices = reinterpret_cast<const uint32_t*>(base + record.lodIndexOffset);
+        mesh.lodIndexCount = record.lodIndexCount;
+        for (uint32_t level = 0; level < mesh.lodCount; level++) {
+            const MeshLod& lod = mesh.lods[level];
+            if (lod.firstIndex < record.indexCount ||
+                lod.firstIndex - record.indexCount + static_cast<uint64_t>(lod.indexCount) > record.lodIndexCount) {
+                return reject("corrupt LOD table");
+            }
+        }
+        mesh.meshlets = reinterpret_cast<const Meshlet*>(base + record.meshletOffset);
+        mesh.meshletCount = record.meshletCount;
+        for (uint64_t m = 0; m < mesh.meshletCount; m++) {
+            const Meshlet& meshlet = mesh.meshlets[m];
+            if (meshlet.firstIndex + static_cast<uint64_t>(meshlet.triangleCount) * 3 > record.indexCount) {
+                return reject("corrupt meshlet table");
+            }
+        }
+        mesh.materialIndex = record.materialIndex;
+        mesh.sourceVertexCount = record.sourceVertexCount;
+    }
+
+    const InstanceRecord* instanceRecords = reinterpret_cast<const InstanceRecord*>(base + header.instanceTableOffset);
+    result.instances.resize(header.instanceCount);
+    for (uint32_t i = 0; i < header.instanceCount; i++) {
+        if (instanceRecords[i].meshIndex >= header.meshCount) {
+            return reject("corrupt instance table");
+        }
+        result.instances[i].meshIndex = instanceRecords[i].meshIndex;
+        memcpy(&result.instances[i].transform[0][0], instanceRecords[i].transform, sizeof(instanceRecords[i].transform));
+    }
+
+    result.boundsMin = glm::vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    result.boundsMax = glm::vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    result.file = std::move(file);
+
+    out = std::move(result);
+    m_hits++;
+    return true;
+}
+
+bool MeshCache::store(const std::string& sourcePath, uint64_t settingsHash, const std::vector<Mesh>& meshes,
+                      const std::vector<Material>& materials, const std::vector<MeshInstance>& instances,
+                      const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    SourceKey key;
+    if (!querySource(sourcePath, key)) {
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    std::error_code error;
+    fs::create_directories(m_directory, error);
+    if (error) {
+        std::cerr << "Failed to create mesh cache directory " << m_directory << ": " << error.message() << std::endl;
+        return false;
+    }
+
+
+    StringTable strings;
+    FileHeader header{};
+    memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = FORMAT_VERSION;
+    header.vertexStride = sizeof(Vertex);
+    header.sourceSize = key.size;
+    header.sourceMtime = key.mtime;
+    header.settingsHash = settingsHash;
+    header.meshCount = static_cast<uint32_t>(meshes.size());
+    header.materialCount = static_cast<uint32_t>(materials.size());
+    header.instanceCount = static_cast<uint32_t>(instances.size());
+    for (int axis = 0; axis < 3; axis++) {
+        header.boundsMin[axis] = boundsMin[axis];
+        header.boundsMax[axis] = boundsMax[axis];
+    }
+    header.sourcePathString = strings.add(key.path);
+
+    std::vector<MaterialRecord> materialRecords(materials.size());
+    for (size_t i = 0; i < materials.size(); i++) {
+        const Material& material = materials[i];
+        MaterialRecord& record = materialRecords[i];
+        for (int axis = 0; axis < 3; axis++) {
+            record.ambient[axis] = material.ambient[axis];
+            record.diffuse[axis] = material.diffuse[axis];
+            record.specular[axis] = material.specular[axis];
+        }
+        record.shininess = material.shininess;
+        record.nameString = strings.add(material.name);
+        record.diffuseTextureString = strings.add(material.diffuseTexture);
+        record.normalTextureString = strings.add(material.normalTexture);
+        record.specularTextureString = strings.add(material.specularTexture);
+    }
+
+    std::vector<InstanceRecord> instanceRecords(instances.size());
+    for (size_t i = 0; i < instances.size(); i++) {
+        instanceRecords[i].meshIndex = instances[i].meshIndex;
+        instanceRecords[i].reserved = 0;
+        memcpy(instanceRecords[i].transform, &instances[i].transform[0][0], sizeof(instanceRecords[i].transform));
+    }
+
+
+    // Header, tables and strings first, then every vertex/index blob on a 16-byte boundary
+    uint64_t cursor = alignUp(sizeof(FileHeader), BLOB_ALIGNMENT);
+    header.meshTableOffset = cursor;
+    cursor = alignUp(cursor + meshes.size() * sizeof(MeshRecord), BLOB_ALIGNMENT);
+    header.materialTableOffset = cursor;
+    cursor = alignUp(cursor + materialRecords.size() * sizeof(MaterialRecord), BLOB_ALIGNMENT);
+    header.instanceTableOffset = cursor;
+    cursor = alignUp(cursor + instanceRecords.size() * sizeof(InstanceRecord), BLOB_ALIGNMENT);
+    header.stringTableOffset = cursor;
+    header.stringTableSize = strings.data().size();
+    cursor = alignUp(cursor + header.stringTableSize, BLOB_ALIGNMENT);
+
+    std::vector<MeshRecord> meshRecords(meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++) {
+        MeshRecord& record = meshRecords[i];
+        record.vertexOffset = cursor;
+        record.vertexCount = meshes[i].vertices.size();
+        cursor = alignUp(cursor + record.vertexCount * sizeof(Vertex), BLOB_ALIGNMENT);
+        record.indexOffset = cursor;
+        record.indexCount = meshes[i].indices.size();
+        cursor = alignUp(cursor + record.indexCount * sizeof(uint32_t), BLOB_ALIGNMENT);
+        record.lodTableOffset = cursor;
+        record.lodCount = static_cast<uint32_t>(meshes[i].lods.size());
+        cursor = alignUp(cursor + record.lodCount * sizeof(MeshLod), BLOB_ALIGNMENT);
+        record.lodIndexOffset = cursor;
+        record.lodIndexCount = meshes[i].lodIndices.size();
+        cursor = alignUp(cursor + record.lodIndexCount * sizeof(uint32_t), BLOB_ALIGNMENT);
+        record.meshletOffset = cursor;
+        record.meshletCount = meshes[i].meshlets.size();
+        cursor = alignUp(cursor + record.meshletCount * sizeof(Meshlet), BLOB_ALIGNMENT);
+        record.materialIndex = meshes[i].materialIndex;
+        record.sourceVertexCount = meshes[i].sourceVertexCount;
+    }
+    header.fileSize = cursor;
+
+    std::string cachePath = cacheFileFor(key, settingsHash);
+    std::string tempPath = cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file) {
+            std::cerr << "Failed to write mesh cache file: " << tempPath << std::endl;
+            return false;
+        }
+
+        uint64_t position = 0;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        position += sizeof(header);
+
+        writePadding(file, position, header.meshTableOffset);
+        file.write(reinterpret_cast<const char*>(meshRecords.data()), meshRecords.size() * sizeof(MeshRecord));
+        position += meshRecords.size() * sizeof(MeshRecord);
+
+        writePadding(file, position, header.materialTableOffset);
+        file.write(reinterpret_cast<const char*>(materialRecords.data()), materialRecords.size() * sizeof(MaterialRecord));
+        position += materialRecords.size() * sizeof(MaterialRecord);
+
+        writePadding(file, position, header.instanceTableOffset);
+        file.write(reinterpret_cast<const char*>(instanceRecords.data()), instanceRecords.size() * sizeof(InstanceRecord));
+        position += instanceRecords.size() * sizeof(InstanceRecord);
+
+        writePadding(file, position, header.stringTableOffset);
+        file.write(strings.data().data(), static_cast<std::streamsize>(strings.data().size()));
+        position += strings.data().size();
+
+        for (size_t i = 0; i < meshes.size(); i++) {
+            writePadding(file, position, meshRecords[i].vertexOffset);
+            file.write(reinterpret_cast<const char*>(meshes[i].vertices.data()), meshRecords[i].vertexCount * sizeof(Vertex));
+            position += meshRecords[i].vertexCount * sizeof(Vertex);
+
+            writePadding(file, position, meshRecords[i].indexOffset);
+            file.write(reinterpret_cast<const char*>(meshes[i].indices.data()), meshRecords[i].indexCount * sizeof(uint32_t));
+            position += meshRecords[i].indexCount * sizeof(uint32_t);
+
+            writePadding(file, position, meshRecords[i].lodTableOffset);
+            file.write(reinterpret_cast<const char*>(meshes[i].lods.data()), meshRecords[i].lodCount * sizeof(MeshLod));
+            position += meshRecords[i].lodCount * sizeof(MeshLod);
+
+            writePadding(file, position, meshRecords[i].lodIndexOffset);
+            file.write(reinterpret_cast<const char*>(meshes[i].lodIndices.data()), meshRecords[i].lodIndexCount * sizeof(uint32_t));
+            position += meshRecords[i].lodIndexCount * sizeof(uint32_t);
+
+            writePadding(file, position, meshRecords[i].meshletOffset);
+            file.write(reinterpret_cast<const char*>(meshes[i].meshlets.data()), meshRecords[i].meshletCount * sizeof(Meshlet));
+            position += meshRecords[i].meshletCount * sizeof(Meshlet);
+        }
+        writePadding(file, position, header.fileSize);
+
+        if (!file) {
+            std::cerr << "Failed to write mesh cache file: " << tempPath << std::endl;
+            file.close();
+            fs::remove(tempPath, error);
+            return false;
+        }
+    }
+
+    fs::remove(cachePath, error);
+    fs::rename(tempPath, cachePath, error);
+    if (error) {
+        std::cerr << "Failed to finalize mesh cache file " << cachePath << ": " << error.message() << std::endl;
+        fs::remove(tempPath, error);
+        return false;
+    }
+
+    m_writes++;
+    std::cout << "Wrote mesh cache (" << (header.fileSize / (1024.0 * 1024.0)) << " MB): " << cachePath << std::endl;
+
+    evict();
+    return true;
+}
+
+void MeshCache::evict() {
+    struct Entry {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type lastUsed;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t totalBytes = 0;
+
+    std::error_code error;
+    for (const auto& item : fs::directory_iterator(m_directory, error)) {
+        if (!item.is_regular_file(error) || item.path().extension() != CACHE_EXTENSION) {
+            continue;
+        }
+        Entry entry{item.path(), item.file_size(error), item.last_write_time(error)};
+        totalBytes += entry.size;
+        entries.push_back(entry);
+    }
+
+    if (totalBytes <= m_maxBytes) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) {
+        return a.lastUsed < b.lastUsed;
+    });
+
+    for (const auto& entry : entries) {
+        if (totalBytes <= m_maxBytes) {
+            break;
+        }
+        if (fs::remove(entry.path, error)) {
+            totalBytes -= entry.size;
+            m_evictions++;
+            std::cout << "Evicted mesh cache entry: " << entry.path.string() << std::endl;
+        }
+    }
+}
+
+MeshCacheStats MeshCache::getStats() const {
+    MeshCacheStats stats;
+    stats.hits = m_hits.load();
+    stats.misses = m_misses.load();
+    stats.writes = m_writes.load();
+    stats.evictions = m_evictions.load();
+    return stats;
+}
+
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "../core/MappedFile.hpp"
+#include "../scene/Model.hpp"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace VulkanViewer {
+
+struct CachedMesh {
+    const Vertex* vertices = nullptr;
+    uint64_t vertexCount = 0;
+    const uint32_t* indices = nullptr;
+    uint64_t indexCount = 0;
+    const uint32_t* lodIndices = nullptr;
+    uint64_t lodIndexCount = 0;
+    const MeshLod* lods = nullptr;
+    uint32_t lodCount = 0;
+    const Meshlet* meshlets = nullptr;
+    uint64_t meshletCount = 0;
+    uint32_t materialIndex = 0;
+    uint64_t sourceVertexCount = 0;
+};
+
+// Vertex, index, LOD and meshlet pointers point into the mapping and stay valid while `file` is open
+struct CachedModel {
+    std::unique_ptr<MappedFile> file;
+    std::vector<CachedMesh> meshes;
+    std::vector<Material> materials;
+    std::vector<MeshInstance> instances;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+struct MeshCacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t writes = 0;
+    uint64_t evictions = 0;
+};
+
+// On-disk cache of imported geometry, keyed by source path, size, mtime and import settings.
+// Files are laid out so they can be mapped and uploaded without any parsing.
+class MeshCache {
+public:
+    static constexpr uint32_t FORMAT_VERSION = 5;
+    static constexpr uint64_t DEFAULT_MAX_BYTES = 4ull * 1024 * 1024 * 1024;
+
+    static MeshCache& get();
+
+    void setDirectory(const std::string& directory);
+    void setMaxBytes(uint64_t maxBytes) { m_maxBytes = maxBytes; }
+
+    bool load(const std::string& sourcePath, uint64_t settingsHash, CachedModel& out);
+    bool store(const std::string& sourcePath, uint64_t settingsHash, const std::vector<Mesh>& meshes,
+               const std::vector<Material>& materials, const std::vector<MeshInstance>& instances,
+               const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+    MeshCacheStats getStats() const;
+
+private:
+    MeshCache();
+
+    struct SourceKey {
+        std::string path;
+        uint64_t size = 0;
+        int64_t mtime = 0;
+    };
+
+    bool querySource(const std::string& sourcePath, SourceKey& key) const;
+    std::string cacheFileFor(const SourceKey& key, uint64_t settingsHash) const;
+    void evict();
+
+    std::string m_directory;
+    uint64_t m_maxBytes = DEFAULT_MAX_BYTES;
+    std::mutex m_mutex;
+
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+    std::atomic<uint64_t> m_writes{0};
+    std::atomic<uint64_t> m_evictions{0};
+};
+
+}
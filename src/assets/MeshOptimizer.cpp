@@ -0,0 +1,275 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace VulkanViewer {
+
+namespace {
+
+// FIFO post-transform cache model: a vertex is a hit if it was one of the last `size` vertices transformed
+class FifoCache {
+public:
+    FifoCache(size_t vertexCount, uint32_t size)
+        : m_timestamps(vertexCount, 0), m_time(size + 1), m_size(size) {
+    }
+
+    // Returns true on a miss
+    bool access(uint32_t vertex) {
+        if (m_time - m_timestamps[vertex] > m_size) {
+            m_timestamps[vertex] = m_time++;
+            return true;
+        }
+        return false;
+    }
+
+    void reset() {
+        m_time += m_size + 1;
+    }
+
+private:
+    std::vector<uint32_t> m_timestamps;
+    uint32_t m_time;
+    uint32_t m_size;
+};
+
+}
+
+VertexCacheStats MeshOptimizer::analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStats stats;
+    stats.triangles = indices.size() / 3;
+    stats.vertices = vertexCount;
+
+    FifoCache cache(vertexCount, cacheSize);
+    for (size_t i = 0; i < stats.triangles * 3; i++) {
+        if (indices[i] < vertexCount && cache.access(indices[i])) {
+            stats.transforms++;
+        }
+    }
+    return stats;
+}
+
+void MeshOptimizer::optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount, uint32_t cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || vertexCount == 0) {
+        return;
+    }
+
+
+    // Vertex -> triangle adjacency in CSR form; liveTriangles counts triangles not yet emitted
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < triangleCount * 3; i++) {
+        liveTriangles[indices[i]]++;
+    }
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + liveTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(triangleCount * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (size_t k = 0; k < 3; k++) {
+            adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<uint32_t> cacheTime(vertexCount, 0);
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> deadEnd;
+    deadEnd.reserve(triangleCount * 3);
+    std::vector<uint32_t> candidates;
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+
+    uint32_t time = cacheSize + 1;
+    size_t scanCursor = 0;
+    int64_t fanning = indices[0];
+
+    while (fanning >= 0) {
+        candidates.clear();
+
+        for (uint32_t a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+            uint32_t triangle = adjacency[a];
+            if (emitted[triangle]) {
+                continue;
+            }
+            emitted[triangle] = 1;
+
+            for (size_t k = 0; k < 3; k++) {
+                uint32_t vertex = indices[triangle * 3 + k];
+                output.push_back(vertex);
+                deadEnd.push_back(vertex);
+                candidates.push_back(vertex);
+                liveTriangles[vertex]--;
+                if (time - cacheTime[vertex] > cacheSize) {
+                    cacheTime[vertex] = time++;
+                }
+            }
+        }
+
+
+        // Prefer the oldest candidate that will still be in the cache after its remaining triangles are emitted
+        fanning = -1;
+        int64_t bestPriority = -1;
+        for (uint32_t vertex : candidates) {
+            if (liveTriangles[vertex] == 0) {
+                continue;
+            }
+            int64_t priority = 0;
+            if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= cacheSize) {
+                priority = time - cacheTime[vertex];
+            }
+            if (priority > bestPriority) {
+                bestPriority = priority;
+                fanning = vertex;
+            }
+        }
+
+        while (fanning < 0 && !deadEnd.empty()) {
+            uint32_t vertex = deadEnd.back();
+            deadEnd.pop_back();
+            if (liveTriangles[vertex] > 0) {
+                fanning = vertex;
+            }
+        }
+
+        while (fanning < 0 && scanCursor < vertexCount) {
+            if (liveTriangles[scanCursor] > 0) {
+                fanning = static_cast<int64_t>(scanCursor);
+            } else {
+                scanCursor++;
+            }
+        }
+    }
+
+    indices.swap(output);
+}
+
+void MeshOptimizer::optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+                                     float threshold, uint32_t cacheSize) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2 || vertices.empty()) {
+        return;
+    }
+
+
+    // Hard boundaries: triangles where all three vertices miss, so the cache carries nothing over
+    FifoCache cache(vertices.size(), cacheSize);
+    std::vector<uint8_t> misses(triangleCount);
+    std::vector<size_t> hardBoundaries = {0};
+    for (size_t t = 0; t < triangleCount; t++) {
+        uint8_t count = 0;
+        for (size_t k = 0; k < 3; k++) {
+            count += cache.access(indices[t * 3 + k]) ? 1 : 0;
+        }
+        misses[t] = count;
+        if (t > 0 && count == 3) {
+            hardBoundaries.push_back(t);
+        }
+    }
+    hardBoundaries.push_back(triangleCount);
+
+
+    // Soft boundaries: split a hard cluster wherever the piece so far, simulated from a cold cache,
+    // is within threshold of the whole cluster's ACMR
+    std::vector<size_t> clusterStarts;
+    for (size_t h = 0; h + 1 < hardBoundaries.size(); h++) {
+        size_t start = hardBoundaries[h];
+        size_t end = hardBoundaries[h + 1];
+
+        uint64_t clusterMisses = 0;
+        for (size_t t = start; t < end; t++) {
+            clusterMisses += misses[t];
+        }
+        double limit = static_cast<double>(clusterMisses) / (end - start) * threshold;
+
+        clusterStarts.push_back(start);
+        cache.reset();
+        uint64_t running = 0;
+        size_t pieceStart = start;
+        for (size_t t = start; t < end; t++) {
+            for (size_t k = 0; k < 3; k++) {
+                running += cache.access(indices[t * 3 + k]) ? 1 : 0;
+            }
+            if (t + 1 < end && running <= limit * (t - pieceStart + 1)) {
+                clusterStarts.push_back(t + 1);
+                pieceStart = t + 1;
+                running = 0;
+                cache.reset();
+            }
+        }
+    }
+    size_t clusterCount = clusterStarts.size();
+    clusterStarts.push_back(triangleCount);
+
+
+    // View-independent sort key: how far the cluster sits along its own average normal from the
+    // mesh centroid. Outward-facing clusters on the hull are drawn first and occlude the rest.
+    std::vector<glm::vec3> clusterCentroids(clusterCount, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(clusterCount, glm::vec3(0.0f));
+    std::vector<float> clusterAreas(clusterCount, 0.0f);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+
+    for (size_t c = 0; c < clusterCount; c++) {
+        for (size_t t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].pos;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].pos;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].pos;
+
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+            float area = glm::length(normal);
+            glm::vec3 centroid = (p0 + p1 + p2) / 3.0f;
+
+            clusterCentroids[c] += centroid * area;
+            clusterNormals[c] += normal;
+            clusterAreas[c] += area;
+        }
+        meshCentroid += clusterCentroids[c];
+        meshArea += clusterAreas[c];
+    }
+    if (meshArea > 0.0f) {
+        meshCentroid /= meshArea;
+    }
+
+    std::vector<float> sortKeys(clusterCount, 0.0f);
+    for (size_t c = 0; c < clusterCount; c++) {
+        float normalLength = glm::length(clusterNormals[c]);
+        if (clusterAreas[c] > 0.0f && normalLength > 0.0f) {
+            glm::vec3 centroid = clusterCentroids[c] / clusterAreas[c];
+            sortKeys[c] = glm::dot(centroid - meshCentroid, clusterNormals[c] / normalLength);
+        }
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        order[c] = static_cast<uint32_t>(c);
+    }
+    std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t a, uint32_t b) {
+        return sortKeys[a] > sortKeys[b];
+    });
+
+    std::vector<uint32_t> output;
+    output.reserve(triangleCount * 3);
+    for (uint32_t c : order) {
+        output.insert(output.end(), indices.begin() + clusterStarts[c] * 3, indices.begin() + clusterStarts[c + 1] * 3);
+    }
+    indices.swap(output);
+}
+
+void MeshOptimizer::optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices) {
+    std::vector<uint32_t> remap(vertices.size(), UINT32_MAX);
+    std::vector<Vertex> reordered;
+    reordered.reserve(vertices.size());
+
+    for (auto& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = static_cast<uint32_t>(reordered.size());
+            reordered.push_back(vertices[index]);
+        }
+        index = remap[index];
+    }
+    vertices.swap(reordered);
+}
+
+}
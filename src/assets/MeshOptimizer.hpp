@@ -0,0 +1,51 @@
+#pragma once
+
+#include "../scene/Model.hpp"
+
+#include <vector>
+
+namespace VulkanViewer {
+
+// Result of running an index buffer through a simulated FIFO post-transform cache
+struct VertexCacheStats {
+    uint64_t transforms = 0;
+    uint64_t triangles = 0;
+    uint64_t vertices = 0;
+
+    // Average cache miss ratio: transformed vertices per triangle (0.5 is ideal for regular grids, 3 is worst)
+    float getACMR() const { return triangles ? static_cast<float>(transforms) / triangles : 0.0f; }
+    // Average transform to vertex ratio: 1.0 means every vertex is shaded exactly once
+    float getATVR() const { return vertices ? static_cast<float>(transforms) / vertices : 0.0f; }
+
+    VertexCacheStats& operator+=(const VertexCacheStats& other) {
+        transforms += other.transforms;
+        triangles += other.triangles;
+        vertices += other.vertices;
+        return *this;
+    }
+};
+
+// Index and vertex reordering for triangle lists. The usual order is
+// optimizeVertexCache -> optimizeOverdraw -> optimizeVertexFetch.
+class MeshOptimizer {
+public:
+    static constexpr uint32_t DEFAULT_CACHE_SIZE = 16;
+    static constexpr float DEFAULT_OVERDRAW_THRESHOLD = 1.05f;
+
+    static VertexCacheStats analyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertexCount,
+                                               uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+    // Tipsify (Sander et al. 2007): fans around the most recently used vertex that will still be cached
+    static void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount,
+                                    uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+    // Splits the cache-ordered triangles into clusters and draws outward-facing clusters first.
+    // A cluster only ends where the ACMR stays within `threshold` of the input order.
+    static void optimizeOverdraw(std::vector<uint32_t>& indices, const std::vector<Vertex>& vertices,
+                                 float threshold = DEFAULT_OVERDRAW_THRESHOLD, uint32_t cacheSize = DEFAULT_CACHE_SIZE);
+
+    // Reorders vertices by first use in the index buffer and drops unreferenced ones
+    static void optimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices);
+};
+
+}
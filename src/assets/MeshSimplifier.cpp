@@ -0,0 +1,391 @@
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace VulkanViewer {
+
+namespace {
+
+constexpr uint32_t NO_EDGE = UINT32_MAX;
+constexpr uint32_t MANY_EDGES = UINT32_MAX - 1;
+
+constexpr double BORDER_EDGE_WEIGHT = 10.0;
+constexpr double SEAM_EDGE_WEIGHT = 1.0;
+
+enum class VertexKind : uint8_t {
+    Manifold,   // every edge is shared with a neighbouring triangle
+    Border,     // on an open boundary of the surface
+    Seam,       // one of two vertices sharing a position across a UV or normal seam
+    Locked      // corners, non-manifold fans and anything else that has to stay put
+};
+
+struct Quadric {
+    double a00 = 0.0, a11 = 0.0, a22 = 0.0, a01 = 0.0, a02 = 0.0, a12 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    double c = 0.0;
+    double weight = 0.0;
+
+    // Squared distance to the plane n.p + d = 0, scaled by w
+    void addPlane(double nx, double ny, double nz, double d, double w) {
+        a00 += w * nx * nx;
+        a11 += w * ny * ny;
+        a22 += w * nz * nz;
+        a01 += w * nx * ny;
+        a02 += w * nx * nz;
+        a12 += w * ny * nz;
+        b0 += w * nx * d;
+        b1 += w * ny * d;
+        b2 += w * nz * d;
+        c += w * d * d;
+        weight += w;
+    }
+
+    void add(const Quadric& other) {
+        a00 += other.a00;
+        a11 += other.a11;
+        a22 += other.a22;
+        a01 += other.a01;
+        a02 += other.a02;
+        a12 += other.a12;
+        b0 += other.b0;
+        b1 += other.b1;
+        b2 += other.b2;
+        c += other.c;
+        weight += other.weight;
+    }
+
+    // Mean squared distance of p to the accumulated planes
+    double evaluate(const glm::vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        double sum = a00 * x * x + a11 * y * y + a22 * z * z +
+                     2.0 * (a01 * x * y + a02 * x * z + a12 * y * z) +
+                     2.0 * (b0 * x + b1 * y + b2 * z) + c;
+        return weight > 0.0 ? std::abs(sum) / weight : 0.0;
+    }
+};
+
+struct Collapse {
+    uint32_t from;
+    uint32_t to;
+    float cost;
+    float distance;
+};
+
+inline uint64_t edgeKey(uint32_t a, uint32_t b) {
+    return (static_cast<uint64_t>(a) << 32) | b;
+}
+
+inline void recordOpenEdge(uint32_t& slot, uint32_t vertex) {
+    slot = (slot == NO_EDGE || slot == vertex) ? vertex : MANY_EDGES;
+}
+
+inline float attributeDistance(const Vertex& a, const Vertex& b) {
+    glm::vec3 normal = a.normal - b.normal;
+    float du = a.texCoord.x - b.texCoord.x;
+    float dv = a.texCoord.y - b.texCoord.y;
+    return MeshSimplifier::NORMAL_WEIGHT * glm::dot(normal, normal) + MeshSimplifier::UV_WEIGHT * (du * du + dv * dv);
+}
+
+}
+
+std::vector<uint32_t> MeshSimplifier::simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                               size_t targetIndexCount, float& error) {
+    error = 0.0f;
+    size_t vertexCount = vertices.size();
+
+    std::vector<uint32_t> result;
+    result.reserve(indices.size());
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        uint32_t a = indices[i], b = indices[i + 1], c = indices[i + 2];
+        if (a < vertexCount && b < vertexCount && c < vertexCount && a != b && b != c && a != c) {
+            result.insert(result.end(), {a, b, c});
+        }
+    }
+    if (result.size() <= targetIndexCount) {
+        return result;
+    }
+
+
+    // Work in a unit cube so costs are comparable across meshes of any scale
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+    for (const auto& vertex : vertices) {
+        boundsMin = glm::vec3(std::min(boundsMin.x, vertex.pos.x), std::min(boundsMin.y, vertex.pos.y), std::min(boundsMin.z, vertex.pos.z));
+        boundsMax = glm::vec3(std::max(boundsMax.x, vertex.pos.x), std::max(boundsMax.y, vertex.pos.y), std::max(boundsMax.z, vertex.pos.z));
+    }
+    float extent = std::max({boundsMax.x - boundsMin.x, boundsMax.y - boundsMin.y, boundsMax.z - boundsMin.z});
+    if (!(extent > 0.0f) || !std::isfinite(extent)) {
+        return result;
+    }
+    std::vector<glm::vec3> positions(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        positions[v] = (vertices[v].pos - boundsMin) / extent;
+    }
+
+
+    // remap: the lowest vertex index at the same position; wedge: ring of vertices sharing that position
+    std::vector<uint32_t> remap(vertexCount);
+    std::vector<uint32_t> wedge(vertexCount);
+    {
+        std::vector<uint32_t> order(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++) {
+            order[v] = static_cast<uint32_t>(v);
+        }
+        auto less = [&vertices](uint32_t a, uint32_t b) {
+            int cmp = std::memcmp(&vertices[a].pos, &vertices[b].pos, sizeof(glm::vec3));
+            return cmp < 0 || (cmp == 0 && a < b);
+        };
+        std::sort(order.begin(), order.end(), less);
+
+        for (size_t start = 0; start < vertexCount;) {
+            size_t end = start + 1;
+            while (end < vertexCount && std::memcmp(&vertices[order[start]].pos, &vertices[order[end]].pos, sizeof(glm::vec3)) == 0) {
+                end++;
+            }
+            for (size_t i = start; i < end; i++) {
+                remap[order[i]] = order[start];
+                wedge[order[i]] = order[i + 1 < end ? i + 1 : start];
+            }
+            start = end;
+        }
+    }
+
+
+    // An attribute-level half-edge without a twin is open: either a border or one side of a seam
+    std::vector<uint32_t> openOut(vertexCount, NO_EDGE);
+    std::vector<uint32_t> openInc(vertexCount, NO_EDGE);
+    std::vector<uint8_t> openHalfEdge(result.size(), 0);
+    {
+        std::vector<uint64_t> halfEdges(result.size());
+        for (size_t i = 0; i < result.size(); i++) {
+            size_t next = (i % 3 == 2) ? i - 2 : i + 1;
+            halfEdges[i] = edgeKey(result[i], result[next]);
+        }
+        std::vector<uint64_t> sorted = halfEdges;
+        std::sort(sorted.begin(), sorted.end());
+
+        for (size_t i = 0; i < result.size(); i++) {
+            uint32_t a = static_cast<uint32_t>(halfEdges[i] >> 32);
+            uint32_t b = static_cast<uint32_t>(halfEdges[i]);
+            if (!std::binary_search(sorted.begin(), sorted.end(), edgeKey(b, a))) {
+                openHalfEdge[i] = 1;
+                recordOpenEdge(openOut[a], b);
+                recordOpenEdge(openInc[b], a);
+            }
+        }
+    }
+
+    std::vector<VertexKind> kinds(vertexCount, VertexKind::Locked);
+    for (size_t v = 0; v < vertexCount; v++) {
+        uint32_t w = wedge[v];
+        if (w == v) {
+            if (openOut[v] == NO_EDGE && openInc[v] == NO_EDGE) {
+                kinds[v] = VertexKind::Manifold;
+            } else if (openOut[v] < MANY_EDGES && openInc[v] < MANY_EDGES) {
+                kinds[v] = VertexKind::Border;
+            }
+        } else if (wedge[w] == v) {
+            bool simple = openOut[v] < MANY_EDGES && openInc[v] < MANY_EDGES &&
+                          openOut[w] < MANY_EDGES && openInc[w] < MANY_EDGES;
+            if (simple && remap[openOut[v]] == remap[openInc[w]] && remap[openInc[v]] == remap[openOut[w]]) {
+                kinds[v] = VertexKind::Seam;
+            }
+        }
+    }
+
+
+    // Area-weighted triangle planes, plus perpendicular planes along open edges to hold borders in place
+    std::vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < result.size(); i += 3) {
+        const glm::vec3& p0 = positions[result[i]];
+        const glm::vec3& p1 = positions[result[i + 1]];
+        const glm::vec3& p2 = positions[result[i + 2]];
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length <= 0.0f) {
+            continue;
+        }
+        normal = normal / length;
+        double d = -glm::dot(normal, p0);
+        for (size_t k = 0; k < 3; k++) {
+            quadrics[remap[result[i + k]]].addPlane(normal.x, normal.y, normal.z, d, length * 0.5);
+        }
+
+        for (size_t k = 0; k < 3; k++) {
+            if (!openHalfEdge[i + k]) {
+                continue;
+            }
+            uint32_t a = result[i + k];
+            uint32_t b = result[i + (k + 1) % 3];
+            glm::vec3 edge = positions[b] - positions[a];
+            glm::vec3 edgeNormal = glm::cross(edge, normal);
+            float edgeLength = glm::length(edgeNormal);
+            if (edgeLength <= 0.0f) {
+                continue;
+            }
+            edgeNormal = edgeNormal / edgeLength;
+            double edgeD = -glm::dot(edgeNormal, positions[a]);
+            bool seam = kinds[a] == VertexKind::Seam || kinds[b] == VertexKind::Seam;
+            double weight = glm::dot(edge, edge) * (seam ? SEAM_EDGE_WEIGHT : BORDER_EDGE_WEIGHT);
+            quadrics[remap[a]].addPlane(edgeNormal.x, edgeNormal.y, edgeNormal.z, edgeD, weight);
+            quadrics[remap[b]].addPlane(edgeNormal.x, edgeNormal.y, edgeNormal.z, edgeD, weight);
+        }
+    }
+
+    auto canCollapse = [&](uint32_t from, uint32_t to) {
+        switch (kinds[from]) {
+        case VertexKind::Manifold:
+            return true;
+        case VertexKind::Border:
+            return kinds[to] == VertexKind::Border && (openOut[from] == to || openInc[from] == to);
+        case VertexKind::Seam: {
+            if (kinds[to] != VertexKind::Seam || !(openOut[from] == to || openInc[from] == to)) {
+                return false;
+            }
+            uint32_t fromWedge = wedge[from];
+            uint32_t toWedge = wedge[to];
+            return openOut[fromWedge] == toWedge || openInc[fromWedge] == toWedge;
+        }
+        default:
+            return false;
+        }
+    };
+
+    // Attribute differences only steer the order; the reported error stays purely geometric
+    auto collapseCost = [&](uint32_t from, uint32_t to, float& distance) {
+        double squaredDistance = quadrics[remap[from]].evaluate(positions[to]);
+        double cost = squaredDistance + attributeDistance(vertices[from], vertices[to]);
+        if (kinds[from] == VertexKind::Seam) {
+            cost += attributeDistance(vertices[wedge[from]], vertices[wedge[to]]);
+        }
+        distance = static_cast<float>(std::sqrt(squaredDistance));
+        return static_cast<float>(cost);
+    };
+
+    std::vector<uint32_t> collapseRemap(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        collapseRemap[v] = static_cast<uint32_t>(v);
+    }
+    std::vector<uint8_t> locked(vertexCount);
+    std::vector<uint32_t> offsets(vertexCount + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<Collapse> collapses;
+    float maxDistance = 0.0f;
+
+    while (result.size() > targetIndexCount) {
+        size_t triangleCount = result.size() / 3;
+
+        collapses.clear();
+        for (size_t i = 0; i < result.size(); i++) {
+            uint32_t a = result[i];
+            uint32_t b = result[(i % 3 == 2) ? i - 2 : i + 1];
+            float forwardDistance = 0.0f;
+            float backwardDistance = 0.0f;
+            float forward = canCollapse(a, b) ? collapseCost(a, b, forwardDistance) : std::numeric_limits<float>::max();
+            float backward = canCollapse(b, a) ? collapseCost(b, a, backwardDistance) : std::numeric_limits<float>::max();
+            if (forward == std::numeric_limits<float>::max() && backward == std::numeric_limits<float>::max()) {
+                continue;
+            }
+            collapses.push_back(forward <= backward ? Collapse{a, b, forward, forwardDistance}
+                                                    : Collapse{b, a, backward, backwardDistance});
+        }
+        if (collapses.empty()) {
+            break;
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+            return a.cost < b.cost;
+        });
+
+
+        // Position -> triangle adjacency for the flip test
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (uint32_t index : result) {
+            offsets[remap[index] + 1]++;
+        }
+        for (size_t v = 0; v < vertexCount; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < result.size(); i++) {
+            adjacency[fill[remap[result[i]]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        auto flipsTriangles = [&](uint32_t from, uint32_t to) {
+            uint32_t fromPosition = remap[from];
+            uint32_t toPosition = remap[to];
+            for (uint32_t a = offsets[fromPosition]; a < offsets[fromPosition + 1]; a++) {
+                const uint32_t* triangle = &result[adjacency[a] * 3];
+                glm::vec3 p[3];
+                glm::vec3 moved[3];
+                bool touchesTarget = false;
+                for (size_t k = 0; k < 3; k++) {
+                    uint32_t position = remap[triangle[k]];
+                    touchesTarget |= position == toPosition;
+                    p[k] = positions[triangle[k]];
+                    moved[k] = position == fromPosition ? positions[to] : p[k];
+                }
+                if (touchesTarget) {
+                    continue;
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                if (glm::dot(before, after) < 0.25f * glm::length(before) * glm::length(after)) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+
+        // Each collapse removes about two triangles; endpoints are locked so this pass never chains collapses
+        size_t collapseGoal = std::max<size_t>(1, (triangleCount - targetIndexCount / 3) / 2);
+        size_t applied = 0;
+        std::fill(locked.begin(), locked.end(), 0);
+
+        for (const Collapse& collapse : collapses) {
+            uint32_t fromPosition = remap[collapse.from];
+            uint32_t toPosition = remap[collapse.to];
+            if (locked[fromPosition] || locked[toPosition] || flipsTriangles(collapse.from, collapse.to)) {
+                continue;
+            }
+
+            collapseRemap[collapse.from] = collapse.to;
+            if (kinds[collapse.from] == VertexKind::Seam) {
+                collapseRemap[wedge[collapse.from]] = wedge[collapse.to];
+            }
+            quadrics[toPosition].add(quadrics[fromPosition]);
+            maxDistance = std::max(maxDistance, collapse.distance);
+
+            locked[fromPosition] = 1;
+            locked[toPosition] = 1;
+            if (++applied >= collapseGoal) {
+                break;
+            }
+        }
+        if (applied == 0) {
+            break;
+        }
+
+        size_t write = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            uint32_t a = collapseRemap[result[i]];
+            uint32_t b = collapseRemap[result[i + 1]];
+            uint32_t c = collapseRemap[result[i + 2]];
+            if (remap[a] != remap[b] && remap[b] != remap[c] && remap[a] != remap[c]) {
+                result[write++] = a;
+                result[write++] = b;
+                result[write++] = c;
+            }
+        }
+        result.resize(write);
+    }
+
+    error = maxDistance * extent;
+    return result;
+}
+
+}
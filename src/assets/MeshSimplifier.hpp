@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../scene/Model.hpp"
+
+#include <vector>
+
+namespace VulkanViewer {
+
+// Quadric error edge collapse (Garland & Heckbert 1997) that only collapses onto existing
+// vertices, so every level can index the original vertex buffer. Open borders and attribute
+// seams only collapse along themselves; differences in normal and UV add to the collapse cost.
+class MeshSimplifier {
+public:
+    static constexpr float NORMAL_WEIGHT = 0.25f;
+    static constexpr float UV_WEIGHT = 1.0f;
+
+    // Collapses edges until at most targetIndexCount indices remain or nothing more can go.
+    // `error` receives the largest geometric deviation that was accepted, in model units;
+    // attribute differences only decide the collapse order.
+    static std::vector<uint32_t> simplify(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                          size_t targetIndexCount, float& error);
+};
+
+}
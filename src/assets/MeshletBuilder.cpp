@@ -0,0 +1,217 @@
+#include "MeshletBuilder.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+namespace VulkanViewer {
+
+std::vector<Meshlet> MeshletBuilder::build(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                                           uint32_t maxVertices, uint32_t maxTriangles) {
+    std::vector<Meshlet> meshlets;
+    size_t vertexCount = vertices.size();
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0 || indices.size() % 3 != 0 || maxVertices < 3 || maxTriangles == 0) {
+        return meshlets;
+    }
+    for (uint32_t index : indices) {
+        if (index >= vertexCount) {
+            return meshlets;
+        }
+    }
+
+
+    // Vertex -> triangle adjacency in CSR form; emitted triangles are swapped out of the first
+    // liveTriangles[v] entries so neighbour scans only ever see triangles that are still free
+    std::vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (uint32_t index : indices) {
+        liveTriangles[index]++;
+    }
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        offsets[v + 1] = offsets[v] + liveTriangles[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+    }
+
+    std::vector<uint8_t> emitted(triangleCount, 0);
+    std::vector<uint32_t> vertexMeshlet(vertexCount, UINT32_MAX);
+    std::vector<uint32_t> order;
+    order.reserve(triangleCount);
+
+    uint32_t meshletIndex = 0;
+    uint32_t meshletVertexCount = 0;
+    uint32_t meshletTriangleCount = 0;
+    size_t meshletStart = 0;
+    std::vector<uint32_t> meshletVertices;
+    meshletVertices.reserve(maxVertices);
+    size_t seedCursor = 0;
+
+    auto newVertexCount = [&](uint32_t triangle) {
+        uint32_t count = 0;
+        for (size_t k = 0; k < 3; k++) {
+            count += vertexMeshlet[indices[triangle * 3 + k]] != meshletIndex ? 1 : 0;
+        }
+        return count;
+    };
+
+    auto emit = [&](uint32_t triangle) {
+        emitted[triangle] = 1;
+        order.push_back(triangle);
+        meshletTriangleCount++;
+        for (size_t k = 0; k < 3; k++) {
+            uint32_t v = indices[triangle * 3 + k];
+            if (vertexMeshlet[v] != meshletIndex) {
+                vertexMeshlet[v] = meshletIndex;
+                meshletVertices.push_back(v);
+                meshletVertexCount++;
+            }
+
+            uint32_t* live = &adjacency[offsets[v]];
+            for (uint32_t j = 0; j < liveTriangles[v]; j++) {
+                if (live[j] == triangle) {
+                    live[j] = live[--liveTriangles[v]];
+                    break;
+                }
+            }
+        }
+    };
+
+    auto finish = [&]() {
+        Meshlet meshlet;
+        meshlet.firstIndex = static_cast<uint32_t>(meshletStart * 3);
+        meshlet.triangleCount = meshletTriangleCount;
+        meshlets.push_back(meshlet);
+
+        meshletIndex++;
+        meshletVertexCount = 0;
+        meshletTriangleCount = 0;
+        meshletStart = order.size();
+        meshletVertices.clear();
+    };
+
+    while (order.size() < triangleCount) {
+
+        // Fewest new vertices first; ties go to the triangle whose corners have the fewest free
+        // triangles left, which keeps the growing front from leaving isolated triangles behind
+        uint32_t best = UINT32_MAX;
+        uint32_t bestNew = UINT32_MAX;
+        uint32_t bestLive = UINT32_MAX;
+        for (uint32_t v : meshletVertices) {
+            const uint32_t* live = &adjacency[offsets[v]];
+            for (uint32_t j = 0; j < liveTriangles[v]; j++) {
+                uint32_t triangle = live[j];
+                uint32_t added = newVertexCount(triangle);
+                uint32_t liveSum = liveTriangles[indices[triangle * 3]] + liveTriangles[indices[triangle * 3 + 1]] +
+                                   liveTriangles[indices[triangle * 3 + 2]];
+                if (added < bestNew || (added == bestNew && liveSum < bestLive)) {
+                    best = triangle;
+                    bestNew = added;
+                    bestLive = liveSum;
+                }
+            }
+        }
+
+
+        // Once a connected piece runs out, small meshlets keep filling from the input order so
+        // triangle soups do not end up as one meshlet per triangle; fuller ones are closed to keep bounds tight
+        if (best == UINT32_MAX) {
+            if (meshletTriangleCount >= maxTriangles / 4) {
+                finish();
+            }
+            while (emitted[seedCursor]) {
+                seedCursor++;
+            }
+            best = static_cast<uint32_t>(seedCursor);
+            bestNew = newVertexCount(best);
+        }
+
+        if (meshletTriangleCount > 0 &&
+            (meshletTriangleCount >= maxTriangles || meshletVertexCount + bestNew > maxVertices)) {
+            finish();
+        }
+        emit(best);
+    }
+    if (meshletTriangleCount > 0) {
+        finish();
+    }
+
+
+    std::vector<uint32_t> reordered(indices.size());
+    for (size_t i = 0; i < order.size(); i++) {
+        reordered[i * 3 + 0] = indices[order[i] * 3 + 0];
+        reordered[i * 3 + 1] = indices[order[i] * 3 + 1];
+        reordered[i * 3 + 2] = indices[order[i] * 3 + 2];
+    }
+    indices.swap(reordered);
+
+    for (auto& meshlet : meshlets) {
+        meshlet = computeBounds(vertices, indices, meshlet.firstIndex, meshlet.triangleCount);
+    }
+    return meshlets;
+}
+
+Meshlet MeshletBuilder::computeBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                      uint32_t firstIndex, uint32_t triangleCount) {
+    Meshlet meshlet;
+    meshlet.firstIndex = firstIndex;
+    meshlet.triangleCount = triangleCount;
+    size_t endIndex = static_cast<size_t>(firstIndex) + static_cast<size_t>(triangleCount) * 3;
+
+    glm::vec3 boundsMin(FLT_MAX);
+    glm::vec3 boundsMax(-FLT_MAX);
+    for (size_t i = firstIndex; i < endIndex; i++) {
+        boundsMin = glm::min(boundsMin, vertices[indices[i]].pos);
+        boundsMax = glm::max(boundsMax, vertices[indices[i]].pos);
+    }
+    meshlet.center = (boundsMin + boundsMax) * 0.5f;
+    float radiusSquared = 0.0f;
+    for (size_t i = firstIndex; i < endIndex; i++) {
+        glm::vec3 offset = vertices[indices[i]].pos - meshlet.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    meshlet.radius = std::sqrt(radiusSquared);
+
+
+    // Normal cone from the geometric face normals; the vertex normals can be smoothed across creases
+    std::vector<glm::vec3> normals;
+    normals.reserve(triangleCount);
+    glm::vec3 normalSum(0.0f);
+    for (size_t i = firstIndex; i < endIndex; i += 3) {
+        const glm::vec3& p0 = vertices[indices[i]].pos;
+        const glm::vec3& p1 = vertices[indices[i + 1]].pos;
+        const glm::vec3& p2 = vertices[indices[i + 2]].pos;
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length > 0.0f) {
+            normals.push_back(normal / length);
+            normalSum += normals.back();
+        }
+    }
+
+    float sumLength = glm::length(normalSum);
+    if (normals.empty() || sumLength <= 0.0f) {
+        return meshlet;
+    }
+    glm::vec3 axis = normalSum / sumLength;
+    float minDot = 1.0f;
+    for (const auto& normal : normals) {
+        minDot = std::min(minDot, glm::dot(axis, normal));
+    }
+
+
+    // A cone of 90 degrees or wider always has a face pointing at the camera; a zero axis never culls
+    if (minDot <= 0.0f) {
+        return meshlet;
+    }
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+    return meshlet;
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../scene/Model.hpp"
+
+#include <vector>
+
+namespace VulkanViewer {
+
+// Splits a triangle list into meshlets for cluster culling without mesh shaders. Triangles are
+// regrouped so that every meshlet is a contiguous range of the rewritten index buffer.
+class MeshletBuilder {
+public:
+    static constexpr uint32_t MAX_VERTICES = 64;
+    static constexpr uint32_t MAX_TRIANGLES = 124;
+
+    // Grows each meshlet from a seed triangle by adding the neighbour that needs the fewest new
+    // vertices, then reorders `indices` to match the returned meshlets
+    static std::vector<Meshlet> build(const std::vector<Vertex>& vertices, std::vector<uint32_t>& indices,
+                                      uint32_t maxVertices = MAX_VERTICES, uint32_t maxTriangles = MAX_TRIANGLES);
+
+    // Bounding sphere and normal cone of indices[firstIndex, firstIndex + 3 * triangleCount)
+    static Meshlet computeBounds(const std::vector<Vertex>& vertices, const std::vector<uint32_t>& indices,
+                                 uint32_t firstIndex, uint32_t triangleCount);
+};
+
+}
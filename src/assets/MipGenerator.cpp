@@ -0,0 +1,107 @@
+#include "MipGenerator.hpp"
+
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MIP_GENERATOR_SSE2 1
+#endif
+
+namespace VulkanViewer {
+
+namespace {
+
+inline void averageTexels(const uint8_t* a, const uint8_t* b, const uint8_t* c, const uint8_t* d, uint8_t* out) {
+    for (int channel = 0; channel < 4; channel++) {
+        out[channel] = static_cast<uint8_t>((a[channel] + b[channel] + c[channel] + d[channel] + 2) >> 2);
+    }
+}
+
+#ifdef MIP_GENERATOR_SSE2
+// Two output texels from four input texels on each of two rows, with the same rounding as averageTexels
+inline void averageTexelsSSE2(const uint8_t* row0, const uint8_t* row1, uint8_t* out) {
+    const __m128i zero = _mm_setzero_si128();
+    __m128i top = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row0));
+    __m128i bottom = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1));
+
+    // Columns summed as 16-bit lanes: texels 0-1 in `left`, texels 2-3 in `right`
+    __m128i left = _mm_add_epi16(_mm_unpacklo_epi8(top, zero), _mm_unpacklo_epi8(bottom, zero));
+    __m128i right = _mm_add_epi16(_mm_unpackhi_epi8(top, zero), _mm_unpackhi_epi8(bottom, zero));
+    left = _mm_add_epi16(left, _mm_srli_si128(left, 8));
+    right = _mm_add_epi16(right, _mm_srli_si128(right, 8));
+
+    __m128i sum = _mm_unpacklo_epi64(left, right);
+    sum = _mm_srli_epi16(_mm_add_epi16(sum, _mm_set1_epi16(2)), 2);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(sum, zero));
+}
+#endif
+
+}
+
+uint32_t MipGenerator::levelCount(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+        levels++;
+    }
+    return levels;
+}
+
+size_t MipGenerator::chainSize(uint32_t width, uint32_t height, uint32_t levels) {
+    size_t bytes = 0;
+    for (uint32_t level = 0; level < levels; level++) {
+        bytes += static_cast<size_t>(width) * height * 4;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    return bytes;
+}
+
+void MipGenerator::generate(DecodedTexture& texture) {
+    uint32_t levels = levelCount(texture.width, texture.height);
+    if (texture.width == 0 || texture.height == 0 || texture.mipLevels >= levels ||
+        texture.pixels.size() != chainSize(texture.width, texture.height, texture.mipLevels)) {
+        return;
+    }
+
+    size_t offset = chainSize(texture.width, texture.height, texture.mipLevels - 1);
+    texture.pixels.resize(chainSize(texture.width, texture.height, levels));
+    uint32_t width = std::max(texture.width >> (texture.mipLevels - 1), 1u);
+    uint32_t height = std::max(texture.height >> (texture.mipLevels - 1), 1u);
+    for (uint32_t level = texture.mipLevels; level < levels; level++) {
+        size_t levelBytes = static_cast<size_t>(width) * height * 4;
+        downsample(texture.pixels.data() + offset, width, height, texture.pixels.data() + offset + levelBytes);
+        offset += levelBytes;
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    texture.mipLevels = levels;
+}
+
+void MipGenerator::downsample(const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst) {
+    uint32_t dstWidth = std::max(width / 2, 1u);
+    uint32_t dstHeight = std::max(height / 2, 1u);
+    size_t rowBytes = static_cast<size_t>(width) * 4;
+
+    for (uint32_t y = 0; y < dstHeight; y++) {
+        const uint8_t* row0 = src + std::min(y * 2, height - 1) * rowBytes;
+        const uint8_t* row1 = src + std::min(y * 2 + 1, height - 1) * rowBytes;
+        uint8_t* out = dst + static_cast<size_t>(y) * dstWidth * 4;
+
+        uint32_t x = 0;
+#ifdef MIP_GENERATOR_SSE2
+        // Only whole pairs; an odd last column falls through to the scalar loop below
+        if (width >= 2) {
+            for (; x + 2 <= width / 2; x += 2) {
+                averageTexelsSSE2(row0 + x * 8, row1 + x * 8, out + x * 4);
+            }
+        }
+#endif
+        for (; x < dstWidth; x++) {
+            uint32_t x0 = std::min(x * 2, width - 1);
+            uint32_t x1 = std::min(x * 2 + 1, width - 1);
+            averageTexels(row0 + x0 * 4, row0 + x1 * 4, row1 + x0 * 4, row1 + x1 * 4, out + x * 4);
+        }
+    }
+}
+
+}
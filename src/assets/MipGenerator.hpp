@@ -0,0 +1,28 @@
+#pragma once
+
+#include "../scene/Model.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace VulkanViewer {
+
+// CPU mip chains for RGBA8 textures, used when the GPU cannot blit the format with linear
+// filtering. Each level is a 2x2 box filter of the one above, the same footprint a halving
+// linear blit samples, so both paths produce matching chains. Odd edges repeat the last texel.
+class MipGenerator {
+public:
+    // Levels in a full chain down to 1x1
+    static uint32_t levelCount(uint32_t width, uint32_t height);
+
+    // Bytes of a tightly packed RGBA8 chain with `levels` levels, level 0 first
+    static size_t chainSize(uint32_t width, uint32_t height, uint32_t levels);
+
+    // Appends the missing levels after the pixels already in `texture`
+    static void generate(DecodedTexture& texture);
+
+    // One level: `dst` has to hold max(width / 2, 1) * max(height / 2, 1) texels
+    static void downsample(const uint8_t* src, uint32_t width, uint32_t height, uint8_t* dst);
+};
+
+}
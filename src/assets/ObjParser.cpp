@@ -0,0 +1,737 @@
+#include "ObjParser.hpp"
+#include "../core/MappedFile.hpp"
+#include "../core/ThreadPool.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <unordered_map>
+
+namespace VulkanViewer {
+
+namespace {
+
+constexpr uint32_t NO_INDEX = UINT32_MAX;
+constexpr size_t MIN_CHUNK_BYTES = 4 * 1024 * 1024;
+
+struct Corner {
+    uint32_t position;
+    uint32_t texCoord;
+    uint32_t normal;
+};
+
+struct MaterialSwitch {
+    size_t cornerStart;
+    std::string name;
+};
+
+struct Chunk {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+
+    size_t positionCount = 0;
+    size_t texCoordCount = 0;
+    size_t normalCount = 0;
+    size_t positionBase = 0;
+    size_t texCoordBase = 0;
+    size_t normalBase = 0;
+
+    std::vector<Corner> corners;
+    std::vector<MaterialSwitch> materialSwitches;
+    std::vector<std::string> materialLibraries;
+    size_t faceCount = 0;
+    size_t skippedFaces = 0;
+};
+
+struct CornerSpan {
+    const Corner* begin;
+    const Corner* end;
+};
+
+struct MeshGroup {
+    std::string materialName;
+    std::vector<CornerSpan> spans;
+    size_t cornerCount = 0;
+};
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+inline const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) {
+        ++p;
+    }
+    return p;
+}
+
+inline const char* findLineEnd(const char* p, const char* end) {
+    const void* newline = std::memchr(p, '\n', static_cast<size_t>(end - p));
+    return newline ? static_cast<const char*>(newline) : end;
+}
+
+// True if the line starts with `keyword` followed by whitespace; p is moved past the keyword
+inline bool matchKeyword(const char*& p, const char* end, const char* keyword, size_t length) {
+    if (static_cast<size_t>(end - p) <= length || std::memcmp(p, keyword, length) != 0 || !isBlank(p[length])) {
+        return false;
+    }
+    p += length;
+    return true;
+}
+
+inline const char* parseFloat(const char* p, const char* end, float& value) {
+    p = skipBlanks(p, end);
+    if (p < end && *p == '+') {
+        ++p;
+    }
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) {
+        value = 0.0f;
+        return p;
+    }
+    return result.ptr;
+}
+
+inline const char* parseIndex(const char* p, const char* end, int64_t& value) {
+    if (p < end && *p == '+') {
+        ++p;
+    }
+    auto result = std::from_chars(p, end, value);
+    if (result.ec != std::errc()) {
+        value = 0;
+        return p;
+    }
+    return result.ptr;
+}
+
+// OBJ indices are 1-based, negative values count back from the last element defined so far
+inline uint32_t resolveIndex(int64_t index, size_t definedSoFar, size_t total) {
+    int64_t resolved = index > 0 ? index - 1 : static_cast<int64_t>(definedSoFar) + index;
+    if (index == 0 || resolved < 0 || resolved >= static_cast<int64_t>(total)) {
+        return NO_INDEX;
+    }
+    return static_cast<uint32_t>(resolved);
+}
+
+std::string trimmedRest(const char* p, const char* end) {
+    p = skipBlanks(p, end);
+    while (end > p && isBlank(end[-1])) {
+        --end;
+    }
+    return std::string(p, end);
+}
+
+// Calls handler(lineBegin, lineEnd) for every line with the trailing '\r' and leading blanks removed
+template<typename Handler>
+void forEachLine(const char* begin, const char* end, Handler&& handler) {
+    const char* p = begin;
+    while (p < end) {
+        const char* lineEnd = findLineEnd(p, end);
+        const char* contentEnd = lineEnd;
+        if (contentEnd > p && contentEnd[-1] == '\r') {
+            --contentEnd;
+        }
+        const char* lineBegin = skipBlanks(p, contentEnd);
+        if (lineBegin < contentEnd) {
+            handler(lineBegin, contentEnd);
+        }
+        p = lineEnd + 1;
+    }
+}
+
+void countElements(Chunk& chunk) {
+    forEachLine(chunk.begin, chunk.end, [&chunk](const char* p, const char* end) {
+        if (*p != 'v' || end - p < 2) {
+            return;
+        }
+        if (isBlank(p[1])) {
+            chunk.positionCount++;
+        } else if (end - p > 2 && isBlank(p[2])) {
+            if (p[1] == 't') {
+                chunk.texCoordCount++;
+            } else if (p[1] == 'n') {
+                chunk.normalCount++;
+            }
+        }
+    });
+}
+
+void parseChunk(Chunk& chunk, glm::vec3* positions, size_t positionTotal, glm::vec2* texCoords,
+                size_t texCoordTotal, glm::vec3* normals, size_t normalTotal) {
+    size_t positionCursor = chunk.positionBase;
+    size_t texCoordCursor = chunk.texCoordBase;
+    size_t normalCursor = chunk.normalBase;
+    std::vector<Corner> face;
+
+    forEachLine(chunk.begin, chunk.end, [&](const char* p, const char* end) {
+        switch (*p) {
+        case 'v':
+            if (matchKeyword(p, end, "v", 1)) {
+                glm::vec3& position = positions[positionCursor++];
+                p = parseFloat(p, end, position.x);
+                p = parseFloat(p, end, position.y);
+                parseFloat(p, end, position.z);
+            } else if (matchKeyword(p, end, "vt", 2)) {
+                glm::vec2& texCoord = texCoords[texCoordCursor++];
+                p = parseFloat(p, end, texCoord.x);
+                parseFloat(p, end, texCoord.y);
+            } else if (matchKeyword(p, end, "vn", 2)) {
+                glm::vec3& normal = normals[normalCursor++];
+                p = parseFloat(p, end, normal.x);
+                p = parseFloat(p, end, normal.y);
+                parseFloat(p, end, normal.z);
+            }
+            break;
+
+        case 'f': {
+            if (!matchKeyword(p, end, "f", 1)) {
+                break;
+            }
+            face.clear();
+            bool valid = true;
+            while ((p = skipBlanks(p, end)) < end) {
+                int64_t position = 0;
+                int64_t texCoord = 0;
+                int64_t normal = 0;
+                p = parseIndex(p, end, position);
+                if (p < end && *p == '/') {
+                    ++p;
+                    if (p < end && *p != '/') {
+                        p = parseIndex(p, end, texCoord);
+                    }
+                    if (p < end && *p == '/') {
+                        p = parseIndex(p + 1, end, normal);
+                    }
+                }
+                while (p < end && !isBlank(*p)) {
+                    ++p;
+                }
+
+                Corner corner;
+                corner.position = resolveIndex(position, positionCursor, positionTotal);
+                corner.texCoord = texCoord != 0 ? resolveIndex(texCoord, texCoordCursor, texCoordTotal) : NO_INDEX;
+                corner.normal = normal != 0 ? resolveIndex(normal, normalCursor, normalTotal) : NO_INDEX;
+                valid = valid && corner.position != NO_INDEX;
+                face.push_back(corner);
+            }
+
+            if (!valid || face.size() < 3) {
+                chunk.skippedFaces++;
+                break;
+            }
+
+
+            // Polygons are fanned around their first corner
+            for (size_t i = 1; i + 1 < face.size(); i++) {
+                chunk.corners.push_back(face[0]);
+                chunk.corners.push_back(face[i]);
+                chunk.corners.push_back(face[i + 1]);
+            }
+            chunk.faceCount++;
+            break;
+        }
+
+        case 'u':
+            if (matchKeyword(p, end, "usemtl", 6)) {
+                chunk.materialSwitches.push_back({chunk.corners.size(), trimmedRest(p, end)});
+            }
+            break;
+
+        case 'm':
+            if (matchKeyword(p, end, "mtllib", 6)) {
+                chunk.materialLibraries.push_back(trimmedRest(p, end));
+            }
+            break;
+
+        default:
+            break;
+        }
+    });
+}
+
+// Keys are index triples packed into 64 bits, with every field stored as index + 1 so that 0 marks an empty slot
+struct PackedLayout {
+    uint32_t texCoordShift = 0;
+    uint32_t normalShift = 0;
+    bool fits = false;
+
+    uint64_t pack(const Corner& corner) const {
+        return (static_cast<uint64_t>(corner.position) + 1) |
+               (static_cast<uint64_t>(corner.texCoord + 1) << texCoordShift) |
+               (static_cast<uint64_t>(corner.normal + 1) << normalShift);
+    }
+};
+
+uint32_t bitsFor(size_t count) {
+    uint32_t bits = 1;
+    while (bits < 64 && (static_cast<uint64_t>(1) << bits) <= count) {
+        bits++;
+    }
+    return bits;
+}
+
+inline uint64_t mixBits(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    return value;
+}
+
+struct PackedKey {
+    using Key = uint64_t;
+    static Key empty() { return 0; }
+    static uint64_t hash(Key key) { return mixBits(key); }
+    static bool equal(Key a, Key b) { return a == b; }
+};
+
+struct TripleKey {
+    using Key = Corner;
+    static Key empty() { return {NO_INDEX, NO_INDEX, NO_INDEX}; }
+    static uint64_t hash(const Key& key) {
+        return mixBits(key.position ^ (static_cast<uint64_t>(key.texCoord) << 21) ^
+                       (static_cast<uint64_t>(key.normal) << 42) ^ (static_cast<uint64_t>(key.normal) >> 22));
+    }
+    static bool equal(const Key& a, const Key& b) {
+        return a.position == b.position && a.texCoord == b.texCoord && a.normal == b.normal;
+    }
+};
+
+// Open-addressing map from corner key to output vertex index
+template<typename Traits>
+class CornerTable {
+public:
+    using Key = typename Traits::Key;
+
+    explicit CornerTable(size_t expected) {
+        size_t capacity = 64;
+        while (capacity < expected * 2) {
+            capacity <<= 1;
+        }
+        m_keys.assign(capacity, Traits::empty());
+        m_values.resize(capacity);
+    }
+
+    // Returns the stored index, or stores `candidate` and returns it if the key is new
+    uint32_t findOrInsert(const Key& key, uint32_t candidate) {
+        if ((m_size + 1) * 2 > m_keys.size()) {
+            grow();
+        }
+        size_t mask = m_keys.size() - 1;
+        size_t slot = Traits::hash(key) & mask;
+        while (!Traits::equal(m_keys[slot], Traits::empty())) {
+            if (Traits::equal(m_keys[slot], key)) {
+                return m_values[slot];
+            }
+            slot = (slot + 1) & mask;
+        }
+        m_keys[slot] = key;
+        m_values[slot] = candidate;
+        m_size++;
+        return candidate;
+    }
+
+private:
+    void grow() {
+        std::vector<Key> oldKeys = std::move(m_keys);
+        std::vector<uint32_t> oldValues = std::move(m_values);
+        m_keys.assign(oldKeys.size() * 2, Traits::empty());
+        m_values.resize(oldKeys.size() * 2);
+
+        size_t mask = m_keys.size() - 1;
+        for (size_t i = 0; i < oldKeys.size(); i++) {
+            if (Traits::equal(oldKeys[i], Traits::empty())) {
+                continue;
+            }
+            size_t slot = Traits::hash(oldKeys[i]) & mask;
+            while (!Traits::equal(m_keys[slot], Traits::empty())) {
+                slot = (slot + 1) & mask;
+            }
+            m_keys[slot] = oldKeys[i];
+            m_values[slot] = oldValues[i];
+        }
+    }
+
+    std::vector<Key> m_keys;
+    std::vector<uint32_t> m_values;
+    size_t m_size = 0;
+};
+
+template<typename Traits, typename MakeKey>
+void buildMesh(const MeshGroup& group, MakeKey makeKey, const std::vector<glm::vec3>& positions,
+               const std::vector<glm::vec2>& texCoords, const std::vector<glm::vec3>& normals, ObjMesh& mesh) {
+    mesh.materialName = group.materialName;
+    mesh.indices.reserve(group.cornerCount);
+
+
+    // Closed meshes share most corners, so start the table small and let it grow
+    CornerTable<Traits> table(group.cornerCount / 4);
+
+    for (const CornerSpan& span : group.spans) {
+        for (const Corner* corner = span.begin; corner != span.end; ++corner) {
+            uint32_t candidate = static_cast<uint32_t>(mesh.vertices.size());
+            uint32_t index = table.findOrInsert(makeKey(*corner), candidate);
+
+            if (index == candidate) {
+                Vertex vertex{};
+                vertex.pos = positions[corner->position];
+                vertex.normal = corner->normal != NO_INDEX ? normals[corner->normal] : glm::vec3(0.0f, 1.0f, 0.0f);
+                if (corner->texCoord != NO_INDEX) {
+
+                    // Flip V the same way aiProcess_FlipUVs does for the Assimp path
+                    const glm::vec2& texCoord = texCoords[corner->texCoord];
+                    vertex.texCoord = glm::vec2(texCoord.x, 1.0f - texCoord.y);
+                }
+                mesh.vertices.push_back(vertex);
+            }
+            mesh.indices.push_back(index);
+        }
+    }
+}
+
+double millisecondsSince(std::chrono::high_resolution_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+}
+
+bool ObjParser::parse(const std::string& filepath, ObjData& out) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    out = ObjData{};
+
+    MappedFile file;
+    if (!file.open(filepath)) {
+        std::cerr << "Failed to open file: " << filepath << std::endl;
+        return false;
+    }
+    const char* data = reinterpret_cast<const char*>(file.data());
+    const char* dataEnd = data + file.size();
+    out.fileBytes = file.size();
+
+
+    // Chunks end on a newline so no line is split between two workers
+    ThreadPool& pool = ThreadPool::get();
+    size_t maxChunks = (pool.getThreadCount() + 1) * 4;
+    size_t chunkCount = std::max<size_t>(1, std::min(maxChunks, file.size() / MIN_CHUNK_BYTES));
+
+    std::vector<Chunk> chunks;
+    chunks.reserve(chunkCount);
+    const char* chunkBegin = data;
+    for (size_t i = 1; i <= chunkCount && chunkBegin < dataEnd; i++) {
+        const char* chunkEnd = dataEnd;
+        if (i < chunkCount) {
+            const char* target = std::max(chunkBegin, data + file.size() * i / chunkCount);
+            chunkEnd = findLineEnd(target, dataEnd);
+            chunkEnd = chunkEnd < dataEnd ? chunkEnd + 1 : dataEnd;
+        }
+        Chunk chunk;
+        chunk.begin = chunkBegin;
+        chunk.end = chunkEnd;
+        chunks.push_back(std::move(chunk));
+        chunkBegin = chunkEnd;
+    }
+
+
+    // First pass only counts elements, which gives every chunk its write offset into the shared
+    // arrays and lets relative (negative) indices be resolved while parsing
+    pool.parallelFor(chunks.size(), [&chunks](size_t i) {
+        countElements(chunks[i]);
+    });
+
+    size_t positionTotal = 0;
+    size_t texCoordTotal = 0;
+    size_t normalTotal = 0;
+    for (Chunk& chunk : chunks) {
+        chunk.positionBase = positionTotal;
+        chunk.texCoordBase = texCoordTotal;
+        chunk.normalBase = normalTotal;
+        positionTotal += chunk.positionCount;
+        texCoordTotal += chunk.texCoordCount;
+        normalTotal += chunk.normalCount;
+    }
+
+    if (positionTotal == 0) {
+        std::cerr << "No vertices found in OBJ file: " << filepath << std::endl;
+        return false;
+    }
+    if (positionTotal >= NO_INDEX || texCoordTotal >= NO_INDEX || normalTotal >= NO_INDEX) {
+        std::cerr << "OBJ file has too many elements for 32-bit indices: " << filepath << std::endl;
+        return false;
+    }
+
+    std::vector<glm::vec3> positions(positionTotal);
+    std::vector<glm::vec2> texCoords(texCoordTotal);
+    std::vector<glm::vec3> normals(normalTotal);
+
+    pool.parallelFor(chunks.size(), [&](size_t i) {
+        parseChunk(chunks[i], positions.data(), positionTotal, texCoords.data(), texCoordTotal,
+                   normals.data(), normalTotal);
+    });
+    double parseMs = millisecondsSince(startTime);
+
+
+    // Stitch the per-chunk triangle runs into one group per material, in file order
+    std::vector<MeshGroup> groups;
+    std::unordered_map<std::string, size_t> groupByMaterial;
+    size_t currentGroup = SIZE_MAX;
+    auto selectMaterial = [&](const std::string& name) {
+        auto it = groupByMaterial.find(name);
+        if (it == groupByMaterial.end()) {
+            it = groupByMaterial.emplace(name, groups.size()).first;
+            groups.emplace_back();
+            groups.back().materialName = name;
+        }
+        currentGroup = it->second;
+    };
+    auto addSpan = [&](const Chunk& chunk, size_t begin, size_t end) {
+        if (begin == end) {
+            return;
+        }
+        if (currentGroup == SIZE_MAX) {
+            selectMaterial("default");
+        }
+        groups[currentGroup].spans.push_back({chunk.corners.data() + begin, chunk.corners.data() + end});
+        groups[currentGroup].cornerCount += end - begin;
+    };
+
+    for (const Chunk& chunk : chunks) {
+        size_t cursor = 0;
+        for (const MaterialSwitch& materialSwitch : chunk.materialSwitches) {
+            addSpan(chunk, cursor, materialSwitch.cornerStart);
+            selectMaterial(materialSwitch.name);
+            cursor = materialSwitch.cornerStart;
+        }
+        addSpan(chunk, cursor, chunk.corners.size());
+
+        out.materialLibraries.insert(out.materialLibraries.end(), chunk.materialLibraries.begin(),
+                                     chunk.materialLibraries.end());
+        out.faceCount += chunk.faceCount;
+        out.skippedFaces += chunk.skippedFaces;
+    }
+
+    groups.erase(std::remove_if(groups.begin(), groups.end(), [](const MeshGroup& group) {
+        return group.cornerCount == 0;
+    }), groups.end());
+
+    if (groups.empty()) {
+        std::cerr << "No faces found in OBJ file: " << filepath << std::endl;
+        return false;
+    }
+
+
+    // The 64-bit packed key covers almost every file; fall back to full triples when it cannot
+    PackedLayout layout;
+    uint32_t positionBits = bitsFor(positionTotal + 1);
+    uint32_t texCoordBits = bitsFor(texCoordTotal + 1);
+    uint32_t normalBits = bitsFor(normalTotal + 1);
+    layout.texCoordShift = positionBits;
+    layout.normalShift = positionBits + texCoordBits;
+    layout.fits = positionBits + texCoordBits + normalBits <= 64;
+
+    out.meshes.resize(groups.size());
+    pool.parallelFor(groups.size(), [&](size_t i) {
+        if (layout.fits) {
+            buildMesh<PackedKey>(groups[i], [&layout](const Corner& corner) { return layout.pack(corner); },
+                                 positions, texCoords, normals, out.meshes[i]);
+        } else {
+            buildMesh<TripleKey>(groups[i], [](const Corner& corner) { return corner; },
+                                 positions, texCoords, normals, out.meshes[i]);
+        }
+    });
+
+    out.positionCount = positionTotal;
+    out.parseMs = millisecondsSince(startTime);
+
+    std::cout << "Parsed OBJ " << filepath << " in " << out.parseMs << " ms (parse " << parseMs
+              << " ms, " << chunks.size() << " chunks, " << out.meshes.size() << " meshes)" << std::endl;
+    if (out.skippedFaces > 0) {
+        std::cerr << "WARNING: skipped " << out.skippedFaces << " faces with invalid indices" << std::endl;
+    }
+    return true;
+}
+
+bool ObjParser::parseMaterialLibrary(const std::string& filepath, std::vector<Material>& materials) {
+    std::ifstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open material library: " << filepath << std::endl;
+        return false;
+    }
+
+    Material* current = nullptr;
+    std::string line;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        std::istringstream iss(line);
+        std::string keyword;
+        iss >> keyword;
+
+
+        // Texture statements may carry options (-bm 1.0 ...) before the file name, which comes last
+        auto lastToken = [&iss]() {
+            std::string token;
+            std::string last;
+            while (iss >> token) {
+                last = token;
+            }
+            return last;
+        };
+
+        if (keyword == "newmtl") {
+            materials.emplace_back();
+            current = &materials.back();
+            std::getline(iss >> std::ws, current->name);
+        } else if (!current) {
+            continue;
+        } else if (keyword == "Ka") {
+            iss >> current->ambient.r >> current->ambient.g >> current->ambient.b;
+        } else if (keyword == "Kd") {
+            iss >> current->diffuse.r >> current->diffuse.g >> current->diffuse.b;
+        } else if (keyword == "Ks") {
+            iss >> current->specular.r >> current->specular.g >> current->specular.b;
+        } else if (keyword == "Ns") {
+            iss >> current->shininess;
+        } else if (keyword == "map_Kd") {
+            current->diffuseTexture = lastToken();
+        } else if (keyword == "map_Bump" || keyword == "map_bump" || keyword == "bump" || keyword == "norm") {
+            current->normalTexture = lastToken();
+        } else if (keyword == "map_Ks") {
+            current->specularTexture = lastToken();
+        }
+    }
+    return true;
+}
+
+bool ObjParser::parseLegacy(const std::string& filepath, ObjData& out) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    out = ObjData{};
+
+    std::ifstream file(filepath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open file: " << filepath << std::endl;
+        return false;
+    }
+
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> texCoords;
+
+    ObjMesh mesh;
+    mesh.materialName = "default";
+    std::unordered_map<std::string, uint32_t> uniqueVertices;
+
+    std::string line;
+    while (std::getline(file, line)) {
+        out.fileBytes += line.size() + 1;
+        std::istringstream iss(line);
+        std::string prefix;
+        iss >> prefix;
+
+        if (prefix == "v") {
+            glm::vec3 pos;
+            iss >> pos.x >> pos.y >> pos.z;
+            positions.push_back(pos);
+        } else if (prefix == "vn") {
+            glm::vec3 normal;
+            iss >> normal.x >> normal.y >> normal.z;
+            normals.push_back(normal);
+        } else if (prefix == "vt") {
+            glm::vec2 texCoord;
+            iss >> texCoord.x >> texCoord.y;
+            texCoords.push_back(texCoord);
+        } else if (prefix == "f") {
+            std::string vertexStr;
+            std::vector<std::string> faceVertices;
+            while (iss >> vertexStr) {
+                faceVertices.push_back(vertexStr);
+            }
+            if (faceVertices.size() < 3) {
+                continue;
+            }
+            out.faceCount++;
+
+            for (size_t i = 1; i < faceVertices.size() - 1; i++) {
+                for (size_t j = 0; j < 3; j++) {
+                    size_t idx = (j == 0) ? 0 : i + j - 1;
+                    const std::string& vertex = faceVertices[idx];
+
+                    if (uniqueVertices.count(vertex) == 0) {
+                        uniqueVertices[vertex] = static_cast<uint32_t>(mesh.vertices.size());
+
+                        Vertex v{};
+                        std::istringstream viss(vertex);
+                        std::string posStr, texStr, normalStr;
+                        std::getline(viss, posStr, '/');
+                        std::getline(viss, texStr, '/');
+                        std::getline(viss, normalStr, '/');
+
+                        int posIdx = std::stoi(posStr) - 1;
+                        if (posIdx >= 0 && posIdx < static_cast<int>(positions.size())) {
+                            v.pos = positions[posIdx];
+                        }
+                        if (!texStr.empty()) {
+                            int texIdx = std::stoi(texStr) - 1;
+                            if (texIdx >= 0 && texIdx < static_cast<int>(texCoords.size())) {
+                                v.texCoord = texCoords[texIdx];
+                            }
+                        }
+                        if (!normalStr.empty()) {
+                            int normalIdx = std::stoi(normalStr) - 1;
+                            if (normalIdx >= 0 && normalIdx < static_cast<int>(normals.size())) {
+                                v.normal = normals[normalIdx];
+                            }
+                        } else {
+                            v.normal = glm::vec3(0.0f, 1.0f, 0.0f);
+                        }
+
+                        mesh.vertices.push_back(v);
+                    }
+                    mesh.indices.push_back(uniqueVertices[vertex]);
+                }
+            }
+        }
+    }
+
+    if (mesh.vertices.empty()) {
+        std::cerr << "No vertices found in OBJ file: " << filepath << std::endl;
+        return false;
+    }
+
+    out.positionCount = positions.size();
+    out.meshes.push_back(std::move(mesh));
+    out.parseMs = millisecondsSince(startTime);
+    return true;
+}
+
+void ObjParser::benchmark(const std::string& filepath) {
+    ObjData legacy;
+    ObjData native;
+    if (!parseLegacy(filepath, legacy) || !parse(filepath, native)) {
+        std::cerr << "OBJ benchmark failed: " << filepath << std::endl;
+        return;
+    }
+
+    auto report = [](const char* label, const ObjData& data) {
+        double seconds = std::max(data.parseMs, 0.001) / 1000.0;
+        size_t outputVertices = 0;
+        for (const auto& mesh : data.meshes) {
+            outputVertices += mesh.vertices.size();
+        }
+        std::cout << "  " << label << ": " << data.parseMs << " ms, "
+                  << (data.fileBytes / (1024.0 * 1024.0)) / seconds << " MB/s, "
+                  << data.positionCount / seconds << " vertices/s ("
+                  << data.meshes.size() << " meshes, " << outputVertices << " unique vertices)" << std::endl;
+    };
+
+    std::cout << "OBJ parser benchmark: " << filepath << " (" << (native.fileBytes / (1024.0 * 1024.0))
+              << " MB, " << native.positionCount << " positions, " << native.faceCount << " faces)" << std::endl;
+    report("istringstream", legacy);
+    report("native       ", native);
+    std::cout << "  speedup: " << legacy.parseMs / std::max(native.parseMs, 0.001) << "x" << std::endl;
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "../scene/Model.hpp"
+
+#include <string>
+#include <vector>
+
+namespace VulkanViewer {
+
+struct ObjMesh {
+    std::string materialName;
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+};
+
+struct ObjData {
+    std::vector<ObjMesh> meshes;
+    std::vector<std::string> materialLibraries;
+
+    uint64_t fileBytes = 0;
+    uint64_t positionCount = 0;
+    uint64_t faceCount = 0;
+    uint64_t skippedFaces = 0;
+    double parseMs = 0.0;
+};
+
+// Wavefront OBJ reader. The file is memory-mapped, split into line-aligned chunks that are
+// parsed on the thread pool, and each usemtl group becomes its own mesh.
+class ObjParser {
+public:
+    static bool parse(const std::string& filepath, ObjData& out);
+
+    // Texture names are returned as written in the MTL file, relative to its directory
+    static bool parseMaterialLibrary(const std::string& filepath, std::vector<Material>& materials);
+
+    // The original getline/istringstream reader, kept as the baseline for benchmark()
+    static bool parseLegacy(const std::string& filepath, ObjData& out);
+
+    // Parses the file with both readers and logs MB/s and vertices/s for each
+    static void benchmark(const std::string& filepath);
+};
+
+}
@@ -0,0 +1,218 @@
+#include "TexturePathResolver.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+
+namespace fs = std::filesystem;
+
+namespace VulkanViewer {
+
+namespace {
+
+// Same directories and extensions, in the same order, as the per-candidate search this replaces
+constexpr const char* ROOT_PREFIXES[] = {"", "../textures/", "textures/", "../"};
+constexpr const char* EXTENSIONS[] = {".png", ".jpg", ".jpeg", ".tga", ".bmp"};
+constexpr size_t ROOT_COUNT = sizeof(ROOT_PREFIXES) / sizeof(ROOT_PREFIXES[0]);
+
+std::string toLower(std::string text) {
+    std::transform(text.begin(), text.end(), text.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return text;
+}
+
+std::string normalizeDirectory(const std::string& directory) {
+    std::string normalized = fs::path(directory.empty() ? "." : directory).lexically_normal().generic_string();
+    while (normalized.size() > 1 && normalized.back() == '/') {
+        normalized.pop_back();
+    }
+#ifdef _WIN32
+    normalized = toLower(normalized);
+#endif
+    return normalized;
+}
+
+bool isAbsolutePath(const std::string& path) {
+    return (!path.empty() && path[0] == '/') || (path.size() > 1 && path[1] == ':');
+}
+
+}
+
+const TextureDirectoryIndex::Root* TextureDirectoryIndex::findRoot(const std::string& directory) const {
+    std::string normalized = normalizeDirectory(directory);
+    for (const auto& root : m_roots) {
+        if (root.normalized == normalized) {
+            return &root;
+        }
+    }
+    return nullptr;
+}
+
+std::string TextureDirectoryIndex::resolve(const std::string& textureFilename, TexturePathLookup* lookup) const {
+    TexturePathLookup cost;
+    if (lookup) {
+        *lookup = cost;
+    }
+    if (textureFilename.empty()) {
+        return std::string();
+    }
+
+    std::string name = textureFilename;
+    std::replace(name.begin(), name.end(), '\\', '/');
+    size_t slash = name.find_last_of('/');
+    std::string parent = slash == std::string::npos ? std::string() : name.substr(0, slash + 1);
+    std::string base = slash == std::string::npos ? name : name.substr(slash + 1);
+    bool addExtensions = textureFilename.find_last_of('.') == std::string::npos;
+
+    // The old search opened every root with the name as given, then every root with each extension appended
+    std::vector<std::pair<size_t, const char*>> candidates;
+    for (size_t root = 0; root < ROOT_COUNT; root++) {
+        candidates.emplace_back(root, "");
+    }
+    if (addExtensions) {
+        for (size_t root = 0; root < ROOT_COUNT; root++) {
+            for (const char* extension : EXTENSIONS) {
+                candidates.emplace_back(root, extension);
+            }
+        }
+    }
+
+    auto finish = [&](std::string path, size_t legacyProbes) {
+        cost.probesAvoided = legacyProbes > cost.probes ? static_cast<uint32_t>(legacyProbes - cost.probes) : 0;
+        if (lookup) {
+            *lookup = cost;
+        }
+        return path;
+    };
+
+    for (size_t i = 0; i < candidates.size(); i++) {
+        const Root& root = m_roots[candidates[i].first];
+        std::string file = base + candidates[i].second;
+
+        const Root* directory = parent.empty() ? &root : nullptr;
+        if (!directory && !isAbsolutePath(parent)) {
+            directory = findRoot(root.prefix + parent);
+        }
+        if (directory) {
+            auto it = directory->files.find(toLower(file));
+            if (it != directory->files.end()) {
+                return finish(directory->prefix + it->second, i + 1);
+            }
+        } else if (!isAbsolutePath(parent)) {
+            // A subdirectory nobody indexed; rare enough to just ask the filesystem
+            cost.probes++;
+            std::string path = root.prefix + parent + file;
+            if (std::ifstream(path).good()) {
+                return finish(path, i + 1);
+            }
+        }
+    }
+
+
+    // Paths from the authoring machine rarely exist here; the file name alone often does
+    if (!parent.empty()) {
+        for (size_t i = 0; i < candidates.size(); i++) {
+            const Root& root = m_roots[candidates[i].first];
+            auto it = root.files.find(toLower(base + candidates[i].second));
+            if (it != root.files.end()) {
+                return finish(root.prefix + it->second, candidates.size());
+            }
+        }
+    }
+    return finish(std::string(), candidates.size());
+}
+
+TexturePathResolver& TexturePathResolver::get() {
+    static TexturePathResolver resolver;
+    return resolver;
+}
+
+std::shared_ptr<TextureDirectoryIndex> TexturePathResolver::scan(const std::string& modelDirectory) {
+    auto index = std::make_shared<TextureDirectoryIndex>();
+    index->m_roots.resize(ROOT_COUNT);
+    for (size_t i = 0; i < ROOT_COUNT; i++) {
+        TextureDirectoryIndex::Root& root = index->m_roots[i];
+        root.prefix = modelDirectory + ROOT_PREFIXES[i];
+        root.normalized = normalizeDirectory(root.prefix);
+
+        std::error_code error;
+        fs::path directory(root.prefix.empty() ? "." : root.prefix);
+        if (!fs::is_directory(directory, error)) {
+            continue;
+        }
+        root.exists = true;
+        root.mtime = fs::last_write_time(directory, error);
+
+        // One listing instead of an open per candidate; the first spelling wins when names differ only in case
+        fs::directory_iterator it(directory, error);
+        for (; !error && it != fs::directory_iterator(); it.increment(error)) {
+            std::error_code typeError;
+            if (!it->is_directory(typeError)) {
+                std::string name = it->path().filename().string();
+                root.files.emplace(toLower(name), name);
+            }
+        }
+    }
+    return index;
+}
+
+bool TexturePathResolver::isCurrent(const TextureDirectoryIndex& index) {
+    for (const auto& root : index.m_roots) {
+        std::error_code error;
+        fs::path directory(root.prefix.empty() ? "." : root.prefix);
+        bool exists = fs::is_directory(directory, error);
+        if (exists != root.exists || (exists && fs::last_write_time(directory, error) != root.mtime)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::shared_ptr<const TextureDirectoryIndex> TexturePathResolver::getIndex(const std::string& modelDirectory) {
+    std::string key = normalizeDirectory(modelDirectory);
+    std::shared_ptr<const TextureDirectoryIndex> cached;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_indices.find(key);
+        if (it != m_indices.end()) {
+            cached = it->second;
+        }
+    }
+
+
+    // Validation costs one stat per directory per import, the scan below only runs when something changed
+    if (cached && isCurrent(*cached)) {
+        m_indexHits++;
+        return cached;
+    }
+    std::shared_ptr<const TextureDirectoryIndex> index = scan(modelDirectory);
+    m_directoryScans++;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_indices[key] = index;
+    return index;
+}
+
+void TexturePathResolver::recordLookup(const TexturePathLookup& lookup, bool resolved) {
+    m_lookups++;
+    if (resolved) {
+        m_resolved++;
+    }
+    m_probesAvoided += lookup.probesAvoided;
+}
+
+TexturePathResolverStats TexturePathResolver::getStats() const {
+    TexturePathResolverStats stats;
+    stats.directoryScans = m_directoryScans.load();
+    stats.indexHits = m_indexHits.load();
+    stats.lookups = m_lookups.load();
+    stats.resolved = m_resolved.load();
+    stats.probesAvoided = m_probesAvoided.load();
+    return stats;
+}
+
+void TexturePathResolver::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_indices.clear();
+}
+
+}
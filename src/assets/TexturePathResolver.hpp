@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace VulkanViewer {
+
+struct TexturePathResolverStats {
+    uint64_t directoryScans = 0;
+    uint64_t indexHits = 0;
+    uint64_t lookups = 0;
+    uint64_t resolved = 0;
+    uint64_t probesAvoided = 0;
+};
+
+// Per-lookup cost of a resolve, against the old search that opened every candidate in turn
+struct TexturePathLookup {
+    uint32_t probes = 0;
+    uint32_t probesAvoided = 0;
+};
+
+// Directory listing of the places a model's textures conventionally live, in search order:
+// the model directory, ../textures/, textures/ and the parent directory.
+// Immutable once built, so imports on different threads can share it without locking.
+class TextureDirectoryIndex {
+public:
+    // Empty when nothing matches. Names compare case-insensitively; names with a directory part
+    // the index does not cover fall back to opening the candidates directly.
+    std::string resolve(const std::string& textureFilename, TexturePathLookup* lookup = nullptr) const;
+
+private:
+    friend class TexturePathResolver;
+
+    struct Root {
+        std::string prefix;
+        std::string normalized;
+        std::filesystem::file_time_type mtime{};
+        bool exists = false;
+        // Lowercase file name -> name as stored on disk
+        std::unordered_map<std::string, std::string> files;
+    };
+
+    const Root* findRoot(const std::string& directory) const;
+
+    std::vector<Root> m_roots;
+};
+
+// Process-wide cache of directory indices, so every import from the same directory shares one scan
+class TexturePathResolver {
+public:
+    static TexturePathResolver& get();
+
+    // Scanned on first use; rescanned when one of the directories has changed since
+    std::shared_ptr<const TextureDirectoryIndex> getIndex(const std::string& modelDirectory);
+
+    void recordLookup(const TexturePathLookup& lookup, bool resolved);
+
+    TexturePathResolverStats getStats() const;
+    void clear();
+
+private:
+    TexturePathResolver() = default;
+
+    static std::shared_ptr<TextureDirectoryIndex> scan(const std::string& modelDirectory);
+    static bool isCurrent(const TextureDirectoryIndex& index);
+
+    std::mutex m_mutex;
+    std::unordered_map<std::string, std::shared_ptr<const TextureDirectoryIndex>> m_indices;
+
+    std::atomic<uint64_t> m_directoryScans{0};
+    std::atomic<uint64_t> m_indexHits{0};
+    std::atomic<uint64_t> m_lookups{0};
+    std::atomic<uint64_t> m_resolved{0};
+    std::atomic<uint64_t> m_probesAvoided{0};
+};
+
+}
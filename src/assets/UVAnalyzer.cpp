@@ -0,0 +1,350 @@
+#include "UVAnalyzer.hpp"
+#include "../core/ThreadPool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define UV_ANALYZER_SSE2 1
+#endif
+
+namespace VulkanViewer {
+
+namespace {
+
+constexpr float MIN_EDGE_LENGTH = 0.001f;
+constexpr float SCRAMBLING_THRESHOLD = 0.3f;
+constexpr int CLUSTER_GRID_SIZE = UVStatistics::GRID_SIZE / 2;
+// Clustering sums the same densities in a different order per variant; smaller gaps are ties
+constexpr float TIE_TOLERANCE = 1.0e-4f;
+
+inline int gridCell(float coordinate) {
+    return std::min(UVStatistics::GRID_SIZE - 1, static_cast<int>(coordinate * UVStatistics::GRID_SIZE));
+}
+
+// Same terms as the SSE2 kernel, one triangle at a time; used for tails and invalid indices
+void accumulateTriangle(const Vertex& a, const Vertex& b, const Vertex& c, UVStatistics& stats) {
+    float ab = glm::length(b.texCoord - a.texCoord);
+    float bc = glm::length(c.texCoord - b.texCoord);
+    float ca = glm::length(a.texCoord - c.texCoord);
+    stats.coherenceSum += 1.0f / (1.0f + ab + bc + ca);
+
+    glm::vec2 center = (a.texCoord + b.texCoord + c.texCoord) / 3.0f;
+    stats.spreadSum += glm::length(a.texCoord - center) + glm::length(b.texCoord - center) +
+                       glm::length(c.texCoord - center);
+
+    // Only the first edge, as the original sampled estimate did
+    float geometric = glm::length(b.pos - a.pos);
+    if (geometric > MIN_EDGE_LENGTH && ab > MIN_EDGE_LENGTH) {
+        stats.consistencySum += std::min(geometric / ab, ab / geometric);
+        stats.consistentEdges++;
+    }
+
+    // Imports store V pointing down the image, so an unmirrored mapping winds the UV triangle
+    // against the surface triangle as seen from the vertex normals
+    glm::vec3 ab3 = b.pos - a.pos;
+    glm::vec3 ac3 = c.pos - a.pos;
+    glm::vec3 normal = a.normal + b.normal + c.normal;
+    float facing = (ab3.y * ac3.z - ab3.z * ac3.y) * normal.x + (ab3.z * ac3.x - ab3.x * ac3.z) * normal.y +
+                   (ab3.x * ac3.y - ab3.y * ac3.x) * normal.z;
+    glm::vec2 abUV = b.texCoord - a.texCoord;
+    glm::vec2 acUV = c.texCoord - a.texCoord;
+    float handedness = facing * (abUV.x * acUV.y - abUV.y * acUV.x);
+    stats.unmirroredTriangles += handedness < 0.0f ? 1 : 0;
+    stats.mirroredTriangles += handedness > 0.0f ? 1 : 0;
+    stats.triangles++;
+}
+
+void accumulateTrianglesScalar(const Vertex* vertices, size_t vertexCount, const uint32_t* indices,
+                               size_t triangleCount, UVStatistics& stats) {
+    for (size_t t = 0; t < triangleCount; t++) {
+        const uint32_t* triangle = indices + t * 3;
+        if (triangle[0] < vertexCount && triangle[1] < vertexCount && triangle[2] < vertexCount) {
+            accumulateTriangle(vertices[triangle[0]], vertices[triangle[1]], vertices[triangle[2]], stats);
+        }
+    }
+}
+
+#ifdef UV_ANALYZER_SSE2
+inline __m128 length2(__m128 x, __m128 y) {
+    return _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)));
+}
+
+inline float horizontalSum(__m128 value) {
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, value);
+    return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+// Four triangles per iteration, one per lane. The corners are gathered from the interleaved vertices;
+// lane sums go to the double totals every few hundred groups so large meshes keep their precision.
+size_t accumulateTrianglesSSE2(const Vertex* vertices, size_t vertexCount, const uint32_t* indices,
+                               size_t triangleCount, UVStatistics& stats) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 third = _mm_set1_ps(1.0f / 3.0f);
+    const __m128 minEdge = _mm_set1_ps(MIN_EDGE_LENGTH);
+    constexpr size_t FLUSH_INTERVAL = 256;
+
+    __m128 coherence = _mm_setzero_ps();
+    __m128 consistency = _mm_setzero_ps();
+    __m128 spread = _mm_setzero_ps();
+    __m128 edges = _mm_setzero_ps();
+    __m128 unmirrored = _mm_setzero_ps();
+    __m128 mirrored = _mm_setzero_ps();
+    size_t groups = 0;
+
+    size_t t = 0;
+    for (; t + 4 <= triangleCount; t += 4) {
+        const uint32_t* group = indices + t * 3;
+        uint32_t maxIndex = *std::max_element(group, group + 12);
+        if (maxIndex >= vertexCount) {
+            accumulateTrianglesScalar(vertices, vertexCount, group, 4, stats);
+            continue;
+        }
+        const Vertex& a0 = vertices[group[0]];
+        const Vertex& b0 = vertices[group[1]];
+        const Vertex& c0 = vertices[group[2]];
+        const Vertex& a1 = vertices[group[3]];
+        const Vertex& b1 = vertices[group[4]];
+        const Vertex& c1 = vertices[group[5]];
+        const Vertex& a2 = vertices[group[6]];
+        const Vertex& b2 = vertices[group[7]];
+        const Vertex& c2 = vertices[group[8]];
+        const Vertex& a3 = vertices[group[9]];
+        const Vertex& b3 = vertices[group[10]];
+        const Vertex& c3 = vertices[group[11]];
+
+        __m128 au = _mm_setr_ps(a0.texCoord.x, a1.texCoord.x, a2.texCoord.x, a3.texCoord.x);
+        __m128 av = _mm_setr_ps(a0.texCoord.y, a1.texCoord.y, a2.texCoord.y, a3.texCoord.y);
+        __m128 bu = _mm_setr_ps(b0.texCoord.x, b1.texCoord.x, b2.texCoord.x, b3.texCoord.x);
+        __m128 bv = _mm_setr_ps(b0.texCoord.y, b1.texCoord.y, b2.texCoord.y, b3.texCoord.y);
+        __m128 cu = _mm_setr_ps(c0.texCoord.x, c1.texCoord.x, c2.texCoord.x, c3.texCoord.x);
+        __m128 cv = _mm_setr_ps(c0.texCoord.y, c1.texCoord.y, c2.texCoord.y, c3.texCoord.y);
+
+        __m128 ab = length2(_mm_sub_ps(bu, au), _mm_sub_ps(bv, av));
+        __m128 bc = length2(_mm_sub_ps(cu, bu), _mm_sub_ps(cv, bv));
+        __m128 ca = length2(_mm_sub_ps(au, cu), _mm_sub_ps(av, cv));
+        coherence = _mm_add_ps(coherence, _mm_div_ps(one, _mm_add_ps(one, _mm_add_ps(_mm_add_ps(ab, bc), ca))));
+
+        __m128 centerU = _mm_mul_ps(_mm_add_ps(_mm_add_ps(au, bu), cu), third);
+        __m128 centerV = _mm_mul_ps(_mm_add_ps(_mm_add_ps(av, bv), cv), third);
+        spread = _mm_add_ps(spread, _mm_add_ps(_mm_add_ps(length2(_mm_sub_ps(au, centerU), _mm_sub_ps(av, centerV)),
+                                                          length2(_mm_sub_ps(bu, centerU), _mm_sub_ps(bv, centerV))),
+                                               length2(_mm_sub_ps(cu, centerU), _mm_sub_ps(cv, centerV))));
+
+        __m128 dx = _mm_setr_ps(b0.pos.x - a0.pos.x, b1.pos.x - a1.pos.x, b2.pos.x - a2.pos.x, b3.pos.x - a3.pos.x);
+        __m128 dy = _mm_setr_ps(b0.pos.y - a0.pos.y, b1.pos.y - a1.pos.y, b2.pos.y - a2.pos.y, b3.pos.y - a3.pos.y);
+        __m128 dz = _mm_setr_ps(b0.pos.z - a0.pos.z, b1.pos.z - a1.pos.z, b2.pos.z - a2.pos.z, b3.pos.z - a3.pos.z);
+        __m128 geometric = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz)));
+
+        // Degenerate lanes divide by zero here; the mask drops their inf and NaN results
+        __m128 mask = _mm_and_ps(_mm_cmpgt_ps(geometric, minEdge), _mm_cmpgt_ps(ab, minEdge));
+        __m128 ratio = _mm_min_ps(_mm_div_ps(geometric, ab), _mm_div_ps(ab, geometric));
+        consistency = _mm_add_ps(consistency, _mm_and_ps(mask, ratio));
+        edges = _mm_add_ps(edges, _mm_and_ps(mask, one));
+
+        __m128 ex = _mm_setr_ps(c0.pos.x - a0.pos.x, c1.pos.x - a1.pos.x, c2.pos.x - a2.pos.x, c3.pos.x - a3.pos.x);
+        __m128 ey = _mm_setr_ps(c0.pos.y - a0.pos.y, c1.pos.y - a1.pos.y, c2.pos.y - a2.pos.y, c3.pos.y - a3.pos.y);
+        __m128 ez = _mm_setr_ps(c0.pos.z - a0.pos.z, c1.pos.z - a1.pos.z, c2.pos.z - a2.pos.z, c3.pos.z - a3.pos.z);
+        __m128 nx = _mm_setr_ps(a0.normal.x + b0.normal.x + c0.normal.x, a1.normal.x + b1.normal.x + c1.normal.x,
+                                a2.normal.x + b2.normal.x + c2.normal.x, a3.normal.x + b3.normal.x + c3.normal.x);
+        __m128 ny = _mm_setr_ps(a0.normal.y + b0.normal.y + c0.normal.y, a1.normal.y + b1.normal.y + c1.normal.y,
+                                a2.normal.y + b2.normal.y + c2.normal.y, a3.normal.y + b3.normal.y + c3.normal.y);
+        __m128 nz = _mm_setr_ps(a0.normal.z + b0.normal.z + c0.normal.z, a1.normal.z + b1.normal.z + c1.normal.z,
+                                a2.normal.z + b2.normal.z + c2.normal.z, a3.normal.z + b3.normal.z + c3.normal.z);
+        __m128 facing = _mm_add_ps(_mm_add_ps(
+            _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(dy, ez), _mm_mul_ps(dz, ey)), nx),
+            _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(dz, ex), _mm_mul_ps(dx, ez)), ny)),
+            _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(dx, ey), _mm_mul_ps(dy, ex)), nz));
+        __m128 uvArea = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(bu, au), _mm_sub_ps(cv, av)),
+                                   _mm_mul_ps(_mm_sub_ps(bv, av), _mm_sub_ps(cu, au)));
+        __m128 handedness = _mm_mul_ps(facing, uvArea);
+        unmirrored = _mm_add_ps(unmirrored, _mm_and_ps(_mm_cmplt_ps(handedness, _mm_setzero_ps()), one));
+        mirrored = _mm_add_ps(mirrored, _mm_and_ps(_mm_cmpgt_ps(handedness, _mm_setzero_ps()), one));
+        stats.triangles += 4;
+
+        if (++groups == FLUSH_INTERVAL) {
+            stats.coherenceSum += horizontalSum(coherence);
+            stats.consistencySum += horizontalSum(consistency);
+            stats.spreadSum += horizontalSum(spread);
+            stats.consistentEdges += static_cast<uint64_t>(horizontalSum(edges));
+            stats.unmirroredTriangles += static_cast<uint64_t>(horizontalSum(unmirrored));
+            stats.mirroredTriangles += static_cast<uint64_t>(horizontalSum(mirrored));
+            coherence = consistency = spread = edges = unmirrored = mirrored = _mm_setzero_ps();
+            groups = 0;
+        }
+    }
+    stats.coherenceSum += horizontalSum(coherence);
+    stats.consistencySum += horizontalSum(consistency);
+    stats.spreadSum += horizontalSum(spread);
+    stats.consistentEdges += static_cast<uint64_t>(horizontalSum(edges));
+    stats.unmirroredTriangles += static_cast<uint64_t>(horizontalSum(unmirrored));
+    stats.mirroredTriangles += static_cast<uint64_t>(horizontalSum(mirrored));
+    return t;
+}
+#endif
+
+}
+
+void UVStatistics::merge(const UVStatistics& other) {
+    coherenceSum += other.coherenceSum;
+    consistencySum += other.consistencySum;
+    spreadSum += other.spreadSum;
+    triangles += other.triangles;
+    consistentEdges += other.consistentEdges;
+    unmirroredTriangles += other.unmirroredTriangles;
+    mirroredTriangles += other.mirroredTriangles;
+    for (int variant = 0; variant < VARIANT_COUNT; variant++) {
+        for (size_t cell = 0; cell < cells[variant].size(); cell++) {
+            cells[variant][cell] += other.cells[variant][cell];
+        }
+    }
+    vertices += other.vertices;
+    validVertices += other.validVertices;
+}
+
+void UVAnalyzer::accumulateTriangles(const Mesh& mesh, size_t firstTriangle, size_t triangleCount,
+                                     UVStatistics& stats, bool simd) {
+    size_t available = mesh.indices.size() / 3;
+    if (firstTriangle >= available) {
+        return;
+    }
+    triangleCount = std::min(triangleCount, available - firstTriangle);
+    const uint32_t* indices = mesh.indices.data() + firstTriangle * 3;
+
+    size_t done = 0;
+#ifdef UV_ANALYZER_SSE2
+    if (simd) {
+        done = accumulateTrianglesSSE2(mesh.vertices.data(), mesh.vertices.size(), indices, triangleCount, stats);
+    }
+#else
+    (void)simd;
+#endif
+    accumulateTrianglesScalar(mesh.vertices.data(), mesh.vertices.size(), indices + done * 3, triangleCount - done, stats);
+}
+
+void UVAnalyzer::accumulateVertices(const Mesh& mesh, size_t firstVertex, size_t vertexCount, UVStatistics& stats) {
+    size_t end = std::min(mesh.vertices.size(), firstVertex + vertexCount);
+    for (size_t i = firstVertex; i < end; i++) {
+        float u = mesh.vertices[i].texCoord.x;
+        float v = mesh.vertices[i].texCoord.y;
+        if (u >= 0.0f && u <= 1.0f && v >= 0.0f && v <= 1.0f) {
+            int u0 = gridCell(u);
+            int u1 = gridCell(1.0f - u);
+            int v0 = gridCell(v);
+            int v1 = gridCell(1.0f - v);
+            stats.cells[0][u0 * UVStatistics::GRID_SIZE + v0]++;
+            stats.cells[1][u0 * UVStatistics::GRID_SIZE + v1]++;
+            stats.cells[2][u1 * UVStatistics::GRID_SIZE + v0]++;
+            stats.cells[3][u1 * UVStatistics::GRID_SIZE + v1]++;
+            stats.validVertices++;
+        }
+    }
+    stats.vertices += end > firstVertex ? end - firstVertex : 0;
+}
+
+UVAnalysis UVAnalyzer::score(const UVStatistics& stats) {
+    UVAnalysis analysis;
+    analysis.triangles = stats.triangles;
+    analysis.vertices = stats.vertices;
+
+    float coherence = stats.triangles ? static_cast<float>(stats.coherenceSum / stats.triangles) : 0.0f;
+    float geometry = stats.consistentEdges ? static_cast<float>(stats.consistencySum / stats.consistentEdges) : 0.0f;
+    float spread = stats.triangles ? static_cast<float>(stats.spreadSum / stats.triangles) : 0.0f;
+    float scrambling = spread > SCRAMBLING_THRESHOLD ? spread : 0.0f;
+    float validRatio = stats.vertices ? static_cast<float>(stats.validVertices) / stats.vertices : 0.0f;
+    uint64_t orientedTriangles = stats.unmirroredTriangles + stats.mirroredTriangles;
+    float unmirroredRatio = orientedTriangles ? static_cast<float>(stats.unmirroredTriangles) / orientedTriangles : 0.5f;
+
+    float bestScore = -1.0f;
+    for (int variant = 0; variant < UVStatistics::VARIANT_COUNT; variant++) {
+        const auto& cells = stats.cells[variant];
+        UVVariantScore& result = analysis.variants[variant];
+        result.coherence = coherence;
+        result.geometry = geometry;
+        result.scrambling = scrambling;
+        result.handedness = (variant == 1 || variant == 2) ? 1.0f - unmirroredRatio : unmirroredRatio;
+
+        // floor(16x) / 2 == floor(8x), so each clustering cell is a 2x2 block of coverage cells
+        int usedCells = 0;
+        int activeClusters = 0;
+        float clusterScore = 0.0f;
+        for (int x = 0; x < CLUSTER_GRID_SIZE; x++) {
+            for (int y = 0; y < CLUSTER_GRID_SIZE; y++) {
+                uint32_t count = 0;
+                for (int cell = 0; cell < 4; cell++) {
+                    uint32_t cellCount = cells[(x * 2 + cell / 2) * UVStatistics::GRID_SIZE + y * 2 + cell % 2];
+                    usedCells += cellCount > 0 ? 1 : 0;
+                    count += cellCount;
+                }
+                if (count > 0 && stats.validVertices > 0) {
+                    float density = static_cast<float>(count) / stats.validVertices;
+                    clusterScore += density * density;
+                    activeClusters++;
+                }
+            }
+        }
+        if (stats.validVertices > 0) {
+            result.clustering = clusterScore - static_cast<float>(activeClusters) / (CLUSTER_GRID_SIZE * CLUSTER_GRID_SIZE) * 0.5f;
+        }
+        result.coverage = static_cast<float>(usedCells) / (UVStatistics::GRID_SIZE * UVStatistics::GRID_SIZE) * validRatio;
+
+        result.total = result.coherence * 0.4f + result.clustering * 0.2f + result.geometry * 0.2f +
+                       result.coverage * 0.1f - result.scrambling * 0.1f + result.handedness * 0.3f;
+        if (variant == 0 || result.total > bestScore + TIE_TOLERANCE) {
+            bestScore = result.total;
+            analysis.bestVariant = variant;
+        }
+    }
+    return analysis;
+}
+
+UVAnalysis UVAnalyzer::analyze(const std::vector<const Mesh*>& meshes) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    struct Chunk {
+        const Mesh* mesh;
+        bool vertices;
+        size_t first;
+        size_t count;
+    };
+    std::vector<Chunk> chunks;
+    for (const Mesh* mesh : meshes) {
+        size_t triangleCount = mesh->indices.size() / 3;
+        for (size_t first = 0; first < triangleCount; first += TRIANGLES_PER_CHUNK) {
+            chunks.push_back({mesh, false, first, std::min(TRIANGLES_PER_CHUNK, triangleCount - first)});
+        }
+        for (size_t first = 0; first < mesh->vertices.size(); first += VERTICES_PER_CHUNK) {
+            chunks.push_back({mesh, true, first, std::min(VERTICES_PER_CHUNK, mesh->vertices.size() - first)});
+        }
+    }
+
+    std::vector<UVStatistics> partial(chunks.size());
+    ThreadPool::get().parallelFor(chunks.size(), [&](size_t i) {
+        const Chunk& chunk = chunks[i];
+        if (chunk.vertices) {
+            accumulateVertices(*chunk.mesh, chunk.first, chunk.count, partial[i]);
+        } else {
+            accumulateTriangles(*chunk.mesh, chunk.first, chunk.count, partial[i]);
+        }
+    });
+
+    UVStatistics total;
+    for (const auto& stats : partial) {
+        total.merge(stats);
+    }
+    UVAnalysis analysis = score(total);
+    analysis.milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    return analysis;
+}
+
+UVTransform UVAnalyzer::orient(const UVTransform& transform, const UVAnalysis& analysis) {
+    bool mirrored = ((transform.scale.x < 0.0f) != (transform.scale.y < 0.0f)) != transform.swap;
+    bool detectedMirrored = analysis.bestVariant == 1 || analysis.bestVariant == 2;
+    return mirrored == detectedMirrored ? transform : transform.flippedV();
+}
+
+}
\ No newline at end of file
@@ -0,0 +1,80 @@
+#pragma once
+
+#include "../scene/Model.hpp"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace VulkanViewer {
+
+// Raw sums from one pass over part of a mesh. Chunks and meshes are merged before scoring.
+struct UVStatistics {
+    static constexpr int VARIANT_COUNT = 4;
+    static constexpr int GRID_SIZE = 16;
+
+    // Reflections keep UV distances, so the triangle terms are the same for every variant
+    double coherenceSum = 0.0;
+    double consistencySum = 0.0;
+    double spreadSum = 0.0;
+    uint64_t triangles = 0;
+    uint64_t consistentEdges = 0;
+
+    // Triangles whose UV winding does / does not mirror their surface winding, for the UVs as stored.
+    // A single U or V flip mirrors every triangle, so variants 1 and 2 see the two counts swapped.
+    uint64_t unmirroredTriangles = 0;
+    uint64_t mirroredTriangles = 0;
+
+    // Vertices inside [0,1]^2 per 16x16 cell, one grid per variant; the 8x8 clustering grid is derived from it
+    std::array<std::array<uint32_t, GRID_SIZE * GRID_SIZE>, VARIANT_COUNT> cells{};
+    uint64_t vertices = 0;
+    uint64_t validVertices = 0;
+
+    void merge(const UVStatistics& other);
+};
+
+struct UVVariantScore {
+    float coherence = 0.0f;
+    float clustering = 0.0f;
+    float geometry = 0.0f;
+    float coverage = 0.0f;
+    float scrambling = 0.0f;
+    // Share of triangles the variant maps without mirroring the texture
+    float handedness = 0.0f;
+    float total = 0.0f;
+};
+
+struct UVAnalysis {
+    std::array<UVVariantScore, UVStatistics::VARIANT_COUNT> variants{};
+    int bestVariant = 0;
+    uint64_t triangles = 0;
+    uint64_t vertices = 0;
+    double milliseconds = 0.0;
+};
+
+// Scores the four UV orientations (as is, V flipped, U flipped, both) of a set of meshes by how
+// coherent, clustered and geometry-consistent each one looks, and by whether it mirrors the texture
+// on the surface. Only the handedness term tells mirrored from unmirrored variants; nothing tells a
+// mapping from its 180 degree rotation, so near ties keep the earlier variant. Every triangle and
+// vertex is read once, in place, for all variants together; large meshes are split into chunks
+// across the thread pool.
+class UVAnalyzer {
+public:
+    static constexpr size_t TRIANGLES_PER_CHUNK = 64 * 1024;
+    static constexpr size_t VERTICES_PER_CHUNK = 128 * 1024;
+
+    static UVAnalysis analyze(const std::vector<const Mesh*>& meshes);
+
+    // One chunk on the calling thread. `simd` picks the SSE2 kernel when it is compiled in.
+    static void accumulateTriangles(const Mesh& mesh, size_t firstTriangle, size_t triangleCount,
+                                    UVStatistics& stats, bool simd = true);
+    static void accumulateVertices(const Mesh& mesh, size_t firstVertex, size_t vertexCount, UVStatistics& stats);
+
+    static UVAnalysis score(const UVStatistics& stats);
+
+    // `transform` with one V flip added when its mirroring disagrees with the best variant.
+    // Scale, offset and swap are kept.
+    static UVTransform orient(const UVTransform& transform, const UVAnalysis& analysis);
+};
+
+}
@@ -0,0 +1,140 @@
+#include "VertexWelder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace VulkanViewer {
+
+namespace {
+
+constexpr uint32_t END_OF_CHAIN = UINT32_MAX;
+
+inline uint64_t mixBits(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdull;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+inline uint64_t hashVertexBits(const Vertex& vertex) {
+    uint32_t words[sizeof(Vertex) / sizeof(uint32_t)];
+    std::memcpy(words, &vertex, sizeof(Vertex));
+
+    uint64_t hash = 0;
+    for (uint32_t word : words) {
+        hash = mixBits(hash ^ word);
+    }
+    return hash;
+}
+
+inline int64_t cellCoordinate(float value, double inverseCellSize) {
+    double scaled = static_cast<double>(value) * inverseCellSize;
+    if (!std::isfinite(scaled)) {
+        return 0;
+    }
+    return static_cast<int64_t>(std::floor(std::clamp(scaled, -4.0e18, 4.0e18)));
+}
+
+inline uint64_t hashCell(int64_t x, int64_t y, int64_t z) {
+    return mixBits(static_cast<uint64_t>(x) * 0x9e3779b97f4a7c15ull ^
+                   static_cast<uint64_t>(y) * 0xc2b2ae3d27d4eb4full ^
+                   static_cast<uint64_t>(z) * 0x165667b19e3779f9ull);
+}
+
+inline bool closeTo(const Vertex& a, const Vertex& b, float epsilon) {
+    return std::abs(a.pos.x - b.pos.x) <= epsilon && std::abs(a.pos.y - b.pos.y) <= epsilon &&
+           std::abs(a.pos.z - b.pos.z) <= epsilon &&
+           std::abs(a.normal.x - b.normal.x) <= epsilon && std::abs(a.normal.y - b.normal.y) <= epsilon &&
+           std::abs(a.normal.z - b.normal.z) <= epsilon &&
+           std::abs(a.texCoord.x - b.texCoord.x) <= epsilon && std::abs(a.texCoord.y - b.texCoord.y) <= epsilon;
+}
+
+}
+
+size_t VertexWelder::weld(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float epsilon) {
+    if (vertices.empty()) {
+        return 0;
+    }
+
+    std::vector<Vertex> welded;
+    welded.reserve(vertices.size());
+    std::vector<uint32_t> remap(vertices.size());
+
+
+    // Bucket heads point at the newest welded vertex in that bucket, `next` chains the older ones
+    std::unordered_map<uint64_t, uint32_t> buckets;
+    buckets.reserve(vertices.size());
+    std::vector<uint32_t> next;
+    next.reserve(vertices.size());
+
+    auto insert = [&](uint64_t bucket, const Vertex& vertex) {
+        uint32_t index = static_cast<uint32_t>(welded.size());
+        auto result = buckets.emplace(bucket, index);
+        next.push_back(result.second ? END_OF_CHAIN : result.first->second);
+        result.first->second = index;
+        welded.push_back(vertex);
+        return index;
+    };
+
+    if (epsilon <= 0.0f) {
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const Vertex& vertex = vertices[i];
+            uint64_t bucket = hashVertexBits(vertex);
+
+            uint32_t match = END_OF_CHAIN;
+            auto it = buckets.find(bucket);
+            for (uint32_t candidate = it != buckets.end() ? it->second : END_OF_CHAIN;
+                 candidate != END_OF_CHAIN; candidate = next[candidate]) {
+                if (std::memcmp(&welded[candidate], &vertex, sizeof(Vertex)) == 0) {
+                    match = candidate;
+                    break;
+                }
+            }
+            remap[i] = match != END_OF_CHAIN ? match : insert(bucket, vertex);
+        }
+    } else {
+
+        // Cells are epsilon wide, so any vertex within epsilon sits in one of the 27 surrounding cells
+        double inverseCellSize = 1.0 / static_cast<double>(epsilon);
+
+        for (size_t i = 0; i < vertices.size(); i++) {
+            const Vertex& vertex = vertices[i];
+            int64_t cx = cellCoordinate(vertex.pos.x, inverseCellSize);
+            int64_t cy = cellCoordinate(vertex.pos.y, inverseCellSize);
+            int64_t cz = cellCoordinate(vertex.pos.z, inverseCellSize);
+
+            uint32_t match = END_OF_CHAIN;
+            for (int64_t dz = -1; dz <= 1 && match == END_OF_CHAIN; dz++) {
+                for (int64_t dy = -1; dy <= 1 && match == END_OF_CHAIN; dy++) {
+                    for (int64_t dx = -1; dx <= 1 && match == END_OF_CHAIN; dx++) {
+                        auto it = buckets.find(hashCell(cx + dx, cy + dy, cz + dz));
+                        if (it == buckets.end()) {
+                            continue;
+                        }
+                        for (uint32_t candidate = it->second; candidate != END_OF_CHAIN; candidate = next[candidate]) {
+                            if (closeTo(welded[candidate], vertex, epsilon)) {
+                                match = candidate;
+                                break;
+                            }
+                        }
+                    }
+                }
+            }
+            remap[i] = match != END_OF_CHAIN ? match : insert(hashCell(cx, cy, cz), vertex);
+        }
+    }
+
+    for (auto& index : indices) {
+        index = index < remap.size() ? remap[index] : 0;
+    }
+
+    size_t removed = vertices.size() - welded.size();
+    vertices.swap(welded);
+    return removed;
+}
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "../scene/Model.hpp"
+
+#include <vector>
+
+namespace VulkanViewer {
+
+// Merges duplicate vertices and rewrites the index buffer to match. With an epsilon of 0
+// only bit-identical vertices are merged; otherwise position, normal and UV all have to
+// agree within epsilon per component. Surviving vertices keep their first-seen order.
+class VertexWelder {
+public:
+    // Returns the number of vertices removed
+    static size_t weld(std::vector<Vertex>& vertices, std::vector<uint32_t>& indices, float epsilon);
+};
+
+}
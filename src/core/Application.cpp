@@ -1,6 +1,7 @@
 #include "Application.hpp"
 #include "VulkanDevice.hpp"
 #include "../rendering/Renderer.hpp"
+#include "../rendering/PipelineLibrary.hpp"
 #include "../ui/UI.hpp"
 #include "../scene/Scene.hpp"
 #include "../scene/Camera.hpp"
@@ -13,7 +14,7 @@
 
 namespace VulkanViewer {
 
-Application::Application() {
+Application::Application() : m_startupTime(std::chrono::high_resolution_clock::now()) {
     initWindow();
     initVulkan();
     initImGui();
@@ -155,6 +156,8 @@ void Application::render() {
         m_framebufferResized = false;
     }
 
+    m_ui->processDeferredActions(*m_scene);
+    
     m_renderer->beginFrame();
     
 
@@ -164,6 +167,16 @@ void Application::render() {
     m_ui->render(*m_scene);
     
     m_renderer->endFrame();
+
+    if (!m_firstFramePresented) {
+        m_firstFramePresented = true;
+        double milliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - m_startupTime).count();
+        PipelineLibraryStats pipelineStats = m_renderer->getPipelineLibrary().getStats();
+        std::cout << "First frame presented " << milliseconds << " ms after startup ("
+                  << (pipelineStats.warmCache ? "warm" : "cold") << " pipeline cache, " << pipelineStats.pipelines
+                  << " pipelines in " << pipelineStats.buildMilliseconds << " ms)" << std::endl;
+    }
 }
 
 void Application::cleanup() {
@@ -210,14 +223,7 @@ void Application::drop_callback(GLFWwindow* window, int count, const char** path
         bool isSupported = std::find(supportedFormats.begin(), supportedFormats.end(), extension) != supportedFormats.end();
         
         if (isSupported) {
-            auto model = std::make_unique<Model>();
-            if (model->loadFromFile(filepath, *app->m_device)) {
-
-                app->m_ui->addLoadedModel(std::move(model));
-                std::cout << "Successfully loaded model to asset browser: " << filepath << std::endl;
-            } else {
-                std::cerr << "Failed to load model: " << filepath << std::endl;
-            }
+            app->m_ui->importModel(filepath);
         } else {
             std::cout << "Unsupported file format: " << extension << std::endl;
             std::cout << "Supported formats: OBJ, FBX, DAE, GLTF, GLB, BLEND, 3DS, PLY, STL, and many more" << std::endl;
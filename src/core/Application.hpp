@@ -4,6 +4,7 @@
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.h>
 
+#include <chrono>
 #include <memory>
 #include <vector>
 #include <string>
@@ -57,6 +58,10 @@ private:
     std::unique_ptr<Scene> m_scene;
 
     float m_lastFrameTime = 0.0f;
+
+    // Startup is measured up to the first present, pipeline compilation included
+    std::chrono::high_resolution_clock::time_point m_startupTime;
+    bool m_firstFramePresented = false;
     
 
     bool m_rightMousePressed = false;
@@ -0,0 +1,163 @@
+#include "ThreadPool.hpp"
+
+#include <atomic>
+#include <algorithm>
+#include <exception>
+
+namespace VulkanViewer {
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+
+    m_workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        m_workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+ThreadPool& ThreadPool::get() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void ThreadPool::enqueue(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_tasks.push(std::move(task));
+    }
+    m_condition.notify_one();
+}
+
+void ThreadPool::workerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+            if (m_stopping && m_tasks.empty()) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop();
+        }
+        task();
+    }
+}
+
+struct ThreadPool::Batch::State {
+    std::function<void(size_t)> body;
+    size_t count = 0;
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> finished{0};
+    std::mutex mutex;
+    std::condition_variable done;
+    std::exception_ptr error;
+
+    void run() {
+        size_t completed = 0;
+        size_t index;
+        while ((index = next.fetch_add(1)) < count) {
+            try {
+                body(index);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            completed++;
+        }
+        if (completed > 0 && finished.fetch_add(completed) + completed == count) {
+            std::lock_guard<std::mutex> lock(mutex);
+            done.notify_all();
+        }
+    }
+};
+
+ThreadPool::Batch& ThreadPool::Batch::operator=(Batch&& other) {
+    if (this != &other) {
+        if (m_state) {
+            try {
+                wait();
+            } catch (...) {
+            }
+        }
+        m_state = std::move(other.m_state);
+    }
+    return *this;
+}
+
+ThreadPool::Batch::~Batch() {
+    // The body usually captures the caller's locals, so it must not outlive this handle
+    if (m_state) {
+        try {
+            wait();
+        } catch (...) {
+        }
+    }
+}
+
+void ThreadPool::Batch::wait() {
+    if (!m_state) {
+        return;
+    }
+    std::shared_ptr<State> state = std::move(m_state);
+    state->run();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->done.wait(lock, [&state]() { return state->finished.load() == state->count; });
+
+    if (state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& body) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1 || m_workers.empty()) {
+        for (size_t i = 0; i < count; i++) {
+            body(i);
+        }
+        return;
+    }
+
+    parallelForAsync(count, body).wait();
+}
+
+ThreadPool::Batch ThreadPool::parallelForAsync(size_t count, std::function<void(size_t)> body) {
+    Batch batch;
+    if (count == 0) {
+        return batch;
+    }
+
+    batch.m_state = std::make_shared<Batch::State>();
+    batch.m_state->body = std::move(body);
+    batch.m_state->count = count;
+
+    size_t helpers = std::min(m_workers.size(), count);
+    for (size_t i = 0; i < helpers; i++) {
+        enqueue([state = batch.m_state]() { state->run(); });
+    }
+    return batch;
+}
+
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <queue>
+#include <mutex>
+#include <condition_variable>
+
+namespace VulkanViewer {
+
+class ThreadPool {
+public:
+    // Handle to a parallelForAsync. wait() first runs the items no worker has started on the
+    // calling thread, so it never blocks on a task still sitting in the queue.
+    class Batch {
+    public:
+        Batch() = default;
+        Batch(Batch&&) = default;
+        Batch& operator=(Batch&& other);
+        ~Batch();
+
+        // Returns once every item ran; rethrows the first exception thrown by the body
+        void wait();
+
+    private:
+        friend class ThreadPool;
+        struct State;
+        std::shared_ptr<State> m_state;
+    };
+
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Process-wide pool sized to the hardware, shared by the import and processing stages
+    static ThreadPool& get();
+
+    template<typename F>
+    auto submit(F&& task) -> std::future<decltype(task())>;
+
+    // Runs body(i) for i in [0, count). The calling thread takes part in the work,
+    // so it is safe to call from inside a pool task.
+    void parallelFor(size_t count, const std::function<void(size_t)>& body);
+
+    // Same as parallelFor without waiting; the work overlaps with the caller until Batch::wait
+    Batch parallelForAsync(size_t count, std::function<void(size_t)> body);
+
+    size_t getThreadCount() const { return m_workers.size(); }
+
+private:
+    void enqueue(std::function<void()> task);
+    void workerLoop();
+
+    std::vector<std::thread> m_workers;
+    std::queue<std::function<void()>> m_tasks;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_stopping = false;
+};
+
+template<typename F>
+auto ThreadPool::submit(F&& task) -> std::future<decltype(task())> {
+    using Result = decltype(task());
+    auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+    std::future<Result> future = packaged->get_future();
+    enqueue([packaged]() { (*packaged)(); });
+    return future;
+}
+
+}
@@ -0,0 +1,443 @@
+#include "UploadBatcher.hpp"
+#include "VulkanDevice.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+
+namespace VulkanViewer {
+
+namespace {
+constexpr VkDeviceSize STAGING_ALIGNMENT = 16;
+// A part takes at most this share of the ring, so the next part can be filled while the GPU reads the last
+constexpr VkDeviceSize PARTS_PER_RING = 4;
+
+VkDeviceSize alignStaging(VkDeviceSize offset) {
+    return (offset + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+}
+
+VkImageMemoryBarrier levelBarrier(VkImage image, uint32_t baseLevel, uint32_t levelCount) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = baseLevel;
+    barrier.subresourceRange.levelCount = levelCount;
+    barrier.subresourceRange.layerCount = 1;
+    return barrier;
+}
+}
+
+UploadBatcher::UploadBatcher(VulkanDevice& device) : m_device(device) {
+}
+
+UploadBatcher::~UploadBatcher() {
+}
+
+void UploadBatcher::enqueueBufferCopy(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset) {
+    if (size == 0) {
+        return;
+    }
+
+    PendingCopy copy{};
+    copy.data = data;
+    copy.size = size;
+    copy.dstBuffer = dstBuffer;
+    copy.dstOffset = dstOffset;
+    m_copies.push_back(copy);
+    m_pendingBytes += size;
+}
+
+void UploadBatcher::enqueueBufferCopy(std::vector<uint8_t>&& data, VkBuffer dstBuffer, VkDeviceSize dstOffset) {
+    if (data.empty()) {
+        return;
+    }
+    m_ownedData.push_back(std::move(data));
+    enqueueBufferCopy(m_ownedData.back().data(), m_ownedData.back().size(), dstBuffer, dstOffset);
+}
+
+void UploadBatcher::enqueueBufferUpdate(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset) {
+    enqueueBufferCopy(data, size, dstBuffer, dstOffset);
+    m_updatesLiveGeometry = m_updatesLiveGeometry || size > 0;
+}
+
+void UploadBatcher::enqueueBufferUpdate(std::vector<uint8_t>&& data, VkBuffer dstBuffer, VkDeviceSize dstOffset) {
+    m_updatesLiveGeometry = m_updatesLiveGeometry || !data.empty();
+    enqueueBufferCopy(std::move(data), dstBuffer, dstOffset);
+}
+
+void UploadBatcher::enqueueImageCopy(const void* data, VkDeviceSize size, VkImage dstImage, uint32_t width, uint32_t height,
+                                     uint32_t mipLevels, bool generateMips) {
+    if (size == 0) {
+        return;
+    }
+
+    PendingImageCopy copy{};
+    copy.data = data;
+    copy.size = size;
+    copy.dstImage = dstImage;
+    copy.width = width;
+    copy.height = height;
+    copy.mipLevels = std::max(mipLevels, 1u);
+    copy.generateMips = generateMips;
+    m_imageCopies.push_back(copy);
+    m_pendingBytes += size;
+}
+
+bool UploadBatcher::finished(const StreamPosition& position) const {
+    return position.copy == m_copies.size() && position.image == m_imageCopies.size();
+}
+
+VkDeviceSize UploadBatcher::remainingStaging(const StreamPosition& position) const {
+    VkDeviceSize bytes = 0;
+    for (size_t i = position.copy; i < m_copies.size(); i++) {
+        bytes += m_copies[i].size + STAGING_ALIGNMENT;
+    }
+    if (position.copy < m_copies.size()) {
+        bytes -= position.copyOffset;
+    }
+
+    for (size_t i = position.image; i < m_imageCopies.size(); i++) {
+        const PendingImageCopy& copy = m_imageCopies[i];
+        uint32_t uploadedLevels = copy.generateMips ? 1 : copy.mipLevels;
+        for (uint32_t level = (i == position.image ? position.level : 0); level < uploadedLevels; level++) {
+            VkDeviceSize rowBytes = static_cast<VkDeviceSize>(std::max(copy.width >> level, 1u)) * 4;
+            uint32_t rows = std::max(copy.height >> level, 1u);
+            if (i == position.image && level == position.level) {
+                rows -= position.row;
+            }
+            bytes += rowBytes * rows + STAGING_ALIGNMENT;
+        }
+    }
+    return bytes;
+}
+
+void UploadBatcher::recordBegin(VkCommandBuffer commandBuffer) {
+
+    // Same queue as the frames, so this barrier waits for the vertex fetches of every frame submitted
+    // before it. Only the write has to wait for the reads; no memory needs to be made visible yet.
+    if (m_updatesLiveGeometry) {
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 0, nullptr);
+    }
+    if (m_imageCopies.empty()) {
+        return;
+    }
+
+
+    // Layouts persist across submissions on one queue, so later parts copy into TRANSFER_DST as well
+    std::vector<VkImageMemoryBarrier> barriers;
+    barriers.reserve(m_imageCopies.size());
+    for (const auto& copy : m_imageCopies) {
+        VkImageMemoryBarrier barrier = levelBarrier(copy.dstImage, 0, copy.mipLevels);
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barriers.push_back(barrier);
+    }
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+VkDeviceSize UploadBatcher::stagePart(VkCommandBuffer commandBuffer, const StagingRegion& staging, StreamPosition& position) {
+    char* mapped = static_cast<char*>(staging.data);
+    VkDeviceSize used = 0;
+    VkDeviceSize staged = 0;
+
+
+    // One vkCmdCopyBuffer per destination with all of its regions; copies were sorted by destination
+    std::vector<VkBufferCopy> regions;
+    VkBuffer regionsBuffer = VK_NULL_HANDLE;
+    auto copyRegions = [&]() {
+        if (!regions.empty()) {
+            vkCmdCopyBuffer(commandBuffer, staging.buffer, regionsBuffer, static_cast<uint32_t>(regions.size()), regions.data());
+            regions.clear();
+        }
+    };
+
+    while (position.copy < m_copies.size()) {
+        const PendingCopy& copy = m_copies[position.copy];
+        VkDeviceSize offset = alignStaging(used);
+        if (offset >= staging.size) {
+            break;
+        }
+
+        // Buffer copies have no alignment rules, so an oversize one is simply cut where the part ends
+        VkDeviceSize size = std::min(copy.size - position.copyOffset, staging.size - offset);
+        memcpy(mapped + offset, static_cast<const char*>(copy.data) + position.copyOffset, static_cast<size_t>(size));
+
+        if (copy.dstBuffer != regionsBuffer) {
+            copyRegions();
+            regionsBuffer = copy.dstBuffer;
+        }
+        VkBufferCopy region{};
+        region.srcOffset = staging.offset + offset;
+        region.dstOffset = copy.dstOffset + position.copyOffset;
+        region.size = size;
+        regions.push_back(region);
+
+        used = offset + size;
+        staged += size;
+        position.copyOffset += size;
+        if (position.copyOffset == copy.size) {
+            position.copy++;
+            position.copyOffset = 0;
+        }
+    }
+    copyRegions();
+
+
+    // Images are cut into bands of whole rows, one region per band, one copy command per image and part
+    std::vector<VkBufferImageCopy> imageRegions;
+    while (position.image < m_imageCopies.size()) {
+        const PendingImageCopy& copy = m_imageCopies[position.image];
+        uint32_t width = std::max(copy.width >> position.level, 1u);
+        uint32_t height = std::max(copy.height >> position.level, 1u);
+        VkDeviceSize rowBytes = static_cast<VkDeviceSize>(width) * 4;
+
+        VkDeviceSize offset = alignStaging(used);
+        uint32_t rows = 0;
+        if (offset < staging.size) {
+            rows = static_cast<uint32_t>(std::min<VkDeviceSize>(height - position.row, (staging.size - offset) / rowBytes));
+        }
+        if (rows == 0) {
+            break;
+        }
+
+        VkDeviceSize size = rowBytes * rows;
+        memcpy(mapped + offset, static_cast<const char*>(copy.data) + position.levelOffset + rowBytes * position.row,
+               static_cast<size_t>(size));
+
+        VkBufferImageCopy region{};
+        region.bufferOffset = staging.offset + offset;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = position.level;
+        region.imageSubresource.layerCount = 1;
+        region.imageOffset = {0, static_cast<int32_t>(position.row), 0};
+        region.imageExtent = {width, rows, 1};
+        imageRegions.push_back(region);
+
+        used = offset + size;
+        staged += size;
+        position.row += rows;
+        if (position.row < height) {
+            continue;
+        }
+
+        position.row = 0;
+        position.levelOffset += rowBytes * height;
+        position.level++;
+        uint32_t uploadedLevels = copy.generateMips ? 1 : copy.mipLevels;
+        if (position.level == uploadedLevels) {
+            vkCmdCopyBufferToImage(commandBuffer, staging.buffer, copy.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                   static_cast<uint32_t>(imageRegions.size()), imageRegions.data());
+            imageRegions.clear();
+            position.image++;
+            position.level = 0;
+            position.levelOffset = 0;
+        }
+    }
+    if (!imageRegions.empty()) {
+        vkCmdCopyBufferToImage(commandBuffer, staging.buffer, m_imageCopies[position.image].dstImage,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                               static_cast<uint32_t>(imageRegions.size()), imageRegions.data());
+    }
+    return staged;
+}
+
+void UploadBatcher::recordImageFinish(VkCommandBuffer commandBuffer, std::vector<VkImageMemoryBarrier>* acquires) {
+    std::vector<VkImageMemoryBarrier> barriers;
+    barriers.reserve(m_imageCopies.size() * 2);
+    uint32_t blitLevels = 1;
+    for (const auto& copy : m_imageCopies) {
+        if (copy.generateMips) {
+            blitLevels = std::max(blitLevels, copy.mipLevels);
+        }
+    }
+
+
+    // Blit chains run level by level across all images, so each step is one barrier call for the whole batch
+    for (uint32_t level = 1; level < blitLevels; level++) {
+        barriers.clear();
+        for (const auto& copy : m_imageCopies) {
+            if (copy.generateMips && level < copy.mipLevels) {
+                VkImageMemoryBarrier barrier = levelBarrier(copy.dstImage, level - 1, 1);
+                barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+                barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+                barriers.push_back(barrier);
+            }
+        }
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+        for (const auto& copy : m_imageCopies) {
+            if (!copy.generateMips || level >= copy.mipLevels) {
+                continue;
+            }
+            VkImageBlit blit{};
+            blit.srcOffsets[1] = {static_cast<int32_t>(std::max(copy.width >> (level - 1), 1u)),
+                                  static_cast<int32_t>(std::max(copy.height >> (level - 1), 1u)), 1};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = level - 1;
+            blit.srcSubresource.layerCount = 1;
+            blit.dstOffsets[1] = {static_cast<int32_t>(std::max(copy.width >> level, 1u)),
+                                  static_cast<int32_t>(std::max(copy.height >> level, 1u)), 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = level;
+            blit.dstSubresource.layerCount = 1;
+            vkCmdBlitImage(commandBuffer, copy.dstImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                           copy.dstImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+        }
+    }
+
+
+    // Blitted images have every level but the last in TRANSFER_SRC; everything ends up shader-readable
+    barriers.clear();
+    for (const auto& copy : m_imageCopies) {
+        uint32_t sourceLevels = copy.generateMips ? copy.mipLevels - 1 : 0;
+        if (sourceLevels > 0) {
+            VkImageMemoryBarrier barrier = levelBarrier(copy.dstImage, 0, sourceLevels);
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            barriers.push_back(barrier);
+        }
+        VkImageMemoryBarrier barrier = levelBarrier(copy.dstImage, sourceLevels, copy.mipLevels - sourceLevels);
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barriers.push_back(barrier);
+    }
+    if (!acquires) {
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+        return;
+    }
+
+
+    // Recorded on the transfer family: the same barriers release the images to the graphics family,
+    // which repeats them as acquires before its first draw. Layouts change once, between the two.
+    for (auto& barrier : barriers) {
+        barrier.srcQueueFamilyIndex = m_device.getTransferQueueFamily();
+        barrier.dstQueueFamilyIndex = m_device.getQueueFamilies().graphicsFamily.value();
+        acquires->push_back(barrier);
+        acquires->back().srcAccessMask = 0;
+        barrier.dstAccessMask = 0;
+    }
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
+void UploadBatcher::recordEnd(VkCommandBuffer commandBuffer, std::vector<VkImageMemoryBarrier>* acquires) {
+    if (!m_imageCopies.empty()) {
+        recordImageFinish(commandBuffer, acquires);
+    }
+
+    if (m_updatesLiveGeometry) {
+        VkMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                             0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+UploadTicket UploadBatcher::stream(bool async, bool graphicsQueue, std::vector<VkImageMemoryBarrier>* acquires,
+                                   UploadStats& stats) {
+    std::stable_sort(m_copies.begin(), m_copies.end(), [](const PendingCopy& a, const PendingCopy& b) {
+        return std::less<VkBuffer>()(a.dstBuffer, b.dstBuffer);
+    });
+
+    VkDeviceSize maxPartSize = m_device.getStagingCapacity() / PARTS_PER_RING;
+    UploadTicket ticket = 0;
+    StreamPosition position;
+    while (!finished(position)) {
+        bool firstPart = stats.submissions == 0;
+        StagingRegion staging = m_device.allocateStaging(std::min(remainingStaging(position), maxPartSize), STAGING_ALIGNMENT);
+
+        VkCommandBuffer commandBuffer = async ? m_device.beginUploadCommands(graphicsQueue) : m_device.beginSingleTimeCommands();
+        if (firstPart) {
+            recordBegin(commandBuffer);
+        }
+        stats.bytes += stagePart(commandBuffer, staging, position);
+        if (finished(position)) {
+            recordEnd(commandBuffer, acquires);
+        }
+
+
+        // Parts of one batch run in order on one queue, so the barriers of the first and last part cover them all
+        if (async) {
+            ticket = m_device.submitUploadCommands(commandBuffer, graphicsQueue);
+        } else {
+            m_device.endSingleTimeCommands(commandBuffer);
+        }
+        m_device.releaseStaging(staging, ticket);
+        stats.submissions++;
+    }
+    return ticket;
+}
+
+void UploadBatcher::reset(UploadStats& stats, std::chrono::high_resolution_clock::time_point startTime) {
+    stats.copies = static_cast<uint32_t>(m_copies.size() + m_imageCopies.size());
+    stats.milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+
+    m_copies.clear();
+    m_imageCopies.clear();
+    m_ownedData.clear();
+    m_pendingBytes = 0;
+    m_updatesLiveGeometry = false;
+}
+
+bool UploadBatcher::generatesMips() const {
+    return std::any_of(m_imageCopies.begin(), m_imageCopies.end(),
+                       [](const PendingImageCopy& copy) { return copy.generateMips && copy.mipLevels > 1; });
+}
+
+UploadStats UploadBatcher::flush() {
+    UploadStats stats;
+    if (empty()) {
+        return stats;
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    stream(false, false, nullptr, stats);
+    reset(stats, startTime);
+    return stats;
+}
+
+UploadTicket UploadBatcher::submit(UploadStats& stats) {
+    stats = UploadStats();
+    if (empty()) {
+        return 0;
+    }
+
+
+    // A transfer-only queue cannot blit, and live geometry has to stay ordered after the frames drawing
+    // from it. Such batches go to the graphics queue instead, still on the upload timeline; images
+    // filled there need no ownership transfer.
+    bool dedicatedQueue = m_device.hasDedicatedTransferQueue();
+    bool graphicsQueue = dedicatedQueue && (m_updatesLiveGeometry || generatesMips());
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    std::vector<VkImageMemoryBarrier> acquires;
+    UploadTicket ticket = stream(true, graphicsQueue, dedicatedQueue && !graphicsQueue ? &acquires : nullptr, stats);
+    for (const auto& acquire : acquires) {
+        m_device.addUploadAcquire(ticket, acquire);
+    }
+
+    reset(stats, startTime);
+    return ticket;
+}
+
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include "VulkanDevice.hpp"
+
+#include <chrono>
+#include <vector>
+
+namespace VulkanViewer {
+
+struct UploadStats {
+    VkDeviceSize bytes = 0;
+    uint32_t copies = 0;
+    uint32_t submissions = 0;
+    double milliseconds = 0.0;
+};
+
+// Collects buffer and image uploads and streams them through the device's staging ring, either
+// blocking on a fence or asynchronously on the transfer queue. Batches that do not fit one ring
+// region are cut into several submissions; single copies are split by byte range or image rows.
+class UploadBatcher {
+public:
+    explicit UploadBatcher(VulkanDevice& device);
+    ~UploadBatcher();
+
+    UploadBatcher(const UploadBatcher&) = delete;
+    UploadBatcher& operator=(const UploadBatcher&) = delete;
+
+    // The source data is read during flush(), so it has to stay alive until then
+    void enqueueBufferCopy(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+
+    // Same as above for data produced just for the upload; the batcher keeps it alive until flush()
+    void enqueueBufferCopy(std::vector<uint8_t>&& data, VkBuffer dstBuffer, VkDeviceSize dstOffset = 0);
+
+    // Copies into vertex or index ranges that frames already submitted may still be drawing from.
+    // flush() then orders the batch after those draws on the graphics queue instead of needing a waitIdle.
+    void enqueueBufferUpdate(const void* data, VkDeviceSize size, VkBuffer dstBuffer, VkDeviceSize dstOffset);
+    void enqueueBufferUpdate(std::vector<uint8_t>&& data, VkBuffer dstBuffer, VkDeviceSize dstOffset);
+
+    // Tightly packed RGBA8 pixels for a single-layer color image, level 0 first. With generateMips
+    // only level 0 is read and the rest is blitted from it, which needs TRANSFER_SRC usage and a
+    // format with linear filter support. Every level goes from UNDEFINED to SHADER_READ_ONLY_OPTIMAL
+    // inside the batch; `data` has to stay alive until flush().
+    void enqueueImageCopy(const void* data, VkDeviceSize size, VkImage dstImage, uint32_t width, uint32_t height,
+                          uint32_t mipLevels = 1, bool generateMips = false);
+
+    bool empty() const { return m_copies.empty() && m_imageCopies.empty(); }
+    VkDeviceSize getPendingBytes() const { return m_pendingBytes; }
+
+    // Blocks until the batch has landed; runs on the graphics queue
+    UploadStats flush();
+
+    // Returns as soon as the batch is queued on the device's transfer queue. Draws may only use the
+    // data once the ticket completes (VulkanDevice::recordUploadAcquires). Buffer destinations have to
+    // be shared with the transfer queue. Live geometry updates and GPU mip generation cannot use a
+    // dedicated transfer queue; they are queued on the graphics queue and signal the same timeline.
+    UploadTicket submit(UploadStats& stats);
+
+private:
+    struct PendingCopy {
+        const void* data;
+        VkDeviceSize size;
+        VkBuffer dstBuffer;
+        VkDeviceSize dstOffset;
+    };
+
+    struct PendingImageCopy {
+        const void* data;
+        VkDeviceSize size;
+        VkImage dstImage;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevels;
+        bool generateMips;
+    };
+
+    // How far the batch has been staged: a byte offset into a buffer copy, then a row of an image level
+    struct StreamPosition {
+        size_t copy = 0;
+        VkDeviceSize copyOffset = 0;
+        size_t image = 0;
+        uint32_t level = 0;
+        uint32_t row = 0;
+        VkDeviceSize levelOffset = 0;
+    };
+
+    bool generatesMips() const;
+    bool finished(const StreamPosition& position) const;
+    // Upper bound on the ring space the rest of the batch needs, alignment padding included
+    VkDeviceSize remainingStaging(const StreamPosition& position) const;
+
+    // With `async` every part goes to the transfer queue, or the graphics queue with `graphicsQueue`,
+    // and the last part's ticket is returned; otherwise each part is waited for on the graphics queue
+    UploadTicket stream(bool async, bool graphicsQueue, std::vector<VkImageMemoryBarrier>* acquires, UploadStats& stats);
+    // Copies as much of the batch as fits into `staging` and records the copies out of it
+    VkDeviceSize stagePart(VkCommandBuffer commandBuffer, const StagingRegion& staging, StreamPosition& position);
+    // Barriers that open the batch in its first part and close it in its last
+    void recordBegin(VkCommandBuffer commandBuffer);
+    // With `acquires` the images are released to the graphics family and the matching acquires returned
+    void recordEnd(VkCommandBuffer commandBuffer, std::vector<VkImageMemoryBarrier>* acquires);
+    void recordImageFinish(VkCommandBuffer commandBuffer, std::vector<VkImageMemoryBarrier>* acquires);
+    void reset(UploadStats& stats, std::chrono::high_resolution_clock::time_point startTime);
+
+    VulkanDevice& m_device;
+    std::vector<PendingCopy> m_copies;
+    std::vector<PendingImageCopy> m_imageCopies;
+    std::vector<std::vector<uint8_t>> m_ownedData;
+    VkDeviceSize m_pendingBytes = 0;
+    bool m_updatesLiveGeometry = false;
+};
+
+}
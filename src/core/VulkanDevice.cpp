@@ -1,8 +1,10 @@
+#define VMA_IMPLEMENTATION
 #include "VulkanDevice.hpp"
 #include <iostream>
 #include <stdexcept>
 #include <set>
 #include <algorithm>
+#include <chrono>
 
 namespace VulkanViewer {
 
@@ -12,11 +14,21 @@ VulkanDevice::VulkanDevice(GLFWwindow* window) : m_window(window) {
     createSurface();
     pickPhysicalDevice();
     createLogicalDevice();
+    createAllocator();
     createCommandPool();
+    createUploadTimeline();
+    createStagingRing();
 }
 
 VulkanDevice::~VulkanDevice() {
+    vkDeviceWaitIdle(m_device);
+    collectUploads();
+    unmapMemory(m_stagingAllocation);
+    destroyBuffer(m_stagingBuffer, m_stagingAllocation);
+    vkDestroySemaphore(m_device, m_uploadTimeline, nullptr);
+    vkDestroyCommandPool(m_device, m_transferCommandPool, nullptr);
     vkDestroyCommandPool(m_device, m_commandPool, nullptr);
+    vmaDestroyAllocator(m_allocator);
     vkDestroyDevice(m_device, nullptr);
     
     if (m_enableValidationLayers) {
@@ -41,7 +53,7 @@ void VulkanDevice::createInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_2;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -132,6 +144,9 @@ void VulkanDevice::createLogicalDevice() {
     if (m_queueFamilyIndices.computeFamily.has_value()) {
         uniqueQueueFamilies.insert(m_queueFamilyIndices.computeFamily.value());
     }
+    if (m_queueFamilyIndices.transferFamily.has_value()) {
+        uniqueQueueFamilies.insert(m_queueFamilyIndices.transferFamily.value());
+    }
 
     float queuePriority = 1.0f;
     for (uint32_t queueFamily : uniqueQueueFamilies) {
@@ -146,8 +161,13 @@ void VulkanDevice::createLogicalDevice() {
     VkPhysicalDeviceFeatures deviceFeatures{};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext = &timelineFeatures;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
     createInfo.pEnabledFeatures = &deviceFeatures;
@@ -171,6 +191,29 @@ void VulkanDevice::createLogicalDevice() {
     if (m_queueFamilyIndices.computeFamily.has_value()) {
         vkGetDeviceQueue(m_device, m_queueFamilyIndices.computeFamily.value(), 0, &m_computeQueue);
     }
+
+    m_transferQueue = m_graphicsQueue;
+    if (m_queueFamilyIndices.transferFamily.has_value()) {
+        vkGetDeviceQueue(m_device, m_queueFamilyIndices.transferFamily.value(), 0, &m_transferQueue);
+        std::cout << "Using queue family " << m_queueFamilyIndices.transferFamily.value() << " for uploads" << std::endl;
+    }
+}
+
+void VulkanDevice::createAllocator() {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+    m_maxMemoryAllocationCount = properties.limits.maxMemoryAllocationCount;
+
+    VmaAllocatorCreateInfo allocatorInfo{};
+    allocatorInfo.vulkanApiVersion = VK_API_VERSION_1_2;
+    allocatorInfo.physicalDevice = m_physicalDevice;
+    allocatorInfo.device = m_device;
+    allocatorInfo.instance = m_instance;
+    allocatorInfo.preferredLargeHeapBlockSize = PREFERRED_BLOCK_SIZE;
+
+    if (vmaCreateAllocator(&allocatorInfo, &m_allocator) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create memory allocator!");
+    }
 }
 
 void VulkanDevice::createCommandPool() {
@@ -182,6 +225,40 @@ void VulkanDevice::createCommandPool() {
     if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
         throw std::runtime_error("failed to create command pool!");
     }
+
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = getTransferQueueFamily();
+    if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &m_transferCommandPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create transfer command pool!");
+    }
+}
+
+void VulkanDevice::createUploadTimeline() {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &m_uploadTimeline) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create upload timeline semaphore!");
+    }
+}
+
+void VulkanDevice::createStagingRing() {
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+    m_stagingAlignment = std::max<VkDeviceSize>(m_stagingAlignment, properties.limits.optimalBufferCopyOffsetAlignment);
+
+    // Coherent, so writes need no flush. Both queue families read it.
+    createBuffer(STAGING_RING_SIZE, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 m_stagingBuffer, m_stagingAllocation, MemoryCategory::Staging, true);
+    m_stagingData = static_cast<char*>(mapMemory(m_stagingAllocation));
+    m_stagingStats.capacity = STAGING_RING_SIZE;
 }
 
 std::vector<const char*> VulkanDevice::getRequiredExtensions() {
@@ -232,29 +309,40 @@ QueueFamilyIndices VulkanDevice::findQueueFamilies(VkPhysicalDevice device) {
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
-    int i = 0;
+    // Every family is visited so a transfer-only family further down the list is still found
+    std::optional<uint32_t> asyncComputeFamily;
+    uint32_t i = 0;
     for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        if ((queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphicsFamily.has_value()) {
             indices.graphicsFamily = i;
         }
 
-        if (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) {
+        if ((queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !indices.computeFamily.has_value()) {
             indices.computeFamily = i;
         }
 
         VkBool32 presentSupport = false;
         vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
 
-        if (presentSupport) {
+        if (presentSupport && !indices.presentFamily.has_value()) {
             indices.presentFamily = i;
         }
 
-        if (indices.isComplete()) {
-            break;
+
+        // The copy engines; an async compute family without graphics is the next best thing
+        if (!(queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) && (queueFamily.queueFlags & VK_QUEUE_TRANSFER_BIT)) {
+            if (!(queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) && !indices.transferFamily.has_value()) {
+                indices.transferFamily = i;
+            } else if (!asyncComputeFamily.has_value()) {
+                asyncComputeFamily = i;
+            }
         }
 
         i++;
     }
+    if (!indices.transferFamily.has_value()) {
+        indices.transferFamily = asyncComputeFamily;
+    }
 
     return indices;
 }
@@ -289,7 +377,22 @@ bool VulkanDevice::isDeviceSuitable(VkPhysicalDevice device) {
     VkPhysicalDeviceFeatures supportedFeatures;
     vkGetPhysicalDeviceFeatures(device, &supportedFeatures);
 
-    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy;
+    // Async uploads hand out timeline semaphore values as tickets
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(device, &properties);
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &timelineFeatures;
+    bool timelineSupported = false;
+    if (properties.apiVersion >= VK_API_VERSION_1_2) {
+        vkGetPhysicalDeviceFeatures2(device, &features2);
+        timelineSupported = timelineFeatures.timelineSemaphore == VK_TRUE;
+    }
+
+    return indices.isComplete() && extensionsSupported && swapChainAdequate && supportedFeatures.samplerAnisotropy &&
+           timelineSupported;
 }
 
 SwapChainSupportDetails VulkanDevice::querySwapChainSupport(VkPhysicalDevice device) const {
@@ -322,6 +425,7 @@ SwapChainSupportDetails VulkanDevice::getSwapChainSupport() const {
 
 void VulkanDevice::waitIdle() {
     vkDeviceWaitIdle(m_device);
+    collectUploads();
 }
 
 VKAPI_ATTR VkBool32 VKAPI_CALL VulkanDevice::debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType, const VkDebugUtilsMessengerCallbackDataEXT* pCallbackData, void* pUserData) {
@@ -356,12 +460,246 @@ void VulkanDevice::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(m_graphicsQueue);
+    // A fence waits for this submission only, not for every frame queued ahead of it
+    VkFenceCreateInfo fenceInfo{};
+    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    VkFence fence;
+    if (vkCreateFence(m_device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create fence!");
+    }
+
+    vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, fence);
+    vkWaitForFences(m_device, 1, &fence, VK_TRUE, UINT64_MAX);
 
+    vkDestroyFence(m_device, fence, nullptr);
     vkFreeCommandBuffers(m_device, m_commandPool, 1, &commandBuffer);
 }
 
+uint32_t VulkanDevice::getTransferQueueFamily() const {
+    return m_queueFamilyIndices.transferFamily.value_or(m_queueFamilyIndices.graphicsFamily.value());
+}
+
+VkCommandBuffer VulkanDevice::beginUploadCommands(bool graphicsQueue) {
+    VkCommandBufferAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandPool = graphicsQueue ? m_commandPool : m_transferCommandPool;
+    allocInfo.commandBufferCount = 1;
+
+    VkCommandBuffer commandBuffer;
+    if (vkAllocateCommandBuffers(m_device, &allocInfo, &commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("failed to allocate upload command buffer!");
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(commandBuffer, &beginInfo);
+
+    return commandBuffer;
+}
+
+UploadTicket VulkanDevice::submitUploadCommands(VkCommandBuffer commandBuffer, bool graphicsQueue) {
+    vkEndCommandBuffer(commandBuffer);
+
+    UploadTicket previous = m_lastUploadTicket;
+    UploadTicket ticket = ++m_lastUploadTicket;
+    VkQueue queue = graphicsQueue ? m_graphicsQueue : m_transferQueue;
+    
+    // Timeline values have to be signaled in increasing order. One queue signals in submission order;
+    // the first upload after one on the other queue waits for it on the GPU.
+    bool switchedQueue = previous > 0 && queue != m_lastUploadQueue;
+    m_lastUploadQueue = queue;
+    VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = switchedQueue ? 1 : 0;
+    timelineInfo.pWaitSemaphoreValues = &previous;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &ticket;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = switchedQueue ? 1 : 0;
+    submitInfo.pWaitSemaphores = &m_uploadTimeline;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_uploadTimeline;
+
+    if (vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("failed to submit upload!");
+    }
+
+    InFlightUpload upload;
+    upload.ticket = ticket;
+    upload.commandBuffer = commandBuffer;
+    upload.commandPool = graphicsQueue ? m_commandPool : m_transferCommandPool;
+    m_inFlightUploads.push_back(upload);
+    return ticket;
+}
+
+void VulkanDevice::addUploadAcquire(UploadTicket ticket, const VkImageMemoryBarrier& barrier) {
+    m_pendingAcquires.push_back(PendingAcquire{ticket, barrier});
+}
+
+void VulkanDevice::discardUploadAcquires(VkImage image) {
+    m_pendingAcquires.erase(std::remove_if(m_pendingAcquires.begin(), m_pendingAcquires.end(),
+                                           [image](const PendingAcquire& acquire) { return acquire.barrier.image == image; }),
+                            m_pendingAcquires.end());
+}
+
+void VulkanDevice::collectUploads() {
+    vkGetSemaphoreCounterValue(m_device, m_uploadTimeline, &m_completedUploadTicket);
+
+    size_t finished = 0;
+    while (finished < m_inFlightUploads.size() && m_inFlightUploads[finished].ticket <= m_completedUploadTicket) {
+        InFlightUpload& upload = m_inFlightUploads[finished];
+        vkFreeCommandBuffers(m_device, upload.commandPool, 1, &upload.commandBuffer);
+        finished++;
+    }
+    m_inFlightUploads.erase(m_inFlightUploads.begin(), m_inFlightUploads.begin() + finished);
+    reclaimStaging();
+}
+
+bool VulkanDevice::fitStaging(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) const {
+    offset = (m_stagingHead + alignment - 1) / alignment * alignment;
+    bool wrapped = !m_stagingSpans.empty() && m_stagingHead <= m_stagingTail;
+    if (wrapped) {
+        return offset + size <= m_stagingTail;
+    }
+    if (offset + size <= STAGING_RING_SIZE) {
+        return true;
+    }
+
+    // Not enough room before the end of the buffer; start over at the front, behind the oldest region
+    offset = 0;
+    return m_stagingSpans.empty() || size <= m_stagingTail;
+}
+
+StagingRegion VulkanDevice::allocateStaging(VkDeviceSize size, VkDeviceSize alignment) {
+    StagingRegion region;
+    if (size == 0) {
+        return region;
+    }
+    if (size > STAGING_RING_SIZE) {
+        throw std::runtime_error("staging allocation larger than the staging ring!");
+    }
+    alignment = std::max(alignment, m_stagingAlignment);
+
+    collectUploads();
+    VkDeviceSize offset = 0;
+    if (!fitStaging(size, alignment, offset)) {
+        m_stagingStats.stalls++;
+        auto stallStart = std::chrono::high_resolution_clock::now();
+        do {
+            const StagingSpan& oldest = m_stagingSpans.front();
+            if (!oldest.released) {
+                throw std::runtime_error("staging ring is full of unsubmitted uploads!");
+            }
+            waitForUpload(oldest.ticket);
+            reclaimStaging();
+        } while (!fitStaging(size, alignment, offset));
+        m_stagingStats.stallMilliseconds += std::chrono::duration<double, std::milli>(
+            std::chrono::high_resolution_clock::now() - stallStart).count();
+    }
+
+    VkDeviceSize bytes = offset + size - m_stagingHead;
+    if (offset < m_stagingHead) {
+        bytes = STAGING_RING_SIZE - m_stagingHead + offset + size;
+        m_stagingStats.wraps++;
+    }
+    m_stagingHead = offset + size;
+    m_stagingSpans.push_back(StagingSpan{m_stagingHead, bytes, 0, false});
+
+    m_stagingStats.inFlightBytes += bytes;
+    m_stagingStats.peakInFlightBytes = std::max(m_stagingStats.peakInFlightBytes, m_stagingStats.inFlightBytes);
+    m_stagingStats.stagedBytes += size;
+
+    region.buffer = m_stagingBuffer;
+    region.offset = offset;
+    region.size = size;
+    region.data = m_stagingData + offset;
+    return region;
+}
+
+void VulkanDevice::releaseStaging(const StagingRegion& region, UploadTicket ticket) {
+    if (region.size == 0) {
+        return;
+    }
+    VkDeviceSize end = region.offset + region.size;
+    for (auto it = m_stagingSpans.rbegin(); it != m_stagingSpans.rend(); ++it) {
+        if (!it->released && it->end == end) {
+            it->released = true;
+            it->ticket = ticket;
+            break;
+        }
+    }
+    m_stagingStats.submissions++;
+    reclaimStaging();
+}
+
+void VulkanDevice::reclaimStaging() {
+    while (!m_stagingSpans.empty() && m_stagingSpans.front().released &&
+           m_stagingSpans.front().ticket <= m_completedUploadTicket) {
+        m_stagingTail = m_stagingSpans.front().end;
+        m_stagingStats.inFlightBytes -= m_stagingSpans.front().bytes;
+        m_stagingSpans.pop_front();
+    }
+    if (m_stagingSpans.empty()) {
+        m_stagingHead = 0;
+        m_stagingTail = 0;
+    }
+}
+
+StagingRingStats VulkanDevice::getStagingStats() const {
+    return m_stagingStats;
+}
+
+UploadTicket VulkanDevice::getCompletedUploadTicket() {
+    collectUploads();
+    return m_completedUploadTicket;
+}
+
+bool VulkanDevice::isUploadComplete(UploadTicket ticket) {
+    return ticket <= m_completedUploadTicket || ticket <= getCompletedUploadTicket();
+}
+
+void VulkanDevice::waitForUpload(UploadTicket ticket) {
+    if (isUploadComplete(ticket)) {
+        return;
+    }
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_uploadTimeline;
+    waitInfo.pValues = &ticket;
+    vkWaitSemaphores(m_device, &waitInfo, UINT64_MAX);
+    collectUploads();
+}
+
+void VulkanDevice::recordUploadAcquires(VkCommandBuffer commandBuffer, UploadTicket ticket) {
+    std::vector<VkImageMemoryBarrier> barriers;
+    auto ready = [ticket](const PendingAcquire& acquire) { return acquire.ticket <= ticket; };
+    for (const auto& acquire : m_pendingAcquires) {
+        if (ready(acquire)) {
+            barriers.push_back(acquire.barrier);
+        }
+    }
+    if (barriers.empty()) {
+        return;
+    }
+    m_pendingAcquires.erase(std::remove_if(m_pendingAcquires.begin(), m_pendingAcquires.end(), ready),
+                            m_pendingAcquires.end());
+
+    // The release on the transfer queue already made the writes available; this is the matching acquire
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+}
+
 uint32_t VulkanDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
     VkPhysicalDeviceMemoryProperties memProperties;
     vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memProperties);
@@ -375,30 +713,83 @@ uint32_t VulkanDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags
     throw std::runtime_error("failed to find suitable memory type!");
 }
 
-void VulkanDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+const char* getMemoryCategoryName(MemoryCategory category) {
+    switch (category) {
+        case MemoryCategory::Mesh: return "Mesh";
+        case MemoryCategory::Texture: return "Texture";
+        case MemoryCategory::Thumbnail: return "Thumbnail";
+        case MemoryCategory::Uniform: return "Uniform";
+        case MemoryCategory::Attachment: return "Attachment";
+        case MemoryCategory::Staging: return "Staging";
+        default: return "Unknown";
+    }
+}
+
+void VulkanDevice::trackAllocation(VmaAllocation allocation, MemoryCategory category) {
+    // VMA also picks dedicated memory on its own, for drivers that prefer it or sizes close to a block
+    VmaAllocationInfo2 info{};
+    vmaGetAllocationInfo2(m_allocator, allocation, &info);
+
+    // The category and dedicated state ride along in the allocation so destroy calls do not have to repeat them
+    uintptr_t userData = static_cast<uintptr_t>(category);
+    if (info.dedicatedMemory) {
+        userData |= DEDICATED_ALLOCATION_FLAG;
+        m_dedicatedAllocations++;
+    }
+    vmaSetAllocationUserData(m_allocator, allocation, reinterpret_cast<void*>(userData));
+
+    size_t index = static_cast<size_t>(category);
+    m_categoryAllocations[index]++;
+    m_categoryBytes[index] += info.allocationInfo.size;
+}
+
+void VulkanDevice::untrackAllocation(VmaAllocation allocation) {
+    VmaAllocationInfo info{};
+    vmaGetAllocationInfo(m_allocator, allocation, &info);
+
+    uintptr_t userData = reinterpret_cast<uintptr_t>(info.pUserData);
+    if (userData & DEDICATED_ALLOCATION_FLAG) {
+        m_dedicatedAllocations--;
+    }
+    size_t index = static_cast<size_t>(userData & ~DEDICATED_ALLOCATION_FLAG);
+    if (index < m_categoryAllocations.size()) {
+        m_categoryAllocations[index]--;
+        m_categoryBytes[index] -= info.size;
+    }
+}
+
+void VulkanDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VmaAllocation& allocation, MemoryCategory category, bool sharedWithTransferQueue) {
     VkBufferCreateInfo bufferInfo{};
     bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     bufferInfo.size = size;
     bufferInfo.usage = usage;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create buffer!");
+    uint32_t queueFamilies[] = {m_queueFamilyIndices.graphicsFamily.value(), getTransferQueueFamily()};
+    if (sharedWithTransferQueue && queueFamilies[0] != queueFamilies[1]) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = 2;
+        bufferInfo.pQueueFamilyIndices = queueFamilies;
     }
 
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(m_device, buffer, &memRequirements);
-
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.requiredFlags = properties;
 
-    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate buffer memory!");
+    if (vmaCreateBuffer(m_allocator, &bufferInfo, &allocInfo, &buffer, &allocation, nullptr) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create buffer!");
     }
+    trackAllocation(allocation, category);
+}
 
-    vkBindBufferMemory(m_device, buffer, bufferMemory, 0);
+void VulkanDevice::destroyBuffer(VkBuffer& buffer, VmaAllocation& allocation) {
+    if (allocation != VK_NULL_HANDLE) {
+        untrackAllocation(allocation);
+    }
+    if (buffer != VK_NULL_HANDLE || allocation != VK_NULL_HANDLE) {
+        vmaDestroyBuffer(m_allocator, buffer, allocation);
+    }
+    buffer = VK_NULL_HANDLE;
+    allocation = VK_NULL_HANDLE;
 }
 
 void VulkanDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
@@ -434,7 +825,7 @@ VkFormat VulkanDevice::findDepthFormat() {
     );
 }
 
-void VulkanDevice::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+void VulkanDevice::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VmaAllocation& allocation, MemoryCategory category) {
     VkImageCreateInfo imageInfo{};
     imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     imageInfo.imageType = VK_IMAGE_TYPE_2D;
@@ -450,23 +841,96 @@ void VulkanDevice::createImage(uint32_t width, uint32_t height, uint32_t mipLeve
     imageInfo.samples = numSamples;
     imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-    if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+    VkResult result = createImage(imageInfo, properties, category, image, allocation);
+    if (result == VK_ERROR_OUT_OF_DEVICE_MEMORY || result == VK_ERROR_OUT_OF_HOST_MEMORY) {
+        throw std::runtime_error("failed to allocate image memory!");
+    } else if (result != VK_SUCCESS) {
         throw std::runtime_error("failed to create image!");
     }
+}
+
+VkResult VulkanDevice::createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, MemoryCategory category, VkImage& image, VmaAllocation& allocation) {
+    image = VK_NULL_HANDLE;
+    allocation = VK_NULL_HANDLE;
+
+    VkResult result = vkCreateImage(m_device, &imageInfo, nullptr, &image);
+    if (result != VK_SUCCESS) {
+        image = VK_NULL_HANDLE;
+        return result;
+    }
 
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(m_device, image, &memRequirements);
 
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+    // Only big images (swapchain-sized attachments, 4K+ textures) are worth a VkDeviceMemory of their own
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.requiredFlags = properties;
+    if (memRequirements.size >= DEDICATED_IMAGE_THRESHOLD) {
+        allocInfo.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    }
 
-    if (vkAllocateMemory(m_device, &allocInfo, nullptr, &imageMemory) != VK_SUCCESS) {
-        throw std::runtime_error("failed to allocate image memory!");
+    VmaAllocationInfo allocationInfo{};
+    result = vmaAllocateMemoryForImage(m_allocator, image, &allocInfo, &allocation, &allocationInfo);
+    if (result == VK_SUCCESS) {
+        result = vmaBindImageMemory(m_allocator, allocation, image);
+    }
+    if (result != VK_SUCCESS) {
+        if (allocation != VK_NULL_HANDLE) {
+            vmaFreeMemory(m_allocator, allocation);
+            allocation = VK_NULL_HANDLE;
+        }
+        vkDestroyImage(m_device, image, nullptr);
+        image = VK_NULL_HANDLE;
+        return result;
     }
 
-    vkBindImageMemory(m_device, image, imageMemory, 0);
+    trackAllocation(allocation, category);
+    return VK_SUCCESS;
+}
+
+void VulkanDevice::destroyImage(VkImage& image, VmaAllocation& allocation) {
+    if (allocation != VK_NULL_HANDLE) {
+        untrackAllocation(allocation);
+    }
+    if (image != VK_NULL_HANDLE || allocation != VK_NULL_HANDLE) {
+        vmaDestroyImage(m_allocator, image, allocation);
+    }
+    image = VK_NULL_HANDLE;
+    allocation = VK_NULL_HANDLE;
+}
+
+void* VulkanDevice::mapMemory(VmaAllocation allocation) {
+    void* data = nullptr;
+    if (vmaMapMemory(m_allocator, allocation, &data) != VK_SUCCESS) {
+        throw std::runtime_error("failed to map memory!");
+    }
+    return data;
+}
+
+void VulkanDevice::unmapMemory(VmaAllocation allocation) {
+    vmaUnmapMemory(m_allocator, allocation);
+}
+
+DeviceMemoryStats VulkanDevice::getMemoryStats() const {
+    DeviceMemoryStats stats;
+    for (size_t i = 0; i < stats.categories.size(); i++) {
+        stats.categories[i].allocations = m_categoryAllocations[i].load();
+        stats.categories[i].bytes = m_categoryBytes[i].load();
+    }
+    stats.dedicatedAllocations = m_dedicatedAllocations.load();
+    stats.maxDeviceAllocations = m_maxMemoryAllocationCount;
+
+    // Budgets are cheap to query every frame, unlike vmaCalculateStatistics which walks every allocation
+    VmaBudget budgets[VK_MAX_MEMORY_HEAPS];
+    vmaGetHeapBudgets(m_allocator, budgets);
+    const VkPhysicalDeviceMemoryProperties* memoryProperties = nullptr;
+    vmaGetMemoryProperties(m_allocator, &memoryProperties);
+    for (uint32_t heap = 0; heap < memoryProperties->memoryHeapCount; heap++) {
+        stats.deviceAllocations += budgets[heap].statistics.blockCount;
+        stats.blockBytes += budgets[heap].statistics.blockBytes;
+        stats.usedBytes += budgets[heap].statistics.allocationBytes;
+    }
+    return stats;
 }
 
 VkImageView VulkanDevice::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels) {
@@ -557,10 +1021,7 @@ void VulkanDevice::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t wi
 
 void VulkanDevice::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
  
-    VkFormatProperties formatProperties;
-    vkGetPhysicalDeviceFormatProperties(m_physicalDevice, imageFormat, &formatProperties);
-
-    if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
+    if (!supportsLinearBlit(imageFormat)) {
         throw std::runtime_error("texture image format does not support linear blitting!");
     }
 
@@ -642,6 +1103,14 @@ void VulkanDevice::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t
     endSingleTimeCommands(commandBuffer);
 }
 
+bool VulkanDevice::supportsLinearBlit(VkFormat format) const {
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(m_physicalDevice, format, &formatProperties);
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                    VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (formatProperties.optimalTilingFeatures & required) == required;
+}
+
 VkSampleCountFlagBits VulkanDevice::getMaxUsableSampleCount() {
     VkPhysicalDeviceProperties physicalDeviceProperties;
     vkGetPhysicalDeviceProperties(m_physicalDevice, &physicalDeviceProperties);
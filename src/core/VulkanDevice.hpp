@@ -3,31 +3,99 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
 
+#include <array>
+#include <atomic>
+#include <deque>
 #include <vector>
 #include <optional>
 #include <set>
 
 namespace VulkanViewer {
 
+class GeometryPool;
+class TextureCache;
+
 struct QueueFamilyIndices {
     std::optional<uint32_t> graphicsFamily;
     std::optional<uint32_t> presentFamily;
     std::optional<uint32_t> computeFamily;
+    // A family without graphics that can copy; uploads share the graphics queue when there is none
+    std::optional<uint32_t> transferFamily;
 
     bool isComplete() {
         return graphicsFamily.has_value() && presentFamily.has_value();
     }
 };
 
+// Upload timeline value a batch signals when its copies have landed. Values complete in
+// submission order, and 0 is complete from the start.
+using UploadTicket = uint64_t;
+
 struct SwapChainSupportDetails {
     VkSurfaceCapabilitiesKHR capabilities;
     std::vector<VkSurfaceFormatKHR> formats;
     std::vector<VkPresentModeKHR> presentModes;
 };
 
+// What an allocation is for; only used to break the memory statistics down
+enum class MemoryCategory {
+    Mesh,
+    Texture,
+    Thumbnail,
+    Uniform,
+    Attachment,
+    Staging,
+    Count
+};
+
+const char* getMemoryCategoryName(MemoryCategory category);
+
+// Slice of the staging ring. `data` stays mapped for the lifetime of the device.
+struct StagingRegion {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;
+    void* data = nullptr;
+};
+
+struct StagingRingStats {
+    VkDeviceSize capacity = 0;
+    VkDeviceSize inFlightBytes = 0;
+    VkDeviceSize peakInFlightBytes = 0;
+    uint64_t stagedBytes = 0;
+    uint64_t submissions = 0;
+    uint64_t wraps = 0;
+    // Allocations that had to wait for the GPU to hand space back
+    uint64_t stalls = 0;
+    double stallMilliseconds = 0.0;
+};
+
+struct MemoryCategoryStats {
+    uint32_t allocations = 0;
+    VkDeviceSize bytes = 0;
+};
+
+struct DeviceMemoryStats {
+    std::array<MemoryCategoryStats, static_cast<size_t>(MemoryCategory::Count)> categories{};
+    // VkDeviceMemory objects behind all of the above, dedicated ones included
+    uint32_t deviceAllocations = 0;
+    uint32_t dedicatedAllocations = 0;
+    uint32_t maxDeviceAllocations = 0;
+    VkDeviceSize blockBytes = 0;
+    VkDeviceSize usedBytes = 0;
+
+    const MemoryCategoryStats& get(MemoryCategory category) const { return categories[static_cast<size_t>(category)]; }
+};
+
 class VulkanDevice {
 public:
+    // Images at least this large get their own VkDeviceMemory; everything else is suballocated
+    static constexpr VkDeviceSize DEDICATED_IMAGE_THRESHOLD = 32ull * 1024 * 1024;
+    static constexpr VkDeviceSize PREFERRED_BLOCK_SIZE = 64ull * 1024 * 1024;
+    static constexpr VkDeviceSize STAGING_RING_SIZE = 64ull * 1024 * 1024;
+
     VulkanDevice(GLFWwindow* window);
     ~VulkanDevice();
 
@@ -39,7 +107,9 @@ public:
     VkQueue getGraphicsQueue() const { return m_graphicsQueue; }
     VkQueue getPresentQueue() const { return m_presentQueue; }
     VkQueue getComputeQueue() const { return m_computeQueue; }
+    VkQueue getTransferQueue() const { return m_transferQueue; }
     VkCommandPool getCommandPool() const { return m_commandPool; }
+    VmaAllocator getAllocator() const { return m_allocator; }
     
     QueueFamilyIndices getQueueFamilies() const { return m_queueFamilyIndices; }
     SwapChainSupportDetails getSwapChainSupport() const;
@@ -55,19 +125,76 @@ public:
     void endSingleTimeCommands(VkCommandBuffer commandBuffer);
 
 
-    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    // Buffers and images are suballocated from VMA blocks, so thousands of meshes and textures
+    // share a handful of VkDeviceMemory objects. Free them with destroyBuffer/destroyImage.
+    // Buffers the transfer queue writes while the graphics queue reads other ranges of them are shared
+    // between both families, so uploads into them need no ownership transfer.
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VmaAllocation& allocation, MemoryCategory category, bool sharedWithTransferQueue = false);
+    void destroyBuffer(VkBuffer& buffer, VmaAllocation& allocation);
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
 
 
-    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, VkSampleCountFlagBits numSamples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VmaAllocation& allocation, MemoryCategory category);
+    // Non-throwing variant for callers that fill in the create info themselves
+    VkResult createImage(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, MemoryCategory category, VkImage& image, VmaAllocation& allocation);
+    void destroyImage(VkImage& image, VmaAllocation& allocation);
+
+    void* mapMemory(VmaAllocation allocation);
+    void unmapMemory(VmaAllocation allocation);
+
+    DeviceMemoryStats getMemoryStats() const;
+
+
+    // Async uploads run on the transfer queue and signal the upload timeline instead of blocking.
+    uint32_t getTransferQueueFamily() const;
+    bool hasDedicatedTransferQueue() const { return m_queueFamilyIndices.transferFamily.has_value(); }
+    VkSemaphore getUploadTimeline() const { return m_uploadTimeline; }
+
+    // With `graphicsQueue` the upload runs on the graphics queue behind the frames submitted before it,
+    // for writes into live geometry and mip blits a transfer-only queue cannot do. It signals the same timeline.
+    VkCommandBuffer beginUploadCommands(bool graphicsQueue = false);
+    // Ends and submits the command buffer; it is freed once the ticket completes
+    UploadTicket submitUploadCommands(VkCommandBuffer commandBuffer, bool graphicsQueue = false);
+
+    // Acquire half of an image ownership transfer released by the upload with this ticket
+    void addUploadAcquire(UploadTicket ticket, const VkImageMemoryBarrier& barrier);
+    // For images destroyed before anyone drew them
+    void discardUploadAcquires(VkImage image);
+    // Records the acquires of every upload up to `ticket` into a graphics command buffer. Its submission
+    // has to wait for `ticket` first, on the timeline semaphore or through waitForUpload.
+    void recordUploadAcquires(VkCommandBuffer commandBuffer, UploadTicket ticket);
+
+    UploadTicket getCompletedUploadTicket();
+    bool isUploadComplete(UploadTicket ticket);
+    void waitForUpload(UploadTicket ticket);
+
+    // Every CPU to GPU copy is staged in one persistently mapped ring buffer. A region stays reserved
+    // until the submission reading it has completed, and regions come back in allocation order.
+    // When the ring is full, allocating waits for the oldest released region.
+    StagingRegion allocateStaging(VkDeviceSize size, VkDeviceSize alignment);
+    // Returns the region once `ticket` completes; 0 for submissions that were already waited on
+    void releaseStaging(const StagingRegion& region, UploadTicket ticket);
+    VkDeviceSize getStagingCapacity() const { return STAGING_RING_SIZE; }
+    StagingRingStats getStagingStats() const;
+
     void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
     void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
     void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
 
+    // Whether vkCmdBlitImage can downsample optimal-tiling images of this format with VK_FILTER_LINEAR
+    bool supportsLinearBlit(VkFormat format) const;
+
     VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags, uint32_t mipLevels);
 
     VkSampleCountFlagBits getMaxUsableSampleCount();
 
+
+    // The renderer owns the pool; models reach it through the device they are loaded with
+    void setGeometryPool(GeometryPool* pool) { m_geometryPool = pool; }
+    GeometryPool* getGeometryPool() const { return m_geometryPool; }
+    void setTextureCache(TextureCache* cache) { m_textureCache = cache; }
+    TextureCache* getTextureCache() const { return m_textureCache; }
+
 private:
     void createInstance();
     void setupDebugMessenger();
@@ -75,6 +202,19 @@ private:
     void pickPhysicalDevice();
     void createLogicalDevice();
     void createCommandPool();
+    void createAllocator();
+    void createUploadTimeline();
+    void createStagingRing();
+    // Frees the command buffers and staging regions of finished uploads
+    void collectUploads();
+    // Moves the ring's tail past released regions whose uploads have completed
+    void reclaimStaging();
+    bool fitStaging(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) const;
+
+    // Set in an allocation's user data next to its MemoryCategory
+    static constexpr uintptr_t DEDICATED_ALLOCATION_FLAG = uintptr_t(1) << 8;
+    void trackAllocation(VmaAllocation allocation, MemoryCategory category);
+    void untrackAllocation(VmaAllocation allocation);
 
     std::vector<const char*> getRequiredExtensions();
     bool checkValidationLayerSupport();
@@ -97,10 +237,58 @@ private:
     VkQueue m_graphicsQueue;
     VkQueue m_presentQueue;
     VkQueue m_computeQueue;
+    VkQueue m_transferQueue;
     
     VkCommandPool m_commandPool;
+    VkCommandPool m_transferCommandPool = VK_NULL_HANDLE;
+
+    struct InFlightUpload {
+        UploadTicket ticket = 0;
+        VkCommandBuffer commandBuffer = VK_NULL_HANDLE;
+        VkCommandPool commandPool = VK_NULL_HANDLE;
+    };
+
+    struct PendingAcquire {
+        UploadTicket ticket;
+        VkImageMemoryBarrier barrier;
+    };
+
+    // Uploads are submitted and collected on the render thread only
+    VkSemaphore m_uploadTimeline = VK_NULL_HANDLE;
+    UploadTicket m_lastUploadTicket = 0;
+    VkQueue m_lastUploadQueue = VK_NULL_HANDLE;
+    UploadTicket m_completedUploadTicket = 0;
+    std::vector<InFlightUpload> m_inFlightUploads;
+    std::vector<PendingAcquire> m_pendingAcquires;
+
+    // Bytes of the ring from the previous region's end to this one's, padding and wrap-around included
+    struct StagingSpan {
+        VkDeviceSize end;
+        VkDeviceSize bytes;
+        UploadTicket ticket;
+        bool released;
+    };
+
+    // Same thread as the uploads. Free space runs from head to tail, wrapping at the end of the buffer.
+    VkBuffer m_stagingBuffer = VK_NULL_HANDLE;
+    VmaAllocation m_stagingAllocation = VK_NULL_HANDLE;
+    char* m_stagingData = nullptr;
+    VkDeviceSize m_stagingAlignment = 16;
+    VkDeviceSize m_stagingHead = 0;
+    VkDeviceSize m_stagingTail = 0;
+    std::deque<StagingSpan> m_stagingSpans;
+    StagingRingStats m_stagingStats;
+
+    VmaAllocator m_allocator = VK_NULL_HANDLE;
+    uint32_t m_maxMemoryAllocationCount = 0;
+    std::array<std::atomic<uint32_t>, static_cast<size_t>(MemoryCategory::Count)> m_categoryAllocations{};
+    std::array<std::atomic<VkDeviceSize>, static_cast<size_t>(MemoryCategory::Count)> m_categoryBytes{};
+    std::atomic<uint32_t> m_dedicatedAllocations{0};
     
     QueueFamilyIndices m_queueFamilyIndices;
+    
+    GeometryPool* m_geometryPool = nullptr;
+    TextureCache* m_textureCache = nullptr;
 
     const std::vector<const char*> m_validationLayers = {
         "VK_LAYER_KHRONOS_validation"
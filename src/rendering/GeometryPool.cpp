@@ -0,0 +1,377 @@
+#include "GeometryPool.hpp"
+#include "../core/VulkanDevice.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+
+namespace VulkanViewer {
+
+namespace {
+
+VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+    return ((value + alignment - 1) / alignment) * alignment;
+}
+
+}
+
+GeometryPool::GeometryPool(VulkanDevice& device, VkDeviceSize blockSize)
+    : m_device(device), m_blockSize(blockSize) {
+}
+
+GeometryPool::~GeometryPool() {
+    cleanup();
+}
+
+std::unique_ptr<GeometryPool::Block> GeometryPool::createBlock(VkDeviceSize capacity) {
+    auto block = std::make_unique<Block>();
+    block->capacity = capacity;
+
+
+    // One buffer serves as both vertex and index source; TRANSFER_SRC is needed by compact().
+    // Streaming imports fill new ranges from the transfer queue while frames draw the others.
+    m_device.createBuffer(capacity,
+                          VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT |
+                          VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, block->buffer, block->allocation, MemoryCategory::Mesh, true);
+
+    block->freeRanges[0] = capacity;
+
+    std::cout << "GeometryPool: allocated block of " << (capacity / (1024 * 1024)) << " MB" << std::endl;
+    return block;
+}
+
+void GeometryPool::destroyBlock(Block& block) {
+    m_device.destroyBuffer(block.buffer, block.allocation);
+}
+
+bool GeometryPool::allocateRange(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+    for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it) {
+        VkDeviceSize rangeStart = it->first;
+        VkDeviceSize rangeEnd = it->first + it->second;
+        VkDeviceSize alignedStart = alignUp(rangeStart, alignment);
+
+        if (alignedStart + size > rangeEnd) {
+            continue;
+        }
+
+        block.freeRanges.erase(it);
+        if (alignedStart > rangeStart) {
+            block.freeRanges[rangeStart] = alignedStart - rangeStart;
+        }
+        if (alignedStart + size < rangeEnd) {
+            block.freeRanges[alignedStart + size] = rangeEnd - (alignedStart + size);
+        }
+
+        block.used += size;
+        offset = alignedStart;
+        return true;
+    }
+    return false;
+}
+
+void GeometryPool::freeRange(Block& block, VkDeviceSize offset, VkDeviceSize size) {
+    if (size == 0) {
+        return;
+    }
+    block.used -= size;
+
+    auto it = block.freeRanges.emplace(offset, size).first;
+
+
+    auto next = std::next(it);
+    if (next != block.freeRanges.end() && it->first + it->second == next->first) {
+        it->second += next->second;
+        block.freeRanges.erase(next);
+    }
+    if (it != block.freeRanges.begin()) {
+        auto prev = std::prev(it);
+        if (prev->first + prev->second == it->first) {
+            prev->second += it->second;
+            block.freeRanges.erase(it);
+        }
+    }
+}
+
+bool GeometryPool::allocateInBlock(uint32_t blockIndex, GeometryAllocation& allocation) {
+    Block& block = *m_blocks[blockIndex];
+    if (block.capacity - block.used < allocation.vertexBytes + allocation.indexBytes) {
+        return false;
+    }
+
+    VkDeviceSize vertexOffset = 0;
+    if (!allocateRange(block, allocation.vertexBytes, allocation.vertexStride, vertexOffset)) {
+        return false;
+    }
+
+    VkDeviceSize indexOffset = 0;
+    if (!allocateRange(block, allocation.indexBytes, allocation.indexSize, indexOffset)) {
+        freeRange(block, vertexOffset, allocation.vertexBytes);
+        return false;
+    }
+
+    allocation.block = blockIndex;
+    allocation.vertexByteOffset = vertexOffset;
+    allocation.indexByteOffset = indexOffset;
+    return true;
+}
+
+VkDeviceSize GeometryPool::blockCapacityFor(VkDeviceSize requiredBytes) const {
+    return std::max(m_blockSize, alignUp(requiredBytes, 1024 * 1024));
+}
+
+GeometryAllocation* GeometryPool::allocate(VkDeviceSize vertexBytes, uint32_t vertexStride, VkDeviceSize indexBytes, uint32_t indexSize) {
+    auto allocation = std::make_unique<GeometryAllocation>();
+    allocation->vertexBytes = vertexBytes;
+    allocation->vertexStride = vertexStride;
+    allocation->indexBytes = indexBytes;
+    allocation->indexSize = indexSize;
+
+    bool placed = false;
+    for (uint32_t i = 0; i < m_blocks.size() && !placed; i++) {
+        if (m_blocks[i]) {
+            placed = allocateInBlock(i, *allocation);
+        }
+    }
+
+    if (!placed) {
+
+        // Meshes larger than a block get a block of their own
+        VkDeviceSize capacity = blockCapacityFor(vertexBytes + indexBytes + vertexStride + indexSize);
+
+        uint32_t slot = static_cast<uint32_t>(m_blocks.size());
+        for (uint32_t i = 0; i < m_blocks.size(); i++) {
+            if (!m_blocks[i]) {
+                slot = i;
+                break;
+            }
+        }
+        if (slot == m_blocks.size()) {
+            m_blocks.emplace_back();
+        }
+        m_blocks[slot] = createBlock(capacity);
+
+        if (!allocateInBlock(slot, *allocation)) {
+            throw std::runtime_error("failed to allocate geometry from pool!");
+        }
+    }
+
+    allocation->vertexOffset = static_cast<int32_t>(allocation->vertexByteOffset / vertexStride);
+    allocation->firstIndex = static_cast<uint32_t>(allocation->indexByteOffset / indexSize);
+
+    GeometryAllocation* result = allocation.release();
+    m_allocations.insert(result);
+    return result;
+}
+
+void GeometryPool::free(GeometryAllocation* allocation) {
+    auto it = m_allocations.find(allocation);
+    if (it == m_allocations.end()) {
+        return;
+    }
+
+    Block& block = *m_blocks[allocation->block];
+    freeRange(block, allocation->vertexByteOffset, allocation->vertexBytes);
+    freeRange(block, allocation->indexByteOffset, allocation->indexBytes);
+
+
+    // Oversized blocks only ever hold one mesh, give their memory back once no frame can draw from them
+    if (block.used == 0 && block.capacity > m_blockSize) {
+        m_retiredBlocks.push_back({std::move(m_blocks[allocation->block]), m_frame});
+    }
+
+    m_allocations.erase(it);
+    delete allocation;
+}
+
+void GeometryPool::releaseRetiredBlocks(uint32_t framesInFlight) {
+    m_frame++;
+    auto finished = std::partition(m_retiredBlocks.begin(), m_retiredBlocks.end(), [&](const RetiredBlock& retired) {
+        return retired.frame + framesInFlight > m_frame;
+    });
+    for (auto it = finished; it != m_retiredBlocks.end(); ++it) {
+        destroyBlock(*it->block);
+    }
+    m_retiredBlocks.erase(finished, m_retiredBlocks.end());
+}
+
+void GeometryPool::bindBlock(VkCommandBuffer commandBuffer, uint32_t block, VkIndexType indexType) const {
+    VkBuffer buffer = m_blocks[block]->buffer;
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &buffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, buffer, 0, indexType);
+}
+
+bool GeometryPool::compact() {
+    // The GPU is idle, so blocks retired by free() can go right away
+    for (auto& retired : m_retiredBlocks) {
+        destroyBlock(*retired.block);
+    }
+    m_retiredBlocks.clear();
+
+    struct Placement {
+        GeometryAllocation* allocation;
+        uint32_t block;
+        VkDeviceSize vertexByteOffset;
+        VkDeviceSize indexByteOffset;
+    };
+
+
+    // Meshes are taken in the order they sit in the old blocks, so each old block drains
+    // into one or two new ones and can be destroyed early
+    std::vector<GeometryAllocation*> allocations(m_allocations.begin(), m_allocations.end());
+    std::sort(allocations.begin(), allocations.end(), [](const GeometryAllocation* a, const GeometryAllocation* b) {
+        return a->block != b->block ? a->block < b->block : a->vertexByteOffset < b->vertexByteOffset;
+    });
+
+    std::vector<Placement> placements;
+    placements.reserve(allocations.size());
+    std::vector<VkDeviceSize> capacities;
+    VkDeviceSize cursor = 0;
+    for (GeometryAllocation* allocation : allocations) {
+        VkDeviceSize vertexOffset = alignUp(cursor, allocation->vertexStride);
+        VkDeviceSize indexOffset = alignUp(vertexOffset + allocation->vertexBytes, allocation->indexSize);
+        if (capacities.empty() || indexOffset + allocation->indexBytes > capacities.back()) {
+            capacities.push_back(blockCapacityFor(allocation->vertexBytes + allocation->indexBytes +
+                                                  allocation->vertexStride + allocation->indexSize));
+            vertexOffset = 0;
+            indexOffset = alignUp(allocation->vertexBytes, allocation->indexSize);
+        }
+        placements.push_back({allocation, static_cast<uint32_t>(capacities.size() - 1), vertexOffset, indexOffset});
+        cursor = indexOffset + allocation->indexBytes;
+    }
+
+    uint32_t blockCount = 0;
+    for (const auto& block : m_blocks) {
+        if (block) {
+            blockCount++;
+        }
+    }
+    if (capacities.size() >= blockCount) {
+        std::cout << "GeometryPool: compaction skipped, the live meshes still need " << blockCount << " blocks" << std::endl;
+        return false;
+    }
+
+    std::vector<uint32_t> remaining(m_blocks.size(), 0);
+    for (GeometryAllocation* allocation : allocations) {
+        remaining[allocation->block]++;
+    }
+    for (uint32_t i = 0; i < m_blocks.size(); i++) {
+        if (m_blocks[i] && remaining[i] == 0) {
+            destroyBlock(*m_blocks[i]);
+            m_blocks[i].reset();
+        }
+    }
+
+
+    // One new block exists at a time besides the old ones still holding uncopied meshes
+    std::vector<std::unique_ptr<Block>> packedBlocks;
+    VkDeviceSize bytesMoved = 0;
+    size_t next = 0;
+    for (uint32_t blockIndex = 0; blockIndex < capacities.size(); blockIndex++) {
+        std::unique_ptr<Block> block = createBlock(capacities[blockIndex]);
+        block->freeRanges.clear();
+
+        VkCommandBuffer commandBuffer = m_device.beginSingleTimeCommands();
+        std::vector<VkBufferCopy> regions;
+        uint32_t sourceBlock = placements[next].allocation->block;
+        auto copyRegions = [&]() {
+            if (!regions.empty()) {
+                vkCmdCopyBuffer(commandBuffer, m_blocks[sourceBlock]->buffer, block->buffer,
+                                static_cast<uint32_t>(regions.size()), regions.data());
+                regions.clear();
+            }
+        };
+        auto addRange = [&](VkDeviceSize srcOffset, VkDeviceSize dstOffset, VkDeviceSize size) {
+            if (size > 0) {
+                regions.push_back({srcOffset, dstOffset, size});
+                bytesMoved += size;
+            }
+        };
+
+        size_t first = next;
+        VkDeviceSize previousEnd = 0;
+        for (; next < placements.size() && placements[next].block == blockIndex; next++) {
+            const Placement& placement = placements[next];
+            const GeometryAllocation& allocation = *placement.allocation;
+            if (allocation.block != sourceBlock) {
+                copyRegions();
+                sourceBlock = allocation.block;
+            }
+            addRange(allocation.vertexByteOffset, placement.vertexByteOffset, allocation.vertexBytes);
+            addRange(allocation.indexByteOffset, placement.indexByteOffset, allocation.indexBytes);
+
+            if (placement.vertexByteOffset > previousEnd) {
+                block->freeRanges[previousEnd] = placement.vertexByteOffset - previousEnd;
+            }
+            VkDeviceSize vertexEnd = placement.vertexByteOffset + allocation.vertexBytes;
+            if (placement.indexByteOffset > vertexEnd) {
+                block->freeRanges[vertexEnd] = placement.indexByteOffset - vertexEnd;
+            }
+            previousEnd = placement.indexByteOffset + allocation.indexBytes;
+            block->used += allocation.vertexBytes + allocation.indexBytes;
+        }
+        if (previousEnd < block->capacity) {
+            block->freeRanges[previousEnd] = block->capacity - previousEnd;
+        }
+        copyRegions();
+        m_device.endSingleTimeCommands(commandBuffer);
+
+        for (size_t i = first; i < next; i++) {
+            uint32_t source = placements[i].allocation->block;
+            if (--remaining[source] == 0) {
+                destroyBlock(*m_blocks[source]);
+                m_blocks[source].reset();
+            }
+        }
+        packedBlocks.push_back(std::move(block));
+    }
+
+    m_blocks = std::move(packedBlocks);
+    for (const Placement& placement : placements) {
+        GeometryAllocation& allocation = *placement.allocation;
+        allocation.block = placement.block;
+        allocation.vertexByteOffset = placement.vertexByteOffset;
+        allocation.vertexOffset = static_cast<int32_t>(placement.vertexByteOffset / allocation.vertexStride);
+        allocation.indexByteOffset = placement.indexByteOffset;
+        allocation.firstIndex = static_cast<uint32_t>(placement.indexByteOffset / allocation.indexSize);
+    }
+
+    uint32_t releasedBlocks = blockCount - static_cast<uint32_t>(m_blocks.size());
+    std::cout << "GeometryPool: compaction moved " << (bytesMoved / (1024.0 * 1024.0)) << " MB, released "
+              << releasedBlocks << " blocks" << std::endl;
+    return releasedBlocks > 0;
+}
+
+GeometryPoolStats GeometryPool::getStats() const {
+    GeometryPoolStats stats;
+    for (const auto& block : m_blocks) {
+        if (block) {
+            stats.capacityBytes += block->capacity;
+            stats.usedBytes += block->used;
+            stats.blockCount++;
+        }
+    }
+    stats.allocationCount = static_cast<uint32_t>(m_allocations.size());
+    return stats;
+}
+
+void GeometryPool::cleanup() {
+    for (auto& block : m_blocks) {
+        if (block) {
+            destroyBlock(*block);
+        }
+    }
+    m_blocks.clear();
+    for (auto& retired : m_retiredBlocks) {
+        destroyBlock(*retired.block);
+    }
+    m_retiredBlocks.clear();
+
+    for (GeometryAllocation* allocation : m_allocations) {
+        delete allocation;
+    }
+    m_allocations.clear();
+}
+
+}
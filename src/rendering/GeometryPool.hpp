@@ -0,0 +1,104 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <map>
+#include <memory>
+#include <unordered_set>
+#include <vector>
+
+namespace VulkanViewer {
+
+class VulkanDevice;
+
+// Location of one mesh inside the pool. Records are owned by the pool and stay at
+// the same address for their whole lifetime, so compaction can move the data and
+// every Mesh pointing at the record sees the new offsets.
+struct GeometryAllocation {
+    uint32_t block = 0;
+
+    VkDeviceSize vertexByteOffset = 0;
+    VkDeviceSize vertexBytes = 0;
+    uint32_t vertexStride = 0;
+
+    VkDeviceSize indexByteOffset = 0;
+    VkDeviceSize indexBytes = 0;
+    uint32_t indexSize = 0;
+
+    int32_t vertexOffset = 0;
+    uint32_t firstIndex = 0;
+
+    VkIndexType getIndexType() const { return indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32; }
+};
+
+struct GeometryPoolStats {
+    VkDeviceSize capacityBytes = 0;
+    VkDeviceSize usedBytes = 0;
+    uint32_t blockCount = 0;
+    uint32_t allocationCount = 0;
+};
+
+// Suballocates vertex and index ranges from a few large device-local buffers so
+// meshes no longer need their own VkBuffer/VkDeviceMemory pairs.
+class GeometryPool {
+public:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 128ull * 1024 * 1024;
+
+    explicit GeometryPool(VulkanDevice& device, VkDeviceSize blockSize = DEFAULT_BLOCK_SIZE);
+    ~GeometryPool();
+
+    GeometryPool(const GeometryPool&) = delete;
+    GeometryPool& operator=(const GeometryPool&) = delete;
+
+    GeometryAllocation* allocate(VkDeviceSize vertexBytes, uint32_t vertexStride, VkDeviceSize indexBytes, uint32_t indexSize);
+    // Frames in flight may still draw from a block that empties here, so it is only retired;
+    // releaseRetiredBlocks() destroys it once those frames have finished
+    void free(GeometryAllocation* allocation);
+
+    // Called by the renderer after waiting for the fence of the frame slot it is about to reuse
+    void releaseRetiredBlocks(uint32_t framesInFlight);
+
+    VkBuffer getBuffer(uint32_t block) const { return m_blocks[block]->buffer; }
+    void bindBlock(VkCommandBuffer commandBuffer, uint32_t block, VkIndexType indexType) const;
+
+    // Repacks the live meshes into as few blocks as possible, one new block at a time, and destroys
+    // each old block as soon as everything in it has been copied out. Returns whether blocks were released.
+    // The caller has to make sure the GPU is not using the pool.
+    bool compact();
+
+    GeometryPoolStats getStats() const;
+
+    void cleanup();
+
+private:
+    struct Block {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VmaAllocation allocation = VK_NULL_HANDLE;
+        VkDeviceSize capacity = 0;
+        VkDeviceSize used = 0;
+        std::map<VkDeviceSize, VkDeviceSize> freeRanges;
+    };
+
+    struct RetiredBlock {
+        std::unique_ptr<Block> block;
+        uint64_t frame = 0;
+    };
+
+    std::unique_ptr<Block> createBlock(VkDeviceSize capacity);
+    void destroyBlock(Block& block);
+    bool allocateRange(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+    void freeRange(Block& block, VkDeviceSize offset, VkDeviceSize size);
+    bool allocateInBlock(uint32_t blockIndex, GeometryAllocation& allocation);
+    VkDeviceSize blockCapacityFor(VkDeviceSize requiredBytes) const;
+
+    VulkanDevice& m_device;
+    VkDeviceSize m_blockSize;
+
+    std::vector<std::unique_ptr<Block>> m_blocks;
+    std::unordered_set<GeometryAllocation*> m_allocations;
+    std::vector<RetiredBlock> m_retiredBlocks;
+    uint64_t m_frame = 0;
+};
+
+}
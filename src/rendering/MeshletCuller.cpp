@@ -0,0 +1,63 @@
+#include "MeshletCuller.hpp"
+
+namespace VulkanViewer {
+
+Frustum Frustum::fromMatrix(const glm::mat4& clipFromModel) {
+    glm::vec4 row0(clipFromModel[0][0], clipFromModel[1][0], clipFromModel[2][0], clipFromModel[3][0]);
+    glm::vec4 row1(clipFromModel[0][1], clipFromModel[1][1], clipFromModel[2][1], clipFromModel[3][1]);
+    glm::vec4 row2(clipFromModel[0][2], clipFromModel[1][2], clipFromModel[2][2], clipFromModel[3][2]);
+    glm::vec4 row3(clipFromModel[0][3], clipFromModel[1][3], clipFromModel[2][3], clipFromModel[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;
+    frustum.planes[1] = row3 - row0;
+    frustum.planes[2] = row3 + row1;
+    frustum.planes[3] = row3 - row1;
+    // -w <= z works for both depth conventions, it is just looser than 0 <= z for Vulkan's [0, 1]
+    frustum.planes[4] = row3 + row2;
+    frustum.planes[5] = row3 - row2;
+
+    for (auto& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+    return frustum;
+}
+
+void MeshletCuller::cull(const Mesh& mesh, const Frustum& frustum, const glm::vec3& eye, bool coneCulling,
+                         std::vector<IndexRange>& ranges, MeshletCullStats& stats) {
+    bool extending = false;
+    for (const Meshlet& meshlet : mesh.meshlets) {
+        stats.meshletsTested++;
+
+        bool visible = true;
+        for (const auto& plane : frustum.planes) {
+            if (glm::dot(glm::vec3(plane), meshlet.center) + plane.w < -meshlet.radius) {
+                visible = false;
+                break;
+            }
+        }
+        if (visible && coneCulling) {
+            glm::vec3 toCenter = meshlet.center - eye;
+            visible = glm::dot(toCenter, meshlet.coneAxis) < meshlet.coneCutoff * glm::length(toCenter) + meshlet.radius;
+        }
+
+        if (!visible) {
+            stats.meshletsCulled++;
+            stats.trianglesCulled += meshlet.triangleCount;
+            extending = false;
+            continue;
+        }
+
+        if (extending) {
+            ranges.back().indexCount += meshlet.triangleCount * 3;
+        } else {
+            ranges.push_back(IndexRange{meshlet.firstIndex, meshlet.triangleCount * 3});
+            extending = true;
+        }
+    }
+}
+
+}
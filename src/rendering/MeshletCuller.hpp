@@ -0,0 +1,39 @@
+#pragma once
+
+#include "../scene/Model.hpp"
+
+#include <vector>
+#include <glm/glm.hpp>
+
+namespace VulkanViewer {
+
+// Six clip planes with inward-facing normals, as a.x + b.y + c.z + d >= 0 for points inside
+struct Frustum {
+    glm::vec4 planes[6];
+
+    // Gribb/Hartmann extraction; pass projection * view * model to get the planes in model space
+    static Frustum fromMatrix(const glm::mat4& clipFromModel);
+};
+
+struct IndexRange {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+};
+
+struct MeshletCullStats {
+    uint64_t meshletsTested = 0;
+    uint64_t meshletsCulled = 0;
+    uint64_t trianglesCulled = 0;
+};
+
+// CPU meshlet culling for the vkCmdDrawIndexed path. Surviving meshlets that sit next to each
+// other in the index buffer are merged, so a fully visible mesh still costs a single draw.
+class MeshletCuller {
+public:
+    // Appends the visible index ranges of `mesh`, relative to its first index. The frustum and
+    // eye position are in model space; backface cones are only tested when coneCulling is set.
+    static void cull(const Mesh& mesh, const Frustum& frustum, const glm::vec3& eye, bool coneCulling,
+                     std::vector<IndexRange>& ranges, MeshletCullStats& stats);
+};
+
+}
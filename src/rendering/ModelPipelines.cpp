@@ -0,0 +1,104 @@
+#include "ModelPipelines.hpp"
+#include "Renderer.hpp"
+#include "../core/VulkanDevice.hpp"
+
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+
+namespace VulkanViewer {
+
+namespace {
+
+const char* MODEL_VERTEX_SHADER = "shaders/model_vert.spv";
+const char* MODEL_QUANTIZED_VERTEX_SHADER = "shaders/model_quantized_vert.spv";
+const char* MODEL_FRAGMENT_SHADER = "shaders/model_frag.spv";
+
+// Matches the constant_id declarations in model.frag
+struct ModelSpecialization {
+    VkBool32 textured;
+    int32_t lightCount;
+};
+
+}
+
+std::string describeModelVariant(ModelVariantKey key) {
+    uint32_t lightCount = getModelVariantLightCount(key);
+    std::string description = (key & MODEL_FEATURE_TEXTURED) ? "textured" : "untextured";
+    description += (key & MODEL_FEATURE_QUANTIZED) ? ", quantized, " : ", full, ";
+    description += std::to_string(lightCount) + (lightCount == 1 ? " light" : " lights");
+    return description;
+}
+
+std::array<VkPushConstantRange, 2> getModelPushConstantRanges() {
+    std::array<VkPushConstantRange, 2> ranges{};
+    ranges[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    ranges[0].offset = 0;
+    ranges[0].size = sizeof(PushConstants);
+    ranges[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    ranges[1].offset = sizeof(PushConstants);
+    ranges[1].size = sizeof(MaterialPushConstants);
+    return ranges;
+}
+
+ModelPipelineVariants::ModelPipelineVariants(VulkanDevice& device, PipelineLibrary& library, const GraphicsPipelineDesc& base)
+    : m_device(device), m_library(library), m_base(base) {
+    m_library.getShaderModule(MODEL_VERTEX_SHADER);
+    m_library.getShaderModule(MODEL_FRAGMENT_SHADER);
+
+    // Models fall back to full precision vertices without the dequantizing shader
+    m_supportsQuantized = m_library.findShaderModule(MODEL_QUANTIZED_VERTEX_SHADER) != VK_NULL_HANDLE;
+}
+
+ModelPipelineVariants::~ModelPipelineVariants() {
+    for (auto& entry : m_pipelines) {
+        if (entry.second != VK_NULL_HANDLE) {
+            vkDestroyPipeline(m_device.getDevice(), entry.second, nullptr);
+        }
+    }
+}
+
+GraphicsPipelineDesc ModelPipelineVariants::makeDesc(ModelVariantKey key) const {
+    GraphicsPipelineDesc desc = m_base;
+    bool quantized = (key & MODEL_FEATURE_QUANTIZED) != 0;
+    desc.vertexShader = quantized ? MODEL_QUANTIZED_VERTEX_SHADER : MODEL_VERTEX_SHADER;
+    desc.fragmentShader = MODEL_FRAGMENT_SHADER;
+    desc.vertexLayout = quantized ? VertexLayout::Quantized : VertexLayout::Full;
+
+    ModelSpecialization specialization{};
+    specialization.textured = (key & MODEL_FEATURE_TEXTURED) ? VK_TRUE : VK_FALSE;
+    specialization.lightCount = static_cast<int32_t>(getModelVariantLightCount(key));
+    desc.specializationEntries = {
+        {0, offsetof(ModelSpecialization, textured), sizeof(VkBool32)},
+        {1, offsetof(ModelSpecialization, lightCount), sizeof(int32_t)}
+    };
+    desc.specializationData.resize(sizeof(specialization));
+    memcpy(desc.specializationData.data(), &specialization, sizeof(specialization));
+    return desc;
+}
+
+void ModelPipelineVariants::request(ModelVariantKey key) {
+    if (m_pipelines.count(key) || ((key & MODEL_FEATURE_QUANTIZED) && !m_supportsQuantized)) {
+        return;
+    }
+    VkPipeline& pipeline = m_pipelines[key];
+    m_library.request(makeDesc(key), &pipeline);
+}
+
+VkPipeline ModelPipelineVariants::get(ModelVariantKey key) {
+    auto it = m_pipelines.find(key);
+    if (it != m_pipelines.end()) {
+        return it->second;
+    }
+    if ((key & MODEL_FEATURE_QUANTIZED) && !m_supportsQuantized) {
+        return VK_NULL_HANDLE;
+    }
+
+    // Compiled on the spot, which costs a hitch the first time; the pipeline cache keeps it for later runs
+    VkPipeline pipeline = m_library.build(makeDesc(key));
+    m_pipelines[key] = pipeline;
+    std::cout << "Built " << m_base.name << " variant (" << describeModelVariant(key) << ")" << std::endl;
+    return pipeline;
+}
+
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "PipelineLibrary.hpp"
+
+#include <array>
+#include <string>
+#include <unordered_map>
+
+namespace VulkanViewer {
+
+class VulkanDevice;
+
+// Features of a model pipeline variant; the light count is stored in the bits above them
+using ModelVariantKey = uint32_t;
+
+enum ModelFeatureBits : uint32_t {
+    MODEL_FEATURE_TEXTURED = 1u << 0,
+    MODEL_FEATURE_QUANTIZED = 1u << 1
+};
+
+const uint32_t MODEL_LIGHT_COUNT_SHIFT = 2;
+// model.frag has this many lights; the default matches the look from before variants existed
+const uint32_t MAX_MODEL_LIGHTS = 3;
+const uint32_t DEFAULT_MODEL_LIGHTS = 2;
+
+inline ModelVariantKey makeModelVariantKey(bool textured, bool quantized, uint32_t lightCount) {
+    return (textured ? MODEL_FEATURE_TEXTURED : 0u) | (quantized ? MODEL_FEATURE_QUANTIZED : 0u) |
+           (lightCount << MODEL_LIGHT_COUNT_SHIFT);
+}
+
+inline uint32_t getModelVariantLightCount(ModelVariantKey key) {
+    return key >> MODEL_LIGHT_COUNT_SHIFT;
+}
+
+// e.g. "textured, quantized, 2 lights"
+std::string describeModelVariant(ModelVariantKey key);
+
+// Vertex stage PushConstants followed by the fragment stage MaterialPushConstants
+std::array<VkPushConstantRange, 2> getModelPushConstantRanges();
+
+// Model pipelines specialised per feature set. Texturing and the light count are specialization
+// constants of model.frag, the vertex format picks the vertex shader. Variants are built through
+// the library the first time a draw asks for one, unless requested for startup. Render thread only.
+class ModelPipelineVariants {
+public:
+    // `base` supplies the name, layout and render pass; shaders and specialization come from the key
+    ModelPipelineVariants(VulkanDevice& device, PipelineLibrary& library, const GraphicsPipelineDesc& base);
+    ~ModelPipelineVariants();
+
+    ModelPipelineVariants(const ModelPipelineVariants&) = delete;
+    ModelPipelineVariants& operator=(const ModelPipelineVariants&) = delete;
+
+    // False when the quantized vertex shader is missing; quantized variants are never built then
+    bool supportsQuantized() const { return m_supportsQuantized; }
+
+    // Queued for the library's next buildPending, for the variants most scenes need
+    void request(ModelVariantKey key);
+    // VK_NULL_HANDLE for quantized keys without quantized support
+    VkPipeline get(ModelVariantKey key);
+
+    size_t getVariantCount() const { return m_pipelines.size(); }
+
+private:
+    GraphicsPipelineDesc makeDesc(ModelVariantKey key) const;
+
+    VulkanDevice& m_device;
+    PipelineLibrary& m_library;
+    GraphicsPipelineDesc m_base;
+    bool m_supportsQuantized = false;
+    // Node based, so the pointers handed to PipelineLibrary::request stay valid while more are added
+    std::unordered_map<ModelVariantKey, VkPipeline> m_pipelines;
+};
+
+}
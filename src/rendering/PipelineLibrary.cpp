@@ -0,0 +1,326 @@
+#include "PipelineLibrary.hpp"
+#include "../core/VulkanDevice.hpp"
+#include "../core/ThreadPool.hpp"
+#include "../scene/Model.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+namespace VulkanViewer {
+
+namespace {
+
+bool readBinaryFile(const std::string& path, std::vector<char>& data) {
+    std::ifstream file(path, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    data.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(data.data(), static_cast<std::streamsize>(data.size()));
+    return static_cast<bool>(file);
+}
+
+}
+
+PipelineLibrary::PipelineLibrary(VulkanDevice& device, const std::string& cachePath)
+    : m_device(device), m_cachePath(cachePath) {
+    loadCache();
+}
+
+PipelineLibrary::~PipelineLibrary() {
+    saveCache();
+    for (auto& entry : m_shaderModules) {
+        if (entry.second != VK_NULL_HANDLE) {
+            vkDestroyShaderModule(m_device.getDevice(), entry.second, nullptr);
+        }
+    }
+    vkDestroyPipelineCache(m_device.getDevice(), m_cache, nullptr);
+}
+
+bool PipelineLibrary::isCacheCompatible(const std::vector<char>& data) const {
+    VkPipelineCacheHeaderVersionOne header{};
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    memcpy(&header, data.data(), sizeof(header));
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_device.getPhysicalDevice(), &properties);
+    return header.headerSize >= sizeof(header) &&
+           header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+           header.vendorID == properties.vendorID &&
+           header.deviceID == properties.deviceID &&
+           memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineLibrary::loadCache() {
+    std::vector<char> data;
+    if (readBinaryFile(m_cachePath, data)) {
+        if (isCacheCompatible(data)) {
+            m_stats.warmCache = true;
+            m_stats.cacheBytesLoaded = data.size();
+        } else {
+            std::cout << "Pipeline cache " << m_cachePath << " was written for another device or driver, rebuilding" << std::endl;
+            data.clear();
+        }
+    }
+
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cacheInfo.initialDataSize = data.size();
+    cacheInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+    if (vkCreatePipelineCache(m_device.getDevice(), &cacheInfo, nullptr, &m_cache) != VK_SUCCESS) {
+        // Drivers may still reject data whose header looked right
+        cacheInfo.initialDataSize = 0;
+        cacheInfo.pInitialData = nullptr;
+        m_stats.warmCache = false;
+        m_stats.cacheBytesLoaded = 0;
+        if (vkCreatePipelineCache(m_device.getDevice(), &cacheInfo, nullptr, &m_cache) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create pipeline cache!");
+        }
+    }
+}
+
+void PipelineLibrary::saveCache() {
+    size_t size = 0;
+    if (vkGetPipelineCacheData(m_device.getDevice(), m_cache, &size, nullptr) != VK_SUCCESS || size == 0) {
+        return;
+    }
+    std::vector<char> data(size);
+    if (vkGetPipelineCacheData(m_device.getDevice(), m_cache, &size, data.data()) != VK_SUCCESS) {
+        return;
+    }
+    data.resize(size);
+
+    std::error_code error;
+    fs::path path(m_cachePath);
+    if (path.has_parent_path()) {
+        fs::create_directories(path.parent_path(), error);
+    }
+
+    // Written next to the old file and renamed over it, so a crash never leaves half a cache behind
+    std::string tempPath = m_cachePath + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!file) {
+            std::cerr << "Failed to write pipeline cache file: " << tempPath << std::endl;
+            file.close();
+            fs::remove(tempPath, error);
+            return;
+        }
+    }
+    fs::remove(m_cachePath, error);
+    fs::rename(tempPath, m_cachePath, error);
+    if (error) {
+        std::cerr << "Failed to finalize pipeline cache file " << m_cachePath << ": " << error.message() << std::endl;
+        fs::remove(tempPath, error);
+    }
+}
+
+VkShaderModule PipelineLibrary::findShaderModule(const std::string& path) {
+    auto it = m_shaderModules.find(path);
+    if (it != m_shaderModules.end()) {
+        return it->second;
+    }
+
+    VkShaderModule shaderModule = VK_NULL_HANDLE;
+    std::vector<char> code;
+    if (readBinaryFile(path, code) && !code.empty()) {
+        VkShaderModuleCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        createInfo.codeSize = code.size();
+        createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+        if (vkCreateShaderModule(m_device.getDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create shader module: " + path);
+        }
+        m_stats.shaderModules++;
+    }
+    m_shaderModules[path] = shaderModule;
+    return shaderModule;
+}
+
+VkShaderModule PipelineLibrary::getShaderModule(const std::string& path) {
+    VkShaderModule shaderModule = findShaderModule(path);
+    if (shaderModule == VK_NULL_HANDLE) {
+        throw std::runtime_error("failed to open file: " + path);
+    }
+    return shaderModule;
+}
+
+void PipelineLibrary::request(const GraphicsPipelineDesc& desc, VkPipeline* pipeline) {
+    // Shaders are loaded here, on the requesting thread, so the workers only touch the device
+    getShaderModule(desc.vertexShader);
+    getShaderModule(desc.fragmentShader);
+    m_pending.push_back(PendingPipeline{desc, pipeline});
+}
+
+void PipelineLibrary::buildPending() {
+    if (m_pending.empty()) {
+        return;
+    }
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    // Drivers compile each pipeline on the thread that creates it; the cache is internally synchronized
+    std::vector<PendingPipeline> pending;
+    pending.swap(m_pending);
+    ThreadPool::get().parallelFor(pending.size(), [&](size_t i) {
+        *pending[i].pipeline = createPipeline(pending[i].desc);
+    });
+
+    double milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    m_stats.pipelines += static_cast<uint32_t>(pending.size());
+    m_stats.buildMilliseconds += milliseconds;
+    std::cout << "Built " << pending.size() << " pipelines in " << milliseconds << " ms ("
+              << (m_stats.warmCache ? "warm" : "cold") << " pipeline cache)" << std::endl;
+}
+
+VkPipeline PipelineLibrary::build(const GraphicsPipelineDesc& desc) {
+    getShaderModule(desc.vertexShader);
+    getShaderModule(desc.fragmentShader);
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    VkPipeline pipeline = createPipeline(desc);
+    m_stats.pipelines++;
+    m_stats.buildMilliseconds += std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    return pipeline;
+}
+
+VkPipeline PipelineLibrary::createPipeline(const GraphicsPipelineDesc& desc) const {
+    std::array<VkPipelineShaderStageCreateInfo, 2> shaderStages{};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = m_shaderModules.at(desc.vertexShader);
+    shaderStages[0].pName = "main";
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = m_shaderModules.at(desc.fragmentShader);
+    shaderStages[1].pName = "main";
+
+    VkSpecializationInfo specializationInfo{};
+    if (!desc.specializationEntries.empty()) {
+        specializationInfo.mapEntryCount = static_cast<uint32_t>(desc.specializationEntries.size());
+        specializationInfo.pMapEntries = desc.specializationEntries.data();
+        specializationInfo.dataSize = desc.specializationData.size();
+        specializationInfo.pData = desc.specializationData.data();
+        shaderStages[0].pSpecializationInfo = &specializationInfo;
+        shaderStages[1].pSpecializationInfo = &specializationInfo;
+    }
+
+    VkVertexInputBindingDescription binding{};
+    std::array<VkVertexInputAttributeDescription, 3> attributes{};
+    if (desc.vertexLayout == VertexLayout::Full) {
+        binding = Vertex::getBindingDescription();
+        attributes = Vertex::getAttributeDescriptions();
+    } else if (desc.vertexLayout == VertexLayout::Quantized) {
+        binding = QuantizedVertex::getBindingDescription();
+        attributes = QuantizedVertex::getAttributeDescriptions();
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    if (desc.vertexLayout != VertexLayout::None) {
+        vertexInputInfo.vertexBindingDescriptionCount = 1;
+        vertexInputInfo.pVertexBindingDescriptions = &binding;
+        vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+        vertexInputInfo.pVertexAttributeDescriptions = attributes.data();
+    }
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_NONE;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    rasterizer.depthBiasEnable = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = desc.depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable = VK_FALSE;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = desc.alphaBlend ? VK_TRUE : VK_FALSE;
+    if (desc.alphaBlend) {
+        colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
+        colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    }
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.logicOp = VK_LOGIC_OP_COPY;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &colorBlendAttachment;
+
+    std::array<VkDynamicState, 2> dynamicStates = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = static_cast<uint32_t>(shaderStages.size());
+    pipelineInfo.pStages = shaderStages.data();
+    pipelineInfo.pVertexInputState = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = desc.layout;
+    pipelineInfo.renderPass = desc.renderPass;
+    pipelineInfo.subpass = 0;
+    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(m_device.getDevice(), m_cache, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS) {
+        throw std::runtime_error(std::string("failed to create ") + desc.name + "!");
+    }
+    return pipeline;
+}
+
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace VulkanViewer {
+
+class VulkanDevice;
+
+enum class VertexLayout {
+    None,
+    Full,
+    Quantized
+};
+
+// The parts of a graphics pipeline that differ between the viewer's pipelines. Everything else is
+// shared: triangle lists, no culling, one sample, depth test LESS, dynamic viewport and scissor.
+struct GraphicsPipelineDesc {
+    const char* name = "pipeline";
+    std::string vertexShader;
+    std::string fragmentShader;
+    VertexLayout vertexLayout = VertexLayout::Full;
+    bool depthWrite = true;
+    bool alphaBlend = false;
+    VkPipelineLayout layout = VK_NULL_HANDLE;
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    // Specialization constants for both stages; a stage ignores the IDs its shader does not declare
+    std::vector<VkSpecializationMapEntry> specializationEntries;
+    std::vector<uint8_t> specializationData;
+};
+
+struct PipelineLibraryStats {
+    // Whether the cache file matched this device; a cold start compiles every pipeline from scratch
+    bool warmCache = false;
+    size_t cacheBytesLoaded = 0;
+    uint32_t shaderModules = 0;
+    uint32_t pipelines = 0;
+    double buildMilliseconds = 0.0;
+};
+
+// Shader modules, a VkPipelineCache kept on disk between runs, and pipeline creation. Shaders are
+// read once per path and shared by every pipeline using them. Pipelines requested during startup are
+// built together on the thread pool, all through the one cache. Render thread only, apart from
+// the builds buildPending hands to the pool.
+class PipelineLibrary {
+public:
+    explicit PipelineLibrary(VulkanDevice& device, const std::string& cachePath = "cache/pipelines.bin");
+    ~PipelineLibrary();
+
+    PipelineLibrary(const PipelineLibrary&) = delete;
+    PipelineLibrary& operator=(const PipelineLibrary&) = delete;
+
+    // Throws when the file is missing; findShaderModule returns VK_NULL_HANDLE instead
+    VkShaderModule getShaderModule(const std::string& path);
+    VkShaderModule findShaderModule(const std::string& path);
+
+    // `*pipeline` is written by the next buildPending; the caller owns the pipeline after that
+    void request(const GraphicsPipelineDesc& desc, VkPipeline* pipeline);
+    void buildPending();
+
+    // Builds one pipeline on the calling thread
+    VkPipeline build(const GraphicsPipelineDesc& desc);
+
+    // Also done on destruction, so whatever later runs compile is kept too
+    void saveCache();
+
+    VkPipelineCache getCache() const { return m_cache; }
+    PipelineLibraryStats getStats() const { return m_stats; }
+
+private:
+    struct PendingPipeline {
+        GraphicsPipelineDesc desc;
+        VkPipeline* pipeline;
+    };
+
+    // Safe on any thread once the desc's shaders are loaded
+    VkPipeline createPipeline(const GraphicsPipelineDesc& desc) const;
+    void loadCache();
+    // Falls back to an empty cache when the file was written by another driver or device
+    bool isCacheCompatible(const std::vector<char>& data) const;
+
+    VulkanDevice& m_device;
+    std::string m_cachePath;
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+
+    // Missing files map to VK_NULL_HANDLE, so they are only looked for once
+    std::unordered_map<std::string, VkShaderModule> m_shaderModules;
+    std::vector<PendingPipeline> m_pending;
+    PipelineLibraryStats m_stats;
+};
+
+}
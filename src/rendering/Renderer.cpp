@@ -1,21 +1,33 @@
 #include "Renderer.hpp"
 #include "../core/VulkanDevice.hpp"
+#include "../core/UploadBatcher.hpp"
 #include "SwapChain.hpp"
 #include "ThumbnailRenderer.hpp"
+#include "GeometryPool.hpp"
+#include "TextureCache.hpp"
+#include "PipelineLibrary.hpp"
+#include "MeshletCuller.hpp"
 #include "../scene/Scene.hpp"
 #include "../scene/Camera.hpp"
 #include "../scene/Model.hpp"
 
 #include <stdexcept>
+#include <algorithm>
 #include <array>
-#include <fstream>
 #include <chrono>
 #include <iostream>
+#include <limits>
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace VulkanViewer {
 
 Renderer::Renderer(VulkanDevice& device, uint32_t width, uint32_t height) : m_device(device) {
+    m_geometryPool = std::make_unique<GeometryPool>(device);
+    m_device.setGeometryPool(m_geometryPool.get());
+    m_textureCache = std::make_unique<TextureCache>(device);
+    m_device.setTextureCache(m_textureCache.get());
+    m_pipelineLibrary = std::make_unique<PipelineLibrary>(device);
+    
     m_swapChain = std::make_unique<SwapChain>(device, width, height);
     createRenderPass();
     createFramebuffers();
@@ -25,9 +37,14 @@ Renderer::Renderer(VulkanDevice& device, uint32_t width, uint32_t height) : m_de
     createModelPipeline();
     createCommandBuffers();
     createSyncObjects();
+    createTimestampQueries();
     
 
     m_thumbnailRenderer = std::make_unique<ThumbnailRenderer>(device, *this);
+
+
+    // Every pipeline above was only requested; they compile side by side on the thread pool
+    m_pipelineLibrary->buildPending();
 }
 
 Renderer::~Renderer() {
@@ -50,6 +67,7 @@ void Renderer::recreateSwapChain(uint32_t width, uint32_t height) {
 
 void Renderer::beginFrame() {
     vkWaitForFences(m_device.getDevice(), 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
+    readVariantTimestamps(m_currentFrame);
     
     VkResult result = vkAcquireNextImageKHR(m_device.getDevice(), m_swapChain->getSwapChain(), UINT64_MAX, 
                                            m_imageAvailableSemaphores[m_currentFrame], VK_NULL_HANDLE, &m_imageIndex);
@@ -62,6 +80,7 @@ void Renderer::beginFrame() {
     }
     
     vkResetFences(m_device.getDevice(), 1, &m_inFlightFences[m_currentFrame]);
+    m_geometryPool->releaseRetiredBlocks(MAX_FRAMES_IN_FLIGHT);
     
     vkResetCommandBuffer(m_commandBuffers[m_currentFrame], 0);
     
@@ -72,6 +91,17 @@ void Renderer::beginFrame() {
         throw std::runtime_error("Failed to begin recording command buffer!");
     }
     
+    
+    if (m_timestampPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(m_commandBuffers[m_currentFrame], m_timestampPool,
+                            static_cast<uint32_t>(m_currentFrame) * MAX_VARIANT_TIMESTAMPS, MAX_VARIANT_TIMESTAMPS);
+    }
+    
+    // Uploads that have landed by now become drawable this frame; later ones keep streaming and their
+    // models are skipped. Ownership transfers have to be taken outside the render pass.
+    m_drawableUploads = m_device.getCompletedUploadTicket();
+    m_device.recordUploadAcquires(m_commandBuffers[m_currentFrame], m_drawableUploads);
+    
     VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = m_renderPass;
@@ -105,43 +135,122 @@ void Renderer::renderScene(const Scene& scene) {
     vkCmdSetScissor(m_commandBuffers[m_currentFrame], 0, 1, &scissor);
     
 
+    m_renderStats = RenderStats{};
     const auto& models = scene.getModels();
     if (!models.empty()) {
-        vkCmdBindPipeline(m_commandBuffers[m_currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS, m_modelPipeline);
-        
-       
         updateModelUniformBuffer(m_currentFrame, scene, nullptr);
         
+        
+        // proj[1][1] is 1 / tan(fov / 2), so this is the height in pixels of one unit seen from one unit away
+        glm::vec3 cameraPosition = scene.getCamera().getPosition();
+        glm::mat4 projection = scene.getCamera().getProjectionMatrix();
+        float pixelsPerUnit = std::abs(projection[1][1]) * 0.5f * viewport.height;
+        glm::mat4 viewProjection = projection * scene.getCamera().getViewMatrix();
+        
+        uint32_t boundBlock = UINT32_MAX;
+        VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+        ModelVariantKey boundVariant = UINT32_MAX;
+        
         for (const auto& model : models) {
+            if (model->getUploadTicket() > m_drawableUploads) {
+                m_renderStats.streamingModels++;
+                continue;
+            }
 
             PushConstants pushConstants{};
-            pushConstants.model = model->getTransform();
-            
-           
-            pushConstants.materialDiffuse = glm::vec3(0.9f, 0.9f, 0.9f);
-            pushConstants.hasTexture = 0.0f;
+            MaterialPushConstants materialConstants{};
             
 
             const auto& meshes = model->getMeshes();
             const auto& materials = model->getMaterials();
+            float modelErrorScale = projectedErrorScale(*model, cameraPosition, pixelsPerUnit);
+            bool cullMeshlets = m_meshletCulling != MeshletCulling::Off;
             
-            for (size_t i = 0; i < meshes.size(); i++) {
-                const Mesh& mesh = meshes[i];
+            // Shared meshes are stored once; every node that uses one is a separate draw with its own transform
+            for (const MeshInstance& instance : model->getInstances()) {
+                if (instance.meshIndex >= meshes.size()) {
+                    continue;
+                }
+                const Mesh& mesh = meshes[instance.meshIndex];
+                if (!mesh.geometry || (mesh.quantized && !m_modelPipelines->supportsQuantized())) {
+                    continue;
+                }
+                glm::mat4 transform = model->getTransform() * instance.transform;
+                pushConstants.model = transform;
+                float errorScale = modelErrorScale * maxAxisScale(instance.transform);
                 
-
+                
+                // Meshlet bounds are in mesh space, so bring the frustum and the eye to the mesh instead
+                bool coneCulling = false;
+                Frustum frustum{};
+                glm::vec3 eye(0.0f);
+                if (cullMeshlets && !mesh.meshlets.empty()) {
+                    frustum = Frustum::fromMatrix(viewProjection * transform);
+                    eye = glm::vec3(glm::inverse(transform) * glm::vec4(cameraPosition, 1.0f));
+                    coneCulling = m_meshletCulling == MeshletCulling::FrustumAndCone && preservesFaceNormals(transform);
+                }
+                
+                
+                // Levels are ordered finest first, so keep stepping down while the error stays invisible
+                const MeshLod* selectedLod = nullptr;
+                if (m_lodErrorPixels > 0.0f) {
+                    for (const MeshLod& lod : mesh.lods) {
+                        if (lod.error * errorScale > m_lodErrorPixels) {
+                            break;
+                        }
+                        selectedLod = &lod;
+                    }
+                }
+                
+                
+                // Meshlets only partition the full-detail level; simplified levels draw as one range
+                m_drawRanges.clear();
+                if (selectedLod) {
+                    m_drawRanges.push_back(IndexRange{selectedLod->firstIndex, selectedLod->indexCount});
+                } else if (cullMeshlets && !mesh.meshlets.empty()) {
+                    MeshletCullStats cullStats;
+                    MeshletCuller::cull(mesh, frustum, eye, coneCulling, m_drawRanges, cullStats);
+                    m_renderStats.meshletsTested += cullStats.meshletsTested;
+                    m_renderStats.meshletsCulled += cullStats.meshletsCulled;
+                    m_renderStats.culledTriangles += cullStats.trianglesCulled;
+                } else {
+                    m_drawRanges.push_back(IndexRange{0, static_cast<uint32_t>(mesh.indices.size())});
+                }
+                m_renderStats.fullDetailTriangles += mesh.indices.size() / 3;
+                if (m_drawRanges.empty()) {
+                    continue;
+                }
+                
+                
+                // Meshes without a material keep the default grey
+                bool textured = false;
+                materialConstants.diffuse = glm::vec3(0.9f, 0.9f, 0.9f);
                 if (mesh.materialIndex < materials.size()) {
-                    const auto& material = materials[mesh.materialIndex];
-                    pushConstants.materialDiffuse = material.diffuse;
-                    
-
-                    VkImageView textureView = model->getMaterialTextureView(mesh.materialIndex);
-                    pushConstants.hasTexture = (textureView != VK_NULL_HANDLE) ? 1.0f : 0.0f;
+                    materialConstants.diffuse = materials[mesh.materialIndex].diffuse;
+                    textured = model->getMaterialTextureView(mesh.materialIndex) != VK_NULL_HANDLE;
                 }
                 
+                
+                // Every variant shares the pipeline layout, so descriptor sets stay bound across switches
+                ModelVariantKey variant = makeModelVariantKey(textured, mesh.quantized, m_lightCount);
+                if (variant != boundVariant) {
+                    boundVariant = variant;
+                    writeVariantTimestamp(variant);
+                    vkCmdBindPipeline(m_commandBuffers[m_currentFrame], VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                      m_modelPipelines->get(variant));
+                }
+                pushConstants.quantScale = mesh.quantScale;
+                pushConstants.quantOffset = mesh.quantOffset;
+                pushConstants.setUVTransform(model->getMaterialUVTransform(mesh.materialIndex));
+                
 
-                vkCmdPushConstants(m_commandBuffers[m_currentFrame], m_modelPipelineLayout, 
-                                  VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 
-                                  0, sizeof(PushConstants), &pushConstants);
+                vkCmdPushConstants(m_commandBuffers[m_currentFrame], m_modelPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                                   0, sizeof(PushConstants), &pushConstants);
+                // Textured variants sample the material instead, so they skip the fragment range
+                if (!textured) {
+                    vkCmdPushConstants(m_commandBuffers[m_currentFrame], m_modelPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                                       sizeof(PushConstants), sizeof(MaterialPushConstants), &materialConstants);
+                }
                 
                
                 updateDescriptorSetForMesh(model.get(), mesh.materialIndex);
@@ -150,13 +259,24 @@ void Renderer::renderScene(const Scene& scene) {
                 
                 
                
-                VkBuffer vertexBuffers[] = {mesh.vertexBuffer};
-                VkDeviceSize offsets[] = {0};
-                vkCmdBindVertexBuffers(m_commandBuffers[m_currentFrame], 0, 1, vertexBuffers, offsets);
-                vkCmdBindIndexBuffer(m_commandBuffers[m_currentFrame], mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-                vkCmdDrawIndexed(m_commandBuffers[m_currentFrame], static_cast<uint32_t>(mesh.indices.size()), 1, 0, 0, 0);
+                // Geometry lives in a handful of pool blocks, rebind only when the block or index width changes
+                if (mesh.geometry->block != boundBlock || mesh.geometry->getIndexType() != boundIndexType) {
+                    boundBlock = mesh.geometry->block;
+                    boundIndexType = mesh.geometry->getIndexType();
+                    m_geometryPool->bindBlock(m_commandBuffers[m_currentFrame], boundBlock, boundIndexType);
+                }
+                for (const IndexRange& range : m_drawRanges) {
+                    vkCmdDrawIndexed(m_commandBuffers[m_currentFrame], range.indexCount, 1,
+                                     mesh.geometry->firstIndex + range.firstIndex, mesh.geometry->vertexOffset, 0);
+                    m_renderStats.submittedTriangles += range.indexCount / 3;
+                    m_renderStats.drawCalls++;
+                }
+                if (m_timestampPool != VK_NULL_HANDLE && !m_timedVariants[m_currentFrame].empty()) {
+                    m_timedVariants[m_currentFrame].back().drawCalls += static_cast<uint32_t>(m_drawRanges.size());
+                }
             }
         }
+        closeVariantTimestamps();
     }
     
 
@@ -167,6 +287,95 @@ void Renderer::renderScene(const Scene& scene) {
     vkCmdDraw(m_commandBuffers[m_currentFrame], 6, 1, 0, 0); 
 }
 
+void Renderer::writeVariantTimestamp(ModelVariantKey key) {
+    if (m_timestampPool == VK_NULL_HANDLE) {
+        return;
+    }
+    
+    // One query stays free to close the last variant; past that its time runs to the end of the model draws
+    std::vector<VariantGpuTime>& timed = m_timedVariants[m_currentFrame];
+    if (timed.size() + 1 >= MAX_VARIANT_TIMESTAMPS) {
+        return;
+    }
+    uint32_t query = static_cast<uint32_t>(m_currentFrame) * MAX_VARIANT_TIMESTAMPS + static_cast<uint32_t>(timed.size());
+    vkCmdWriteTimestamp(m_commandBuffers[m_currentFrame], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool, query);
+    timed.push_back(VariantGpuTime{key, 0.0, 0});
+}
+
+void Renderer::closeVariantTimestamps() {
+    const std::vector<VariantGpuTime>& timed = m_timedVariants[m_currentFrame];
+    if (m_timestampPool == VK_NULL_HANDLE || timed.empty()) {
+        return;
+    }
+    uint32_t query = static_cast<uint32_t>(m_currentFrame) * MAX_VARIANT_TIMESTAMPS + static_cast<uint32_t>(timed.size());
+    vkCmdWriteTimestamp(m_commandBuffers[m_currentFrame], VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestampPool, query);
+}
+
+void Renderer::readVariantTimestamps(size_t frame) {
+    std::vector<VariantGpuTime>& timed = m_timedVariants[frame];
+    if (m_timestampPool == VK_NULL_HANDLE || timed.empty()) {
+        return;
+    }
+    
+    std::array<uint64_t, MAX_VARIANT_TIMESTAMPS> timestamps{};
+    uint32_t queryCount = static_cast<uint32_t>(timed.size()) + 1;
+    VkResult result = vkGetQueryPoolResults(m_device.getDevice(), m_timestampPool,
+                                            static_cast<uint32_t>(frame) * MAX_VARIANT_TIMESTAMPS, queryCount,
+                                            sizeof(uint64_t) * queryCount, timestamps.data(), sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT);
+    if (result == VK_SUCCESS) {
+        
+        // Bottom-of-pipe timestamps, so each span also holds whatever of the previous draws was still in flight
+        m_variantGpuTimes.clear();
+        for (size_t i = 0; i < timed.size(); i++) {
+            uint64_t ticks = (timestamps[i + 1] - timestamps[i]) & m_timestampMask;
+            auto it = std::find_if(m_variantGpuTimes.begin(), m_variantGpuTimes.end(),
+                                   [&](const VariantGpuTime& entry) { return entry.key == timed[i].key; });
+            if (it == m_variantGpuTimes.end()) {
+                it = m_variantGpuTimes.insert(m_variantGpuTimes.end(), VariantGpuTime{timed[i].key, 0.0, 0});
+            }
+            it->milliseconds += ticks * m_timestampPeriod / 1.0e6;
+            it->drawCalls += timed[i].drawCalls;
+        }
+        std::sort(m_variantGpuTimes.begin(), m_variantGpuTimes.end(),
+                  [](const VariantGpuTime& a, const VariantGpuTime& b) { return a.key < b.key; });
+        m_modelGpuMilliseconds = ((timestamps[timed.size()] - timestamps[0]) & m_timestampMask) * m_timestampPeriod / 1.0e6;
+    }
+    timed.clear();
+}
+
+float Renderer::maxAxisScale(const glm::mat4& transform) {
+    return std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])),
+                     glm::length(glm::vec3(transform[2]))});
+}
+
+bool Renderer::preservesFaceNormals(const glm::mat4& transform) {
+    float x = glm::length(glm::vec3(transform[0]));
+    float y = glm::length(glm::vec3(transform[1]));
+    float z = glm::length(glm::vec3(transform[2]));
+    float largest = std::max({x, y, z});
+    float smallest = std::min({x, y, z});
+    return smallest > 0.0f && largest <= smallest * 1.01f && glm::determinant(glm::mat3(transform)) > 0.0f;
+}
+
+float Renderer::projectedErrorScale(const Model& model, const glm::vec3& cameraPosition, float pixelsPerUnit) const {
+    glm::mat4 transform = model.getTransform();
+    float scale = maxAxisScale(transform);
+    
+    glm::vec3 boundsMin = model.getBoundsMin();
+    glm::vec3 boundsMax = model.getBoundsMax();
+    glm::vec3 center = glm::vec3(transform * glm::vec4((boundsMin + boundsMax) * 0.5f, 1.0f));
+    float radius = 0.5f * glm::length(boundsMax - boundsMin) * scale;
+    
+    
+    // Measured from the nearest point of the bounding sphere; inside it everything stays at full detail
+    float distance = glm::length(center - cameraPosition) - radius;
+    if (distance <= 0.0f) {
+        return std::numeric_limits<float>::max();
+    }
+    return scale * pixelsPerUnit / distance;
+}
+
 void Renderer::endFrame() {
     vkCmdEndRenderPass(m_commandBuffers[m_currentFrame]);
     
@@ -177,9 +386,19 @@ void Renderer::endFrame() {
     VkSubmitInfo submitInfo{};
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     
-    VkSemaphore waitSemaphores[] = {m_imageAvailableSemaphores[m_currentFrame]};
-    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-    submitInfo.waitSemaphoreCount = 1;
+    // The upload wait has already been satisfied when the frame was recorded, so it never stalls; it is
+    // what orders the acquires and the first draws after the transfer queue's copies
+    VkSemaphore waitSemaphores[] = {m_imageAvailableSemaphores[m_currentFrame], m_device.getUploadTimeline()};
+    VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+    uint64_t waitValues[] = {0, m_drawableUploads};
+    
+    submitInfo.waitSemaphoreCount = m_drawableUploads > 0 ? 2 : 1;
+    
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = submitInfo.waitSemaphoreCount;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    submitInfo.pNext = &timelineInfo;
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     
@@ -327,61 +546,58 @@ void Renderer::createSyncObjects() {
     }
 }
 
-std::vector<char> Renderer::readFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+void Renderer::createTimestampQueries() {
+    m_timedVariants.resize(MAX_FRAMES_IN_FLIGHT);
     
-    if (!file.is_open()) {
-        throw std::runtime_error("failed to open file!");
-    }
-    
-    size_t fileSize = (size_t) file.tellg();
-    std::vector<char> buffer(fileSize);
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_device.getPhysicalDevice(), &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_device.getPhysicalDevice(), &familyCount, families.data());
+    uint32_t validBits = families[m_device.getQueueFamilies().graphicsFamily.value()].timestampValidBits;
     
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_device.getPhysicalDevice(), &properties);
+    if (validBits == 0 || properties.limits.timestampPeriod <= 0.0f) {
+        std::cout << "Graphics queue has no timestamp support, variant GPU times disabled" << std::endl;
+        return;
+    }
+    m_timestampPeriod = properties.limits.timestampPeriod;
+    m_timestampMask = validBits >= 64 ? UINT64_MAX : (uint64_t(1) << validBits) - 1;
     
-    return buffer;
-}
-
-VkShaderModule Renderer::createShaderModule(const std::vector<char>& code) {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+    VkQueryPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = MAX_VARIANT_TIMESTAMPS * MAX_FRAMES_IN_FLIGHT;
     
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(m_device.getDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create shader module!");
+    if (vkCreateQueryPool(m_device.getDevice(), &poolInfo, nullptr, &m_timestampPool) != VK_SUCCESS) {
+        throw std::runtime_error("failed to create timestamp query pool!");
     }
-    
-    return shaderModule;
 }
 
 void Renderer::createUniformBuffers() {
     VkDeviceSize bufferSize = sizeof(UniformBufferObject);
 
     m_modelUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    m_modelUniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+    m_modelUniformBuffersAllocation.resize(MAX_FRAMES_IN_FLIGHT);
     m_modelUniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
 
 
     m_gridUniformBuffers.resize(MAX_FRAMES_IN_FLIGHT);
-    m_gridUniformBuffersMemory.resize(MAX_FRAMES_IN_FLIGHT);
+    m_gridUniformBuffersAllocation.resize(MAX_FRAMES_IN_FLIGHT);
     m_gridUniformBuffersMapped.resize(MAX_FRAMES_IN_FLIGHT);
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 
         m_device.createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-                             m_modelUniformBuffers[i], m_modelUniformBuffersMemory[i]);
-        vkMapMemory(m_device.getDevice(), m_modelUniformBuffersMemory[i], 0, bufferSize, 0, &m_modelUniformBuffersMapped[i]);
+                             m_modelUniformBuffers[i], m_modelUniformBuffersAllocation[i], MemoryCategory::Uniform);
+        m_modelUniformBuffersMapped[i] = m_device.mapMemory(m_modelUniformBuffersAllocation[i]);
 
 
         m_device.createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, 
                              VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 
-                             m_gridUniformBuffers[i], m_gridUniformBuffersMemory[i]);
-        vkMapMemory(m_device.getDevice(), m_gridUniformBuffersMemory[i], 0, bufferSize, 0, &m_gridUniformBuffersMapped[i]);
+                             m_gridUniformBuffers[i], m_gridUniformBuffersAllocation[i], MemoryCategory::Uniform);
+        m_gridUniformBuffersMapped[i] = m_device.mapMemory(m_gridUniformBuffersAllocation[i]);
     }
 }
 
@@ -561,95 +777,6 @@ void Renderer::createGridPipeline() {
     }
     
  
-    auto vertShaderCode = readFile("shaders/grid_vert.spv");
-    auto fragShaderCode = readFile("shaders/grid_frag.spv");
-    
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
-    
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
-    vertShaderStageInfo.pName = "main";
-    
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName = "main";
-    
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
-    
-
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 0;
-    vertexInputInfo.vertexAttributeDescriptionCount = 0;
-    
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-    
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.scissorCount = 1;
-    
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_NONE; 
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-    
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    
-    VkPipelineDepthStencilStateCreateInfo depthStencil{};
-    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_FALSE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-    depthStencil.depthBoundsTestEnable = VK_FALSE;
-    depthStencil.stencilTestEnable = VK_FALSE;
-    
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_TRUE;
-    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
-    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
-    colorBlendAttachment.colorBlendOp = VK_BLEND_OP_ADD;
-    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-    colorBlendAttachment.alphaBlendOp = VK_BLEND_OP_ADD;
-    
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f;
-    colorBlending.blendConstants[1] = 0.0f;
-    colorBlending.blendConstants[2] = 0.0f;
-    colorBlending.blendConstants[3] = 0.0f;
-    
-    std::vector<VkDynamicState> dynamicStates = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR
-    };
-    VkPipelineDynamicStateCreateInfo dynamicState{};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-    dynamicState.pDynamicStates = dynamicStates.data();
-    
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = 1;
@@ -659,161 +786,48 @@ void Renderer::createGridPipeline() {
         throw std::runtime_error("failed to create pipeline layout!");
     }
     
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = &depthStencil;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = &dynamicState;
-    pipelineInfo.layout = m_gridPipelineLayout;
-    pipelineInfo.renderPass = m_renderPass;
-    pipelineInfo.subpass = 0;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-    
-    if (vkCreateGraphicsPipelines(m_device.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_gridPipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create graphics pipeline!");
-    }
-    
-    vkDestroyShaderModule(m_device.getDevice(), fragShaderModule, nullptr);
-    vkDestroyShaderModule(m_device.getDevice(), vertShaderModule, nullptr);
+    GraphicsPipelineDesc desc;
+    desc.name = "grid pipeline";
+    desc.vertexShader = "shaders/grid_vert.spv";
+    desc.fragmentShader = "shaders/grid_frag.spv";
+    desc.vertexLayout = VertexLayout::None;
+    desc.depthWrite = false;
+    desc.alphaBlend = true;
+    desc.layout = m_gridPipelineLayout;
+    desc.renderPass = m_renderPass;
+    m_pipelineLibrary->request(desc, &m_gridPipeline);
 }
 
 void Renderer::createModelPipeline() {
-
-    auto vertShaderCode = readFile("shaders/model_vert.spv");
-    auto fragShaderCode = readFile("shaders/model_frag.spv");
-    
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
-    
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
-    vertShaderStageInfo.pName = "main";
-    
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName = "main";
-    
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
-    
-
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
-    
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-    
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-    
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.scissorCount = 1;
-    
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_NONE; 
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-    
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    
-    VkPipelineDepthStencilStateCreateInfo depthStencil{};
-    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-    depthStencil.depthBoundsTestEnable = VK_FALSE;
-    depthStencil.stencilTestEnable = VK_FALSE;
-    
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-    
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    colorBlending.blendConstants[0] = 0.0f;
-    colorBlending.blendConstants[1] = 0.0f;
-    colorBlending.blendConstants[2] = 0.0f;
-    colorBlending.blendConstants[3] = 0.0f;
-    
-    std::vector<VkDynamicState> dynamicStates = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR
-    };
-    VkPipelineDynamicStateCreateInfo dynamicState{};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-    dynamicState.pDynamicStates = dynamicStates.data();
-    
-
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(PushConstants);
+    std::array<VkPushConstantRange, 2> pushConstantRanges = getModelPushConstantRanges();
     
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = 1;
     pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
     
     if (vkCreatePipelineLayout(m_device.getDevice(), &pipelineLayoutInfo, nullptr, &m_modelPipelineLayout) != VK_SUCCESS) {
         throw std::runtime_error("failed to create model pipeline layout!");
     }
     
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = &depthStencil;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = &dynamicState;
-    pipelineInfo.layout = m_modelPipelineLayout;
-    pipelineInfo.renderPass = m_renderPass;
-    pipelineInfo.subpass = 0;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-    
-    if (vkCreateGraphicsPipelines(m_device.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_modelPipeline) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create model graphics pipeline!");
+    GraphicsPipelineDesc desc;
+    desc.name = "model graphics pipeline";
+    desc.layout = m_modelPipelineLayout;
+    desc.renderPass = m_renderPass;
+    m_modelPipelines = std::make_unique<ModelPipelineVariants>(m_device, *m_pipelineLibrary, desc);
+    if (!m_modelPipelines->supportsQuantized()) {
+        std::cerr << "shaders/model_quantized_vert.spv not found, vertex quantization disabled" << std::endl;
     }
     
-    vkDestroyShaderModule(m_device.getDevice(), fragShaderModule, nullptr);
-    vkDestroyShaderModule(m_device.getDevice(), vertShaderModule, nullptr);
+    
+    // Every scene needs these at the default light count; other counts are built when first drawn
+    for (bool textured : {false, true}) {
+        for (bool quantized : {false, true}) {
+            m_modelPipelines->request(makeModelVariantKey(textured, quantized, m_lightCount));
+        }
+    }
 }
 
 void Renderer::updateDescriptorSetForMesh(const Model* model, size_t materialIndex) {
@@ -854,73 +868,15 @@ void Renderer::createDefaultTexture() {
     unsigned char pixels[4] = { 255, 255, 255, 255 }; 
     VkDeviceSize imageSize = texWidth * texHeight * texChannels;
     
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    m_device.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, 
-                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                         stagingBuffer, stagingBufferMemory);
-    
-    void* data;
-    vkMapMemory(m_device.getDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(m_device.getDevice(), stagingBufferMemory);
-    
-
     m_device.createImage(texWidth, texHeight, 1, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
                         VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
-                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_defaultTextureImage, m_defaultTextureImageMemory);
-    
-
-    VkCommandBuffer commandBuffer = m_device.beginSingleTimeCommands();
-    
-
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = m_defaultTextureImage;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.srcAccessMask = 0;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    
-    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                        0, 0, nullptr, 0, nullptr, 1, &barrier);
-    
-
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {texWidth, texHeight, 1};
-    
-    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, m_defaultTextureImage, 
-                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-    
-
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    
-    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                        0, 0, nullptr, 0, nullptr, 1, &barrier);
-    
-    m_device.endSingleTimeCommands(commandBuffer);
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_defaultTextureImage, m_defaultTextureImageAllocation,
+                        MemoryCategory::Texture);
     
 
-    vkDestroyBuffer(m_device.getDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(m_device.getDevice(), stagingBufferMemory, nullptr);
+    UploadBatcher batcher(m_device);
+    batcher.enqueueImageCopy(pixels, imageSize, m_defaultTextureImage, texWidth, texHeight);
+    batcher.flush();
     
 
     VkImageViewCreateInfo viewInfo{};
@@ -967,11 +923,17 @@ void Renderer::createDefaultTexture() {
 }
 
 void Renderer::cleanup() {
-
-    if (m_modelPipeline) {
-        vkDestroyPipeline(m_device.getDevice(), m_modelPipeline, nullptr);
-        m_modelPipeline = VK_NULL_HANDLE;
+    
+    if (m_geometryPool) {
+        m_device.setGeometryPool(nullptr);
+        m_geometryPool.reset();
     }
+    if (m_textureCache) {
+        m_device.setTextureCache(nullptr);
+        m_textureCache.reset();
+    }
+
+    m_modelPipelines.reset();
     if (m_modelPipelineLayout) {
         vkDestroyPipelineLayout(m_device.getDevice(), m_modelPipelineLayout, nullptr);
         m_modelPipelineLayout = VK_NULL_HANDLE;
@@ -998,19 +960,19 @@ void Renderer::cleanup() {
 
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
 
-        if (m_modelUniformBuffers.size() > i && m_modelUniformBuffers[i]) {
-            vkDestroyBuffer(m_device.getDevice(), m_modelUniformBuffers[i], nullptr);
-        }
-        if (m_modelUniformBuffersMemory.size() > i && m_modelUniformBuffersMemory[i]) {
-            vkFreeMemory(m_device.getDevice(), m_modelUniformBuffersMemory[i], nullptr);
+        if (m_modelUniformBuffers.size() > i && m_modelUniformBuffersAllocation.size() > i) {
+            if (m_modelUniformBuffersAllocation[i]) {
+                m_device.unmapMemory(m_modelUniformBuffersAllocation[i]);
+            }
+            m_device.destroyBuffer(m_modelUniformBuffers[i], m_modelUniformBuffersAllocation[i]);
         }
         
 
-        if (m_gridUniformBuffers.size() > i && m_gridUniformBuffers[i]) {
-            vkDestroyBuffer(m_device.getDevice(), m_gridUniformBuffers[i], nullptr);
-        }
-        if (m_gridUniformBuffersMemory.size() > i && m_gridUniformBuffersMemory[i]) {
-            vkFreeMemory(m_device.getDevice(), m_gridUniformBuffersMemory[i], nullptr);
+        if (m_gridUniformBuffers.size() > i && m_gridUniformBuffersAllocation.size() > i) {
+            if (m_gridUniformBuffersAllocation[i]) {
+                m_device.unmapMemory(m_gridUniformBuffersAllocation[i]);
+            }
+            m_device.destroyBuffer(m_gridUniformBuffers[i], m_gridUniformBuffersAllocation[i]);
         }
     }
     
@@ -1023,20 +985,18 @@ void Renderer::cleanup() {
         vkDestroyImageView(m_device.getDevice(), m_defaultTextureImageView, nullptr);
         m_defaultTextureImageView = VK_NULL_HANDLE;
     }
-    if (m_defaultTextureImage) {
-        vkDestroyImage(m_device.getDevice(), m_defaultTextureImage, nullptr);
-        m_defaultTextureImage = VK_NULL_HANDLE;
-    }
-    if (m_defaultTextureImageMemory) {
-        vkFreeMemory(m_device.getDevice(), m_defaultTextureImageMemory, nullptr);
-        m_defaultTextureImageMemory = VK_NULL_HANDLE;
-    }
+    m_device.destroyImage(m_defaultTextureImage, m_defaultTextureImageAllocation);
     
     for (auto framebuffer : m_framebuffers) {
         vkDestroyFramebuffer(m_device.getDevice(), framebuffer, nullptr);
     }
     m_framebuffers.clear();
     
+    if (m_timestampPool) {
+        vkDestroyQueryPool(m_device.getDevice(), m_timestampPool, nullptr);
+        m_timestampPool = VK_NULL_HANDLE;
+    }
+    
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         vkDestroySemaphore(m_device.getDevice(), m_renderFinishedSemaphores[i], nullptr);
         vkDestroySemaphore(m_device.getDevice(), m_imageAvailableSemaphores[i], nullptr);
@@ -1047,6 +1007,9 @@ void Renderer::cleanup() {
         vkDestroyRenderPass(m_device.getDevice(), m_renderPass, nullptr);
         m_renderPass = VK_NULL_HANDLE;
     }
+    
+    // Writes whatever the pipeline cache picked up this run back to disk
+    m_pipelineLibrary.reset();
 }
 
 }
\ No newline at end of file
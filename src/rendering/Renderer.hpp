@@ -1,28 +1,85 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+#include <algorithm>
+#include <cstddef>
 #include <vector>
 #include <memory>
 #include <glm/glm.hpp>
 
+#include "MeshletCuller.hpp"
+#include "ModelPipelines.hpp"
+
 namespace VulkanViewer {
 
 class ThumbnailRenderer;
+class GeometryPool;
+class TextureCache;
+class PipelineLibrary;
 
 struct UniformBufferObject {
     alignas(16) glm::mat4 view;
     alignas(16) glm::mat4 proj;
 };
 
+// Vertex stage push constants of the model pipelines
 struct PushConstants {
     alignas(16) glm::mat4 model;
-    alignas(16) glm::vec3 materialDiffuse;
-    alignas(4) float hasTexture; 
+    alignas(16) glm::vec3 quantScale = glm::vec3(1.0f);
+    alignas(16) glm::vec3 quantOffset = glm::vec3(0.0f);
+    // 1 when U and V are swapped before uvTransform; packs into the space after quantOffset
+    float uvSwap = 0.0f;
+    // xy scale, zw offset
+    alignas(16) glm::vec4 uvTransform = glm::vec4(1.0f, 1.0f, 0.0f, 0.0f);
+    
+    void setUVTransform(const UVTransform& transform) {
+        uvTransform = glm::vec4(transform.scale, transform.offset);
+        uvSwap = transform.swap ? 1.0f : 0.0f;
+    }
+};
+
+// Fragment stage push constants, placed after PushConstants; only untextured variants read them
+struct MaterialPushConstants {
+    alignas(16) glm::vec3 diffuse = glm::vec3(0.0f);
+};
+
+// model.vert and model_quantized.vert place uvSwap at 92, model.frag the material at 112
+static_assert(offsetof(PushConstants, uvSwap) == 92 && sizeof(PushConstants) == 112,
+              "PushConstants has to match the push constant block of the model shaders");
+static_assert(sizeof(PushConstants) + sizeof(MaterialPushConstants) <= 128,
+              "model push constants have to fit the 128 bytes every device guarantees");
+
+// What the last renderScene call submitted, against drawing every mesh at full detail
+struct RenderStats {
+    uint64_t submittedTriangles = 0;
+    uint64_t fullDetailTriangles = 0;
+    uint32_t drawCalls = 0;
+    uint64_t meshletsTested = 0;
+    uint64_t meshletsCulled = 0;
+    uint64_t culledTriangles = 0;
+    // Models skipped because their upload has not landed yet
+    uint32_t streamingModels = 0;
+};
+
+// GPU time spent drawing with one model pipeline variant, from the timestamps around its draws
+struct VariantGpuTime {
+    ModelVariantKey key = 0;
+    double milliseconds = 0.0;
+    uint32_t drawCalls = 0;
+};
+
+enum class MeshletCulling {
+    Off,
+    Frustum,
+    // Backface cones assume consistently wound, closed surfaces; the model pipeline draws both sides
+    FrustumAndCone
 };
 
 class VulkanDevice;
 class Scene;
 class SwapChain;
+class Model;
 
 class Renderer {
 public:
@@ -40,6 +97,28 @@ public:
     uint32_t getCurrentImageIndex() const { return m_imageIndex; }
     
     ThumbnailRenderer* getThumbnailRenderer() const { return m_thumbnailRenderer.get(); }
+    GeometryPool& getGeometryPool() const { return *m_geometryPool; }
+    TextureCache& getTextureCache() const { return *m_textureCache; }
+    PipelineLibrary& getPipelineLibrary() const { return *m_pipelineLibrary; }
+    bool supportsQuantizedVertices() const { return m_modelPipelines && m_modelPipelines->supportsQuantized(); }
+    size_t getModelVariantCount() const { return m_modelPipelines ? m_modelPipelines->getVariantCount() : 0; }
+    
+    // Coarsest LOD whose projected error stays below this many pixels is drawn; 0 forces full detail
+    float getLodErrorPixels() const { return m_lodErrorPixels; }
+    void setLodErrorPixels(float pixels) { m_lodErrorPixels = pixels; }
+    const RenderStats& getRenderStats() const { return m_renderStats; }
+    
+    MeshletCulling getMeshletCulling() const { return m_meshletCulling; }
+    void setMeshletCulling(MeshletCulling culling) { m_meshletCulling = culling; }
+    
+    // Picks the model pipeline variant; a count not drawn with before builds its variants on first use
+    uint32_t getLightCount() const { return m_lightCount; }
+    void setLightCount(uint32_t count) { m_lightCount = std::min(count, MAX_MODEL_LIGHTS); }
+    // From the most recent frame whose timestamps have been read back; empty without timestamp support
+    const std::vector<VariantGpuTime>& getVariantGpuTimes() const { return m_variantGpuTimes; }
+    // GPU time from the first model draw to the end of the last, of the same frame; vsync does not affect it
+    bool hasGpuTimestamps() const { return m_timestampPool != VK_NULL_HANDLE; }
+    double getModelGpuMilliseconds() const { return m_modelGpuMilliseconds; }
     
 
     VkImageView getDefaultTextureImageView() const { return m_defaultTextureImageView; }
@@ -54,6 +133,12 @@ private:
     void createSyncObjects();
     void createGridPipeline();
     void createModelPipeline();
+    void createTimestampQueries();
+    // Reads the timestamps the frame in this slot wrote last time round; its fence has to have signalled
+    void readVariantTimestamps(size_t frame);
+    // Starts timing the draws of a variant, which ends whatever was timed before it
+    void writeVariantTimestamp(ModelVariantKey key);
+    void closeVariantTimestamps();
     void createUniformBuffers();
     void updateUniformBuffer(uint32_t currentImage, const Scene& scene);
     void updateUniformBufferForModel(uint32_t currentImage, const Scene& scene, const class Model* model);
@@ -61,12 +146,17 @@ private:
     void updateGridUniformBuffer(uint32_t currentImage, const Scene& scene);
     void createDefaultTexture();
     void updateDescriptorSetForMesh(const class Model* model, size_t materialIndex);
-    std::vector<char> readFile(const std::string& filename);
-    VkShaderModule createShaderModule(const std::vector<char>& code);
+    float projectedErrorScale(const Model& model, const glm::vec3& cameraPosition, float pixelsPerUnit) const;
+    static float maxAxisScale(const glm::mat4& transform);
+    // Cone tests use model-space face normals, which only survive uniform scale without mirroring
+    static bool preservesFaceNormals(const glm::mat4& transform);
     void cleanup();
 
     VulkanDevice& m_device;
     std::unique_ptr<SwapChain> m_swapChain;
+    std::unique_ptr<GeometryPool> m_geometryPool;
+    std::unique_ptr<TextureCache> m_textureCache;
+    std::unique_ptr<PipelineLibrary> m_pipelineLibrary;
 
     VkRenderPass m_renderPass;
     std::vector<VkFramebuffer> m_framebuffers;
@@ -78,36 +168,54 @@ private:
     std::vector<VkFence> m_inFlightFences;
     
 
-    VkPipeline m_gridPipeline;
+    VkPipeline m_gridPipeline = VK_NULL_HANDLE;
     VkPipelineLayout m_gridPipelineLayout;
     VkDescriptorSetLayout m_descriptorSetLayout;
     VkDescriptorPool m_descriptorPool;
     std::vector<VkDescriptorSet> m_gridDescriptorSets;
     
 
-    VkPipeline m_modelPipeline;
+    std::unique_ptr<ModelPipelineVariants> m_modelPipelines;
     VkPipelineLayout m_modelPipelineLayout;
     std::vector<VkDescriptorSet> m_modelDescriptorSets;
     
 
     std::vector<VkBuffer> m_modelUniformBuffers;
-    std::vector<VkDeviceMemory> m_modelUniformBuffersMemory;
+    std::vector<VmaAllocation> m_modelUniformBuffersAllocation;
     std::vector<void*> m_modelUniformBuffersMapped;
     
     std::vector<VkBuffer> m_gridUniformBuffers;
-    std::vector<VkDeviceMemory> m_gridUniformBuffersMemory;
+    std::vector<VmaAllocation> m_gridUniformBuffersAllocation;
     std::vector<void*> m_gridUniformBuffersMapped;
     
 
     VkImage m_defaultTextureImage = VK_NULL_HANDLE;
-    VkDeviceMemory m_defaultTextureImageMemory = VK_NULL_HANDLE;
+    VmaAllocation m_defaultTextureImageAllocation = VK_NULL_HANDLE;
     VkImageView m_defaultTextureImageView = VK_NULL_HANDLE;
     VkSampler m_defaultTextureSampler = VK_NULL_HANDLE;
     
 
     std::unique_ptr<ThumbnailRenderer> m_thumbnailRenderer;
     
+    float m_lodErrorPixels = 1.0f;
+    RenderStats m_renderStats;
+    MeshletCulling m_meshletCulling = MeshletCulling::Frustum;
+    std::vector<IndexRange> m_drawRanges;
+    uint32_t m_lightCount = DEFAULT_MODEL_LIGHTS;
+    
+    // MAX_VARIANT_TIMESTAMPS queries per frame in flight, one per variant switch plus one closing the last
+    static const uint32_t MAX_VARIANT_TIMESTAMPS = 128;
+    VkQueryPool m_timestampPool = VK_NULL_HANDLE;
+    double m_timestampPeriod = 0.0;
+    uint64_t m_timestampMask = 0;
+    // Variant timed from each query of a frame to the next, and the draws recorded in between
+    std::vector<std::vector<VariantGpuTime>> m_timedVariants;
+    std::vector<VariantGpuTime> m_variantGpuTimes;
+    double m_modelGpuMilliseconds = 0.0;
+    
     size_t m_currentFrame = 0;
+    // Highest upload ticket the frame being recorded may draw from
+    uint64_t m_drawableUploads = 0;
     uint32_t m_imageIndex = 0;
 };
 
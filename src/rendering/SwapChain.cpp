@@ -102,7 +102,7 @@ void SwapChain::createDepthResources() {
     
     m_device.createImage(m_swapChainExtent.width, m_swapChainExtent.height, 1, VK_SAMPLE_COUNT_1_BIT, 
                         depthFormat, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 
-                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_depthImage, m_depthImageMemory);
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_depthImage, m_depthImageAllocation, MemoryCategory::Attachment);
     
     m_depthImageView = m_device.createImageView(m_depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
 }
@@ -112,14 +112,7 @@ void SwapChain::cleanup() {
         vkDestroyImageView(m_device.getDevice(), m_depthImageView, nullptr);
         m_depthImageView = VK_NULL_HANDLE;
     }
-    if (m_depthImage) {
-        vkDestroyImage(m_device.getDevice(), m_depthImage, nullptr);
-        m_depthImage = VK_NULL_HANDLE;
-    }
-    if (m_depthImageMemory) {
-        vkFreeMemory(m_device.getDevice(), m_depthImageMemory, nullptr);
-        m_depthImageMemory = VK_NULL_HANDLE;
-    }
+    m_device.destroyImage(m_depthImage, m_depthImageAllocation);
     
     for (auto imageView : m_swapChainImageViews) {
         vkDestroyImageView(m_device.getDevice(), imageView, nullptr);
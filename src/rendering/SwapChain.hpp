@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
 #include <vector>
 
 namespace VulkanViewer {
@@ -40,8 +41,8 @@ private:
     VkFormat m_swapChainImageFormat;
     VkExtent2D m_swapChainExtent;
     
-    VkImage m_depthImage;
-    VkDeviceMemory m_depthImageMemory;
+    VkImage m_depthImage = VK_NULL_HANDLE;
+    VmaAllocation m_depthImageAllocation = VK_NULL_HANDLE;
     VkImageView m_depthImageView;
 };
 
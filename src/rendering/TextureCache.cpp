@@ -0,0 +1,222 @@
+#include "TextureCache.hpp"
+#include "../core/VulkanDevice.hpp"
+#include "../core/UploadBatcher.hpp"
+#include "../assets/MipGenerator.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+namespace VulkanViewer {
+
+namespace {
+constexpr VkFormat TEXTURE_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+}
+
+TextureCache::TextureCache(VulkanDevice& device) : m_device(device) {
+}
+
+TextureCache::~TextureCache() {
+    cleanup();
+}
+
+std::string TextureCache::makeKey(const std::string& path, const TextureLoadOptions& options) {
+    std::error_code error;
+    fs::path canonical = fs::weakly_canonical(fs::path(path), error);
+    if (error) {
+        canonical = fs::absolute(fs::path(path), error).lexically_normal();
+    }
+    std::string key = canonical.generic_string();
+#ifdef _WIN32
+    std::transform(key.begin(), key.end(), key.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+#endif
+    key += options.generateMips ? "|mips" : "|base";
+    return key;
+}
+
+CachedTexture* TextureCache::acquire(const std::string& path, const TextureLoadOptions& options) {
+    m_lookups++;
+    auto it = m_textures.find(makeKey(path, options));
+    if (it == m_textures.end()) {
+        return nullptr;
+    }
+    m_hits++;
+    it->second->refCount++;
+    return it->second.get();
+}
+
+CachedTexture* TextureCache::acquire(CachedTexture* texture) {
+    if (texture) {
+        texture->refCount++;
+    }
+    return texture;
+}
+
+CachedTexture* TextureCache::create(const std::string& path, DecodedTexture& texture, UploadBatcher& batcher,
+                                    const TextureLoadOptions& options) {
+    if (texture.pixels.empty() || texture.width == 0 || texture.height == 0) {
+        return nullptr;
+    }
+    std::string key = makeKey(path, options);
+    auto existing = m_textures.find(key);
+    if (existing != m_textures.end()) {
+        existing->second->refCount++;
+        return existing->second.get();
+    }
+
+    VkDevice device = m_device.getDevice();
+    auto record = std::make_unique<CachedTexture>();
+    record->key = key;
+    record->width = texture.width;
+    record->height = texture.height;
+
+
+    // Full chain down to 1x1: blitted on the GPU when the format allows it, box-filtered here otherwise.
+    // A dedicated transfer queue cannot blit, so the chain is built here and the upload stays on that queue.
+    uint32_t mipLevels = options.generateMips ? MipGenerator::levelCount(texture.width, texture.height) : 1;
+    bool generateOnGPU = texture.mipLevels < mipLevels && m_device.supportsLinearBlit(TEXTURE_FORMAT) &&
+                         !m_device.hasDedicatedTransferQueue();
+    if (texture.mipLevels < mipLevels && !generateOnGPU) {
+        MipGenerator::generate(texture);
+    }
+    record->mipLevels = mipLevels;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent.width = texture.width;
+    imageInfo.extent.height = texture.height;
+    imageInfo.extent.depth = 1;
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = TEXTURE_FORMAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (m_device.createImage(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, MemoryCategory::Texture,
+                             record->image, record->allocation) != VK_SUCCESS) {
+        std::cerr << "Failed to create texture image!" << std::endl;
+        return nullptr;
+    }
+    VmaAllocationInfo allocationInfo{};
+    vmaGetAllocationInfo(m_device.getAllocator(), record->allocation, &allocationInfo);
+    record->bytes = allocationInfo.size;
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = record->image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = TEXTURE_FORMAT;
+    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    viewInfo.subresourceRange.levelCount = mipLevels;
+    viewInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &record->view) != VK_SUCCESS) {
+        std::cerr << "Failed to create texture image view!" << std::endl;
+        destroyTexture(*record);
+        return nullptr;
+    }
+    record->sampler = getSampler();
+
+
+    // Layout transitions, copies and blits are recorded by the batcher; the view does not need the pixels yet
+    batcher.enqueueImageCopy(texture.pixels.data(), texture.pixels.size(), record->image,
+                             texture.width, texture.height, mipLevels, generateOnGPU);
+
+    record->refCount = 1;
+    m_residentBytes += record->bytes;
+    CachedTexture* result = record.get();
+    m_textures.emplace(key, std::move(record));
+    return result;
+}
+
+void TextureCache::release(CachedTexture* texture) {
+    if (!texture || texture->refCount == 0 || --texture->refCount > 0) {
+        return;
+    }
+    auto it = m_textures.find(texture->key);
+    if (it == m_textures.end() || it->second.get() != texture) {
+        return;
+    }
+    m_residentBytes -= texture->bytes;
+    destroyTexture(*texture);
+    m_textures.erase(it);
+}
+
+VkSampler TextureCache::getSampler(const SamplerDesc& desc) {
+    for (const auto& [existing, sampler] : m_samplers) {
+        if (existing == desc) {
+            return sampler;
+        }
+    }
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(m_device.getPhysicalDevice(), &properties);
+    float maxAnisotropy = std::min(desc.maxAnisotropy, properties.limits.maxSamplerAnisotropy);
+
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = desc.filter;
+    samplerInfo.minFilter = desc.filter;
+    samplerInfo.addressModeU = desc.addressMode;
+    samplerInfo.addressModeV = desc.addressMode;
+    samplerInfo.addressModeW = desc.addressMode;
+    samplerInfo.anisotropyEnable = maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+    samplerInfo.maxAnisotropy = std::max(maxAnisotropy, 1.0f);
+    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+    samplerInfo.unnormalizedCoordinates = VK_FALSE;
+    samplerInfo.compareEnable = VK_FALSE;
+    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+    samplerInfo.mipmapMode = desc.mipmapMode;
+    samplerInfo.minLod = 0.0f;
+    // The image view limits the levels, so one sampler serves every chain length
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    VkSampler sampler = VK_NULL_HANDLE;
+    if (vkCreateSampler(m_device.getDevice(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
+        std::cerr << "Failed to create texture sampler!" << std::endl;
+        return VK_NULL_HANDLE;
+    }
+    m_samplers.emplace_back(desc, sampler);
+    return sampler;
+}
+
+TextureCacheStats TextureCache::getStats() const {
+    TextureCacheStats stats;
+    stats.lookups = m_lookups;
+    stats.hits = m_hits;
+    stats.textureCount = static_cast<uint32_t>(m_textures.size());
+    stats.samplerCount = static_cast<uint32_t>(m_samplers.size());
+    stats.residentBytes = m_residentBytes;
+    return stats;
+}
+
+void TextureCache::destroyTexture(CachedTexture& texture) {
+    VkDevice device = m_device.getDevice();
+    if (texture.view != VK_NULL_HANDLE) {
+        vkDestroyImageView(device, texture.view, nullptr);
+        texture.view = VK_NULL_HANDLE;
+    }
+    m_device.discardUploadAcquires(texture.image);
+    m_device.destroyImage(texture.image, texture.allocation);
+}
+
+void TextureCache::cleanup() {
+    for (auto& [key, texture] : m_textures) {
+        destroyTexture(*texture);
+    }
+    m_textures.clear();
+    for (const auto& [desc, sampler] : m_samplers) {
+        vkDestroySampler(m_device.getDevice(), sampler, nullptr);
+    }
+    m_samplers.clear();
+    m_residentBytes = 0;
+}
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace VulkanViewer {
+
+class VulkanDevice;
+class UploadBatcher;
+struct DecodedTexture;
+
+// Settings that change the uploaded image; part of the cache key
+struct TextureLoadOptions {
+    bool generateMips = true;
+};
+
+struct SamplerDesc {
+    VkFilter filter = VK_FILTER_LINEAR;
+    VkSamplerMipmapMode mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    VkSamplerAddressMode addressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    float maxAnisotropy = 16.0f;
+
+    bool operator==(const SamplerDesc& other) const {
+        return filter == other.filter && mipmapMode == other.mipmapMode && addressMode == other.addressMode &&
+               maxAnisotropy == other.maxAnisotropy;
+    }
+};
+
+// One GPU image shared by every material that loads the same file with the same options.
+// Records are owned by the cache and keep their address until the last reference is released.
+struct CachedTexture {
+    VkImage image = VK_NULL_HANDLE;
+    VmaAllocation allocation = VK_NULL_HANDLE;
+    VkImageView view = VK_NULL_HANDLE;
+    VkSampler sampler = VK_NULL_HANDLE;
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 0;
+    VkDeviceSize bytes = 0;
+    // Set by whoever submits the upload batch; models referencing the image wait for it too
+    uint64_t uploadTicket = 0;
+
+    std::string key;
+    uint32_t refCount = 0;
+};
+
+struct TextureCacheStats {
+    uint64_t lookups = 0;
+    uint64_t hits = 0;
+    uint32_t textureCount = 0;
+    uint32_t samplerCount = 0;
+    VkDeviceSize residentBytes = 0;
+
+    float getHitRate() const { return lookups ? static_cast<float>(hits) / lookups : 0.0f; }
+};
+
+// Device-wide texture and sampler cache keyed by canonical path plus load options.
+// Only used from the render thread, like the geometry pool.
+class TextureCache {
+public:
+    explicit TextureCache(VulkanDevice& device);
+    ~TextureCache();
+
+    TextureCache(const TextureCache&) = delete;
+    TextureCache& operator=(const TextureCache&) = delete;
+
+    // Returns the resident texture with one more reference, or nullptr on a miss
+    CachedTexture* acquire(const std::string& path, const TextureLoadOptions& options = TextureLoadOptions());
+
+    // Another reference to a texture the caller already holds
+    CachedTexture* acquire(CachedTexture* texture);
+
+    // Creates the image and queues its upload with one reference held. The texture may be
+    // filled with mips on the CPU; it has to stay alive until the batcher is flushed.
+    CachedTexture* create(const std::string& path, DecodedTexture& texture, UploadBatcher& batcher,
+                          const TextureLoadOptions& options = TextureLoadOptions());
+
+    // Destroys the texture once nothing references it. The GPU must not be using it anymore.
+    void release(CachedTexture* texture);
+
+    // Samplers are never released before cleanup(); there are only a handful of distinct ones
+    VkSampler getSampler(const SamplerDesc& desc = SamplerDesc());
+
+    TextureCacheStats getStats() const;
+
+    void cleanup();
+
+private:
+    static std::string makeKey(const std::string& path, const TextureLoadOptions& options);
+    void destroyTexture(CachedTexture& texture);
+
+    VulkanDevice& m_device;
+    std::unordered_map<std::string, std::unique_ptr<CachedTexture>> m_textures;
+    std::vector<std::pair<SamplerDesc, VkSampler>> m_samplers;
+    VkDeviceSize m_residentBytes = 0;
+    uint64_t m_lookups = 0;
+    uint64_t m_hits = 0;
+};
+
+}
@@ -2,12 +2,12 @@
 #include "../core/VulkanDevice.hpp"
 #include "../scene/Model.hpp"
 #include "Renderer.hpp"
+#include "ModelPipelines.hpp"
 
 #include <imgui_impl_vulkan.h>
 
 #include <stdexcept>
 #include <iostream>
-#include <fstream>
 #include <cfloat>
 #include <algorithm>
 #include <glm/glm.hpp>
@@ -71,12 +71,7 @@ void ThumbnailRenderer::clearThumbnails() {
         if (thumbnail->imageView != VK_NULL_HANDLE) {
             vkDestroyImageView(m_device.getDevice(), thumbnail->imageView, nullptr);
         }
-        if (thumbnail->image != VK_NULL_HANDLE) {
-            vkDestroyImage(m_device.getDevice(), thumbnail->image, nullptr);
-        }
-        if (thumbnail->imageMemory != VK_NULL_HANDLE) {
-            vkFreeMemory(m_device.getDevice(), thumbnail->imageMemory, nullptr);
-        }
+        m_device.destroyImage(thumbnail->image, thumbnail->imageAllocation);
     }
     m_thumbnails.clear();
 }
@@ -107,7 +102,7 @@ void ThumbnailRenderer::createOffscreenResources() {
     m_device.createImage(THUMBNAIL_SIZE, THUMBNAIL_SIZE, 1, msaaSamples, 
                         VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
                         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
-                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_colorImage, m_colorImageMemory);
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_colorImage, m_colorImageAllocation, MemoryCategory::Thumbnail);
     
 
     VkImageViewCreateInfo colorViewInfo{};
@@ -130,7 +125,7 @@ void ThumbnailRenderer::createOffscreenResources() {
     m_device.createImage(THUMBNAIL_SIZE, THUMBNAIL_SIZE, 1, msaaSamples,
                         depthFormat, VK_IMAGE_TILING_OPTIMAL,
                         VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
-                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_depthImage, m_depthImageMemory);
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_depthImage, m_depthImageAllocation, MemoryCategory::Thumbnail);
     
 
     VkImageViewCreateInfo depthViewInfo{};
@@ -225,8 +220,8 @@ void ThumbnailRenderer::createOffscreenResources() {
     VkDeviceSize bufferSize = sizeof(UniformBufferObject);
     m_device.createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                         m_uniformBuffer, m_uniformBufferMemory);
-    vkMapMemory(m_device.getDevice(), m_uniformBufferMemory, 0, bufferSize, 0, &m_uniformBufferMapped);
+                         m_uniformBuffer, m_uniformBufferAllocation, MemoryCategory::Uniform);
+    m_uniformBufferMapped = m_device.mapMemory(m_uniformBufferAllocation);
     
     std::cout << "Thumbnail renderer off-screen resources created successfully!" << std::endl;
 }
@@ -312,161 +307,28 @@ void ThumbnailRenderer::createModelPipeline() {
     vkUpdateDescriptorSets(m_device.getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
     
 
-    auto vertShaderCode = readFile("shaders/model_vert.spv");
-    auto fragShaderCode = readFile("shaders/model_frag.spv");
-    
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
-    
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
-    vertShaderStageInfo.pName = "main";
-    
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName = "main";
-    
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
-
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
-    
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-    
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-    
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.scissorCount = 1;
-    
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_NONE;
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-    
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;      
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT; 
-    
-    VkPipelineDepthStencilStateCreateInfo depthStencil{};
-    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-    depthStencil.depthBoundsTestEnable = VK_FALSE;
-    depthStencil.stencilTestEnable = VK_FALSE;
-    
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-    
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.logicOp = VK_LOGIC_OP_COPY;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    
-    std::vector<VkDynamicState> dynamicStates = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR
-    };
-    VkPipelineDynamicStateCreateInfo dynamicState{};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
-    dynamicState.pDynamicStates = dynamicStates.data();
-
-    VkPushConstantRange pushConstantRange{};
-    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    pushConstantRange.offset = 0;
-    pushConstantRange.size = sizeof(PushConstants);
+    std::array<VkPushConstantRange, 2> pushConstantRanges = getModelPushConstantRanges();
     
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
     pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
     pipelineLayoutInfo.setLayoutCount = 1;
     pipelineLayoutInfo.pSetLayouts = &m_descriptorSetLayout;
-    pipelineLayoutInfo.pushConstantRangeCount = 1;
-    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pushConstantRanges.size());
+    pipelineLayoutInfo.pPushConstantRanges = pushConstantRanges.data();
     
     if (vkCreatePipelineLayout(m_device.getDevice(), &pipelineLayoutInfo, nullptr, &m_modelPipelineLayout) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create thumbnail pipeline layout!");
     }
     
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = &depthStencil;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = &dynamicState;
-    pipelineInfo.layout = m_modelPipelineLayout;
-    pipelineInfo.renderPass = m_offscreenRenderPass;
-    pipelineInfo.subpass = 0;
-    pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
-    
-    if (vkCreateGraphicsPipelines(m_device.getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_modelPipeline) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create thumbnail model pipeline!");
-    }
-    
-    vkDestroyShaderModule(m_device.getDevice(), fragShaderModule, nullptr);
-    vkDestroyShaderModule(m_device.getDevice(), vertShaderModule, nullptr);
-    
-    std::cout << "Thumbnail model pipeline created successfully!" << std::endl;
-}
-
-std::vector<char> ThumbnailRenderer::readFile(const std::string& filename) {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
-    
-    if (!file.is_open()) {
-        throw std::runtime_error("failed to open file: " + filename);
-    }
-    
-    size_t fileSize = (size_t) file.tellg();
-    std::vector<char> buffer(fileSize);
-    
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
-    file.close();
-    
-    return buffer;
-}
-
-VkShaderModule ThumbnailRenderer::createShaderModule(const std::vector<char>& code) {
-    VkShaderModuleCreateInfo createInfo{};
-    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-    createInfo.codeSize = code.size();
-    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
-    
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(m_device.getDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
-        throw std::runtime_error("failed to create shader module!");
-    }
-    
-    return shaderModule;
+    // Built together with the main renderer's pipelines, from the same shader modules. Thumbnails are
+    // flat silhouettes, so only the untextured variants are used.
+    GraphicsPipelineDesc desc;
+    desc.name = "thumbnail model pipeline";
+    desc.layout = m_modelPipelineLayout;
+    desc.renderPass = m_offscreenRenderPass;
+    m_modelPipelines = std::make_unique<ModelPipelineVariants>(m_device, m_mainRenderer.getPipelineLibrary(), desc);
+    m_modelPipelines->request(makeModelVariantKey(false, false, DEFAULT_MODEL_LIGHTS));
+    m_modelPipelines->request(makeModelVariantKey(false, true, DEFAULT_MODEL_LIGHTS));
 }
 
 void ThumbnailRenderer::updateDescriptorSetWithDefaultTexture() {
@@ -501,10 +363,7 @@ void ThumbnailRenderer::updateDescriptorSetWithDefaultTexture() {
 
 void ThumbnailRenderer::cleanupOffscreenResources() {
 
-    if (m_modelPipeline != VK_NULL_HANDLE) {
-        vkDestroyPipeline(m_device.getDevice(), m_modelPipeline, nullptr);
-        m_modelPipeline = VK_NULL_HANDLE;
-    }
+    m_modelPipelines.reset();
     if (m_modelPipelineLayout != VK_NULL_HANDLE) {
         vkDestroyPipelineLayout(m_device.getDevice(), m_modelPipelineLayout, nullptr);
         m_modelPipelineLayout = VK_NULL_HANDLE;
@@ -519,17 +378,10 @@ void ThumbnailRenderer::cleanupOffscreenResources() {
     }
     
     if (m_uniformBufferMapped) {
-        vkUnmapMemory(m_device.getDevice(), m_uniformBufferMemory);
+        m_device.unmapMemory(m_uniformBufferAllocation);
         m_uniformBufferMapped = nullptr;
     }
-    if (m_uniformBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(m_device.getDevice(), m_uniformBuffer, nullptr);
-        m_uniformBuffer = VK_NULL_HANDLE;
-    }
-    if (m_uniformBufferMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(m_device.getDevice(), m_uniformBufferMemory, nullptr);
-        m_uniformBufferMemory = VK_NULL_HANDLE;
-    }
+    m_device.destroyBuffer(m_uniformBuffer, m_uniformBufferAllocation);
     
     if (m_offscreenFramebuffer != VK_NULL_HANDLE) {
         vkDestroyFramebuffer(m_device.getDevice(), m_offscreenFramebuffer, nullptr);
@@ -544,27 +396,13 @@ void ThumbnailRenderer::cleanupOffscreenResources() {
         vkDestroyImageView(m_device.getDevice(), m_depthImageView, nullptr);
         m_depthImageView = VK_NULL_HANDLE;
     }
-    if (m_depthImage != VK_NULL_HANDLE) {
-        vkDestroyImage(m_device.getDevice(), m_depthImage, nullptr);
-        m_depthImage = VK_NULL_HANDLE;
-    }
-    if (m_depthImageMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(m_device.getDevice(), m_depthImageMemory, nullptr);
-        m_depthImageMemory = VK_NULL_HANDLE;
-    }
+    m_device.destroyImage(m_depthImage, m_depthImageAllocation);
     
     if (m_colorImageView != VK_NULL_HANDLE) {
         vkDestroyImageView(m_device.getDevice(), m_colorImageView, nullptr);
         m_colorImageView = VK_NULL_HANDLE;
     }
-    if (m_colorImage != VK_NULL_HANDLE) {
-        vkDestroyImage(m_device.getDevice(), m_colorImage, nullptr);
-        m_colorImage = VK_NULL_HANDLE;
-    }
-    if (m_colorImageMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(m_device.getDevice(), m_colorImageMemory, nullptr);
-        m_colorImageMemory = VK_NULL_HANDLE;
-    }
+    m_device.destroyImage(m_colorImage, m_colorImageAllocation);
     
     if (m_commandPool != VK_NULL_HANDLE) {
         vkDestroyCommandPool(m_device.getDevice(), m_commandPool, nullptr);
@@ -584,25 +422,16 @@ void ThumbnailRenderer::renderModelToTexture(const Model* model, VkImage targetI
         throw std::runtime_error("Failed to begin recording thumbnail command buffer!");
     }
     
-
-    UniformBufferObject ubo{};
+    // Thumbnails are made as soon as an import finishes, which can be before its upload has landed
+    m_device.waitForUpload(model->getUploadTicket());
+    m_device.recordUploadAcquires(m_commandBuffer, model->getUploadTicket());
     
 
-    const auto& meshes = model->getMeshes();
-    glm::vec3 minBounds(FLT_MAX);
-    glm::vec3 maxBounds(-FLT_MAX);
+    UniformBufferObject ubo{};
     
 
-    for (const auto& mesh : meshes) {
-        for (const auto& vertex : mesh.vertices) {
-            minBounds.x = std::min(minBounds.x, vertex.pos.x);
-            minBounds.y = std::min(minBounds.y, vertex.pos.y);
-            minBounds.z = std::min(minBounds.z, vertex.pos.z);
-            maxBounds.x = std::max(maxBounds.x, vertex.pos.x);
-            maxBounds.y = std::max(maxBounds.y, vertex.pos.y);
-            maxBounds.z = std::max(maxBounds.z, vertex.pos.z);
-        }
-    }
+    glm::vec3 minBounds = model->getBoundsMin();
+    glm::vec3 maxBounds = model->getBoundsMax();
     
 
     glm::vec3 modelCenter = (minBounds + maxBounds) * 0.5f;
@@ -653,32 +482,38 @@ void ThumbnailRenderer::renderModelToTexture(const Model* model, VkImage targetI
     vkCmdSetScissor(m_commandBuffer, 0, 1, &scissor);
     
 
-    vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_modelPipeline);
+    VkPipeline fullPipeline = m_modelPipelines->get(makeModelVariantKey(false, false, DEFAULT_MODEL_LIGHTS));
+    VkPipeline quantizedPipeline = m_modelPipelines->get(makeModelVariantKey(false, true, DEFAULT_MODEL_LIGHTS));
+    vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, fullPipeline);
     
 
     PushConstants pushConstants{};
+    MaterialPushConstants materialConstants{};
 
-    pushConstants.model = glm::translate(glm::mat4(1.0f), -modelCenter);
-    vkCmdPushConstants(m_commandBuffer, m_modelPipelineLayout, 
-                      VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants), &pushConstants);
+    const glm::mat4 centerModel = glm::translate(glm::mat4(1.0f), -modelCenter);
+    pushConstants.model = centerModel;
+    vkCmdPushConstants(m_commandBuffer, m_modelPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pushConstants);
+    vkCmdPushConstants(m_commandBuffer, m_modelPipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                      sizeof(PushConstants), sizeof(MaterialPushConstants), &materialConstants);
     
 
     vkCmdBindDescriptorSets(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, 
                            m_modelPipelineLayout, 0, 1, &m_descriptorSet, 0, nullptr);
     
 
-    for (size_t i = 0; i < meshes.size(); i++) {
-        const Mesh& mesh = meshes[i];
-        
-
-        VkBuffer vertexBuffers[] = {mesh.vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(m_commandBuffer, 0, 1, vertexBuffers, offsets);
-        vkCmdBindIndexBuffer(m_commandBuffer, mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
-        
-
-        vkCmdDrawIndexed(m_commandBuffer, static_cast<uint32_t>(mesh.indices.size()), 1, 0, 0, 0);
-    }
+    bool boundQuantized = false;
+    model->render(m_commandBuffer, m_mainRenderer.getGeometryPool(), [&](const Mesh& mesh, const glm::mat4& instanceTransform) {
+        bool quantized = mesh.quantized && quantizedPipeline != VK_NULL_HANDLE;
+        if (quantized != boundQuantized) {
+            boundQuantized = quantized;
+            vkCmdBindPipeline(m_commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, quantized ? quantizedPipeline : fullPipeline);
+        }
+        pushConstants.model = centerModel * instanceTransform;
+        pushConstants.quantScale = mesh.quantScale;
+        pushConstants.quantOffset = mesh.quantOffset;
+        pushConstants.setUVTransform(model->getMaterialUVTransform(mesh.materialIndex));
+        vkCmdPushConstants(m_commandBuffer, m_modelPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(PushConstants), &pushConstants);
+    });
     
     vkCmdEndRenderPass(m_commandBuffer);
     
@@ -764,7 +599,7 @@ void ThumbnailRenderer::createThumbnailTexture(const std::string& modelName) {
     m_device.createImage(THUMBNAIL_SIZE, THUMBNAIL_SIZE, 1, VK_SAMPLE_COUNT_1_BIT,
                         VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_TILING_OPTIMAL,
                         VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
-                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, thumbnail->image, thumbnail->imageMemory);
+                        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, thumbnail->image, thumbnail->imageAllocation, MemoryCategory::Thumbnail);
     
 
     VkImageViewCreateInfo viewInfo{};
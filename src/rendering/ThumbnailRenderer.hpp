@@ -1,6 +1,7 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
 #include <memory>
 #include <unordered_map>
 #include <string>
@@ -10,10 +11,11 @@ namespace VulkanViewer {
 
 class VulkanDevice;
 class Model;
+class ModelPipelineVariants;
 
 struct ThumbnailData {
     VkImage image = VK_NULL_HANDLE;
-    VkDeviceMemory imageMemory = VK_NULL_HANDLE;
+    VmaAllocation imageAllocation = VK_NULL_HANDLE;
     VkImageView imageView = VK_NULL_HANDLE;
     VkSampler sampler = VK_NULL_HANDLE;
     VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
@@ -48,8 +50,6 @@ private:
     void createModelPipeline();
     void renderModelToTexture(const Model* model, VkImage targetImage);
     void createThumbnailTexture(const std::string& modelName);
-    std::vector<char> readFile(const std::string& filename);
-    VkShaderModule createShaderModule(const std::vector<char>& code);
     
     VulkanDevice& m_device;
     class Renderer& m_mainRenderer;
@@ -60,12 +60,12 @@ private:
     
 
     VkImage m_colorImage = VK_NULL_HANDLE;
-    VkDeviceMemory m_colorImageMemory = VK_NULL_HANDLE;
+    VmaAllocation m_colorImageAllocation = VK_NULL_HANDLE;
     VkImageView m_colorImageView = VK_NULL_HANDLE;
     
 
     VkImage m_depthImage = VK_NULL_HANDLE;
-    VkDeviceMemory m_depthImageMemory = VK_NULL_HANDLE;
+    VmaAllocation m_depthImageAllocation = VK_NULL_HANDLE;
     VkImageView m_depthImageView = VK_NULL_HANDLE;
     
 
@@ -73,7 +73,7 @@ private:
     VkCommandBuffer m_commandBuffer = VK_NULL_HANDLE;
     
 
-    VkPipeline m_modelPipeline = VK_NULL_HANDLE;
+    std::unique_ptr<ModelPipelineVariants> m_modelPipelines;
     VkPipelineLayout m_modelPipelineLayout = VK_NULL_HANDLE;
     VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
     VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
@@ -81,7 +81,7 @@ private:
     
 
     VkBuffer m_uniformBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_uniformBufferMemory = VK_NULL_HANDLE;
+    VmaAllocation m_uniformBufferAllocation = VK_NULL_HANDLE;
     void* m_uniformBufferMapped = nullptr;
     
 
@@ -1,18 +1,140 @@
 #include "Model.hpp"
 #include "../core/VulkanDevice.hpp"
-
+#include "../core/ThreadPool.hpp"
+#include "../rendering/GeometryPool.hpp"
+#include "../rendering/TextureCache.hpp"
+#include "../assets/MeshCache.hpp"
+#include "../assets/ObjParser.hpp"
+#include "../assets/VertexWelder.hpp"
+#include "../assets/MeshOptimizer.hpp"
+#include "../assets/MeshSimplifier.hpp"
+#include "../assets/MeshletBuilder.hpp"
+#include "../assets/MipGenerator.hpp"
+#include "../assets/TexturePathResolver.hpp"
+#include "../assets/UVAnalyzer.hpp"
+
+#include <assimp/ProgressHandler.hpp>
+
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <unordered_map>
+#include <unordered_set>
 #include <stdexcept>
+#include <chrono>
+#include <cfloat>
+#include <cstring>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/packing.hpp>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "../../external/stb/stb_image.h"
 
 namespace VulkanViewer {
 
+namespace {
+
+// Bump whenever the import pipeline changes what ends up in Mesh/Material
+constexpr uint64_t IMPORT_PIPELINE_VERSION = 7;
+
+// Meshes below this size are cheap enough to always draw at full detail
+constexpr size_t MIN_LOD_TRIANGLES = 64;
+
+uint64_t mixHash(uint64_t hash, uint64_t value) {
+    hash ^= value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+// Octahedral mapping of a unit vector onto [-1, 1]^2
+glm::vec2 encodeOctahedral(const glm::vec3& normal) {
+    float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    if (l1 <= 0.0f) {
+        return glm::vec2(0.0f);
+    }
+    glm::vec3 n = normal / l1;
+    if (n.z < 0.0f) {
+        float x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+        float y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+        return glm::vec2(x, y);
+    }
+    return glm::vec2(n.x, n.y);
+}
+
+// Share of the progress bar taken by reading the source file
+constexpr float READ_PROGRESS = 0.4f;
+
+// Forwards Assimp's read progress and stops the read when the import is cancelled.
+// The importer deletes its handler, so this only points at the caller's progress.
+class AssimpProgressHandler : public Assimp::ProgressHandler {
+public:
+    explicit AssimpProgressHandler(ImportProgress* progress) : m_progress(progress) {}
+    
+    bool Update(float percentage = -1.0f) override {
+        if (percentage >= 0.0f) {
+            m_progress->fraction = READ_PROGRESS * std::min(percentage, 1.0f);
+        }
+        return !m_progress->cancel;
+    }
+    
+private:
+    ImportProgress* m_progress;
+};
+
+// aiMatrix4x4 is row-major, glm takes columns
+glm::mat4 toGlm(const aiMatrix4x4& m) {
+    return glm::mat4(m.a1, m.b1, m.c1, m.d1,
+                     m.a2, m.b2, m.c2, m.d2,
+                     m.a3, m.b3, m.c3, m.d3,
+                     m.a4, m.b4, m.c4, m.d4);
+}
+
+QuantizedVertex quantizeVertex(const Vertex& vertex, const glm::vec3& offset, const glm::vec3& inverseScale) {
+    QuantizedVertex quantized{};
+    glm::vec3 unit = glm::clamp((vertex.pos - offset) * inverseScale, glm::vec3(0.0f), glm::vec3(1.0f));
+    quantized.pos[0] = glm::packUnorm1x16(unit.x);
+    quantized.pos[1] = glm::packUnorm1x16(unit.y);
+    quantized.pos[2] = glm::packUnorm1x16(unit.z);
+    quantized.pos[3] = 0;
+    
+    glm::vec2 octahedral = encodeOctahedral(vertex.normal);
+    quantized.normal[0] = static_cast<int16_t>(glm::packSnorm1x16(octahedral.x));
+    quantized.normal[1] = static_cast<int16_t>(glm::packSnorm1x16(octahedral.y));
+    
+    quantized.texCoord[0] = glm::packHalf1x16(vertex.texCoord.x);
+    quantized.texCoord[1] = glm::packHalf1x16(vertex.texCoord.y);
+    return quantized;
+}
+
+// Texture bytes per upload batch. Batches stream through the staging ring in parts, so this only
+// bounds how many images wait on one ticket.
+constexpr VkDeviceSize MAX_TEXTURE_BATCH_BYTES = 256ull * 1024 * 1024;
+
+}
+
+// Diffuse textures decoding on the pool while the importing thread processes the meshes.
+// Workers only write their own slot of `textures`, the paths are copied up front.
+struct TextureDecode {
+    std::vector<std::string> paths;
+    std::vector<DecodedTexture> textures;
+    std::chrono::high_resolution_clock::time_point start;
+    std::atomic<int64_t> finishedNs{0};
+    ThreadPool::Batch batch;
+};
+
+uint64_t ImportOptions::hash() const {
+    uint64_t value = mixHash(0, IMPORT_PIPELINE_VERSION);
+    value = mixHash(value, weldVertices ? 1 : 0);
+    
+    uint32_t epsilonBits;
+    std::memcpy(&epsilonBits, &weldEpsilon, sizeof(epsilonBits));
+    value = mixHash(value, weldVertices ? epsilonBits : 0);
+    value = mixHash(value, optimizeMeshes ? 1 : 0);
+    value = mixHash(value, buildMeshlets ? 1 : 0);
+    value = mixHash(value, generateLods ? 1 : 0);
+    return value;
+}
+
 VkVertexInputBindingDescription Vertex::getBindingDescription() {
     VkVertexInputBindingDescription bindingDescription{};
     bindingDescription.binding = 0;
@@ -45,23 +167,76 @@ std::array<VkVertexInputAttributeDescription, 3> Vertex::getAttributeDescription
     return attributeDescriptions;
 }
 
+static_assert(sizeof(QuantizedVertex) == 16, "QuantizedVertex must stay 16 bytes");
+
+VkVertexInputBindingDescription QuantizedVertex::getBindingDescription() {
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding = 0;
+    bindingDescription.stride = sizeof(QuantizedVertex);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    return bindingDescription;
+}
+
+std::array<VkVertexInputAttributeDescription, 3> QuantizedVertex::getAttributeDescriptions() {
+    std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+
+    attributeDescriptions[0].binding = 0;
+    attributeDescriptions[0].location = 0;
+    attributeDescriptions[0].format = VK_FORMAT_R16G16B16A16_UNORM;
+    attributeDescriptions[0].offset = offsetof(QuantizedVertex, pos);
+
+    attributeDescriptions[1].binding = 0;
+    attributeDescriptions[1].location = 1;
+    attributeDescriptions[1].format = VK_FORMAT_R16G16_SNORM;
+    attributeDescriptions[1].offset = offsetof(QuantizedVertex, normal);
+
+    attributeDescriptions[2].binding = 0;
+    attributeDescriptions[2].location = 2;
+    attributeDescriptions[2].format = VK_FORMAT_R16G16_SFLOAT;
+    attributeDescriptions[2].offset = offsetof(QuantizedVertex, texCoord);
+
+    return attributeDescriptions;
+}
+
 void Mesh::cleanup(VulkanDevice& device) {
-    if (vertexBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(device.getDevice(), vertexBuffer, nullptr);
-        vertexBuffer = VK_NULL_HANDLE;
+    if (geometry && device.getGeometryPool()) {
+        device.getGeometryPool()->free(geometry);
     }
-    if (vertexBufferMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(device.getDevice(), vertexBufferMemory, nullptr);
-        vertexBufferMemory = VK_NULL_HANDLE;
+    geometry = nullptr;
+}
+
+void Mesh::markDirty(uint32_t begin, uint32_t end) {
+    if (begin >= end) {
+        return;
     }
-    if (indexBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(device.getDevice(), indexBuffer, nullptr);
-        indexBuffer = VK_NULL_HANDLE;
+    if (dirtyBegin >= dirtyEnd) {
+        dirtyBegin = begin;
+        dirtyEnd = end;
+    } else {
+        dirtyBegin = std::min(dirtyBegin, begin);
+        dirtyEnd = std::max(dirtyEnd, end);
     }
-    if (indexBufferMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(device.getDevice(), indexBufferMemory, nullptr);
-        indexBufferMemory = VK_NULL_HANDLE;
+}
+
+MeshAsset::~MeshAsset() {
+    if (device) {
+        for (auto& mesh : meshes) {
+            mesh.cleanup(*device);
+        }
+    }
+}
+
+std::shared_ptr<MeshAsset> MeshAsset::clone() const {
+    auto copy = std::make_shared<MeshAsset>();
+    copy->meshes = meshes;
+    for (auto& mesh : copy->meshes) {
+        mesh.geometry = nullptr;
     }
+    copy->instances = instances;
+    copy->boundsMin = boundsMin;
+    copy->boundsMax = boundsMax;
+    copy->vertexCacheReport = vertexCacheReport;
+    return copy;
 }
 
 Model::Model() : m_name("Untitled"), m_transform(1.0f) {
@@ -70,9 +245,17 @@ Model::Model() : m_name("Untitled"), m_transform(1.0f) {
 Model::~Model() {
 }
 
-bool Model::loadFromFile(const std::string& filepath, VulkanDevice& device) {
+bool Model::loadFromFile(const std::string& filepath, VulkanDevice& device, const ImportOptions& options) {
+    // Same as ImportJobQueue: with a dedicated transfer queue the mips are built by the decode threads
+    ImportOptions importOptions = options;
+    importOptions.mipmapsOnCPU = options.mipmapsOnCPU || device.hasDedicatedTransferQueue();
+    return importFromFile(filepath, importOptions) && uploadPending(device);
+}
+
+bool Model::importFromFile(const std::string& filepath, const ImportOptions& options, ImportProgress* progress) {
 
     m_filepath = filepath;
+    m_importOptions = options;
     
     std::string extension = filepath.substr(filepath.find_last_of('.'));
     std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
@@ -84,113 +267,550 @@ bool Model::loadFromFile(const std::string& filepath, VulkanDevice& device) {
     
 
     m_directory = filepath.substr(0, lastSlash + 1);
+    m_textureIndex.reset();
+    m_progress = progress;
+    m_uploadStats = UploadStats{};
+    
     
+    bool loaded = !isCancelled() && options.useMeshCache && loadFromCache(filepath);
+    if (!loaded && !isCancelled()) {
+        if (extension == ".obj") {
 
-    if (extension == ".obj") {
+            loaded = loadOBJ(filepath) || (!isCancelled() && loadWithAssimp(filepath));
+        } else {
 
-        if (loadWithAssimp(filepath, device)) {
-            return true;
+            loaded = loadWithAssimp(filepath);
         }
-        return loadOBJ(filepath, device);
-    } else {
-
-        return loadWithAssimp(filepath, device);
+        
+        if (loaded) {
+            computeBounds();
+            if (options.useMeshCache && reportProgress("Writing mesh cache", 1.0f)) {
+                MeshCache::get().store(filepath, options.hash(), m_asset->meshes, m_materials, m_asset->instances, m_asset->boundsMin, m_asset->boundsMax);
+            }
+        }
+    }
+    
+    if (m_importTimings.texturePathLookups > 0) {
+        std::cout << "Resolved " << m_importTimings.texturePathLookups << " texture paths from the directory index, "
+                  << m_importTimings.texturePathProbesAvoided << " filesystem probes avoided" << std::endl;
     }
+    m_textureIndex.reset();
+    
+    loaded = loaded && !isCancelled();
+    m_progress = nullptr;
+    m_uploadPending = loaded;
+    m_uploadedMeshes = 0;
+    m_uploadedTextures = 0;
+    return loaded;
 }
 
-bool Model::copyFrom(const Model& other, VulkanDevice& device) {
+bool Model::uploadPending(VulkanDevice& device, VkDeviceSize byteBudget) {
+    if (!m_uploadPending) {
+        return true;
+    }
+    auto startTime = std::chrono::high_resolution_clock::now();
+    VkDeviceSize uploadedBytes = 0;
+    
+    
+    // Whole meshes go first, so a mesh larger than the budget still goes out in one call
+    if (m_uploadedMeshes < m_asset->meshes.size()) {
+        UploadBatcher batcher(device);
+        while (m_uploadedMeshes < m_asset->meshes.size() && uploadedBytes < byteBudget) {
+            Mesh& mesh = m_asset->meshes[m_uploadedMeshes];
+            const CachedMesh* source = m_cacheSource ? &m_cacheSource->meshes[m_uploadedMeshes] : nullptr;
+            createMeshBuffers(mesh, device, batcher, source ? source->vertices : nullptr, source ? source->indices : nullptr);
+            if (mesh.geometry) {
+                uploadedBytes += mesh.geometry->vertexBytes + mesh.geometry->indexBytes;
+            }
+            m_uploadedMeshes++;
+        }
+        UploadStats stats;
+        m_uploadTicket = std::max(m_uploadTicket, batcher.submit(stats));
+        m_uploadStats.bytes += stats.bytes;
+        m_uploadStats.copies += stats.copies;
+        m_uploadStats.milliseconds += stats.milliseconds;
+        if (m_uploadedMeshes == m_asset->meshes.size()) {
+            m_cacheSource.reset();
+        }
+    }
+    auto geometryEnd = std::chrono::high_resolution_clock::now();
+    m_importTimings.uploadMs += std::chrono::duration<double, std::milli>(geometryEnd - startTime).count();
+    
+    
+    // Textures share staging ring parts and command buffers per batch instead of a submit each.
+    // Images already in the texture cache, from another model or an earlier material, are only referenced.
+    TextureCache* textureCache = device.getTextureCache();
+    std::vector<CachedTexture*> created;
+    while (m_uploadedMeshes == m_asset->meshes.size() && m_uploadedTextures < m_decodedTextures.size() &&
+           uploadedBytes < byteBudget) {
+        UploadBatcher batcher(device);
+        VkDeviceSize batchBytes = 0;
+        created.clear();
+        while (m_uploadedTextures < m_decodedTextures.size() && uploadedBytes < byteBudget &&
+               (batchBytes == 0 || batchBytes + m_decodedTextures[m_uploadedTextures].pixels.size() <= MAX_TEXTURE_BATCH_BYTES)) {
+            Material& material = m_materials[m_uploadedTextures];
+            DecodedTexture& texture = m_decodedTextures[m_uploadedTextures];
+            CachedTexture* resident = nullptr;
+            if (!material.diffuseTexture.empty() && textureCache) {
+                resident = textureCache->acquire(material.diffuseTexture);
+            }
+            if (resident) {
+                releaseTexture(material, device);
+                material.texture = resident;
+                // It may still be in flight for the model that created it
+                m_uploadTicket = std::max(m_uploadTicket, resident->uploadTicket);
+            } else if (!texture.pixels.empty()) {
+                if (!createTextureImage(material, material.diffuseTexture, texture, device, batcher)) {
+                    std::cerr << "ERROR: Failed to upload texture for material " << m_uploadedTextures << std::endl;
+                } else {
+                    created.push_back(material.texture);
+                }
+                batchBytes += texture.pixels.size();
+                uploadedBytes += texture.pixels.size();
+            }
+            m_uploadedTextures++;
+        }
+        
+        // The decoded pixels were copied to staging, so they can go before the copies land
+        UploadStats stats;
+        UploadTicket ticket = batcher.submit(stats);
+        for (CachedTexture* texture : created) {
+            texture->uploadTicket = ticket;
+        }
+        m_uploadTicket = std::max(m_uploadTicket, ticket);
+    }
+    auto endTime = std::chrono::high_resolution_clock::now();
+    double textureUploadMs = std::chrono::duration<double, std::milli>(endTime - geometryEnd).count();
+    m_importTimings.textureUploadMs += textureUploadMs;
+    m_importTimings.texturesMs += textureUploadMs;
+    m_importTimings.totalMs += std::chrono::duration<double, std::milli>(endTime - startTime).count();
+    
+    if (m_uploadedMeshes < m_asset->meshes.size() || m_uploadedTextures < m_decodedTextures.size()) {
+        return false;
+    }
+    
+    std::unordered_set<const CachedTexture*> textures;
+    VkDeviceSize textureMemory = 0;
+    for (const auto& material : m_materials) {
+        if (material.texture && textures.insert(material.texture).second) {
+            textureMemory += material.texture->bytes;
+        }
+    }
+    size_t textureCount = textures.size();
+    std::vector<DecodedTexture>().swap(m_decodedTextures);
+    m_uploadPending = false;
+    
+    std::cout << "Uploaded " << (m_uploadStats.bytes / (1024.0 * 1024.0)) << " MB of geometry in "
+              << m_uploadStats.copies << " copies and " << textureCount << " textures ("
+              << (m_importTimings.textureBytes / (1024.0 * 1024.0)) << " MB in "
+              << m_importTimings.textureUploadMs << " ms, " << (textureMemory / (1024.0 * 1024.0))
+              << " MB resident with mips); texture stage " << m_importTimings.texturesMs
+              << " ms, " << m_name << " total " << m_importTimings.totalMs << " ms" << std::endl;
+    return true;
+}
 
+bool Model::loadFromMeshes(const std::string& name, std::vector<Mesh> meshes, VulkanDevice& device,
+                           const ImportOptions& options) {
     cleanup(device);
+    m_name = name;
+    m_filepath.clear();
+    m_directory.clear();
+    m_importOptions = options;
+    m_importTimings = ImportTimings{};
+    auto startTime = std::chrono::high_resolution_clock::now();
+    
+    Material material;
+    material.name = "default";
+    material.diffuse = glm::vec3(0.7f, 0.7f, 0.7f);
+    m_materials.push_back(material);
+    
+    m_asset->meshes = std::move(meshes);
+    for (auto& mesh : m_asset->meshes) {
+        mesh.materialIndex = 0;
+        mesh.materialName = material.name;
+    }
+    instanceEachMeshOnce();
+    processImportedMeshes();
     
+    auto uploadStart = std::chrono::high_resolution_clock::now();
+    createBuffers(device);
+    m_importTimings.uploadMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - uploadStart).count();
+    
+    computeBounds();
+    m_transform = glm::mat4(1.0f);
+    m_importTimings.totalMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    return !m_asset->meshes.empty();
+}
 
-    m_name = other.m_name + "_copy";
-    m_directory = other.m_directory;
-    m_filepath = other.m_filepath;
-    m_transform = other.m_transform;
-    m_forceUVFlip = other.m_forceUVFlip;
+bool Model::loadFromCache(const std::string& filepath) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    m_importTimings = ImportTimings{};
+    reportProgress("Reading mesh cache", 0.0f);
+    
+    auto cached = std::make_unique<CachedModel>();
+    if (!MeshCache::get().load(filepath, m_importOptions.hash(), *cached)) {
+        return false;
+    }
     
+    m_materials = std::move(cached->materials);
+    startTextureDecode();
+    m_asset->instances = std::move(cached->instances);
+    m_asset->meshes.resize(cached->meshes.size());
+    
+    
+    // The mapping stays open until the upload, which reads geometry straight from it;
+    // the CPU copies back the UV tools and thumbnails
+    for (size_t i = 0; i < cached->meshes.size(); i++) {
+        const CachedMesh& source = cached->meshes[i];
+        Mesh& mesh = m_asset->meshes[i];
+        mesh.vertices.assign(source.vertices, source.vertices + source.vertexCount);
+        mesh.indices.assign(source.indices, source.indices + source.indexCount);
+        mesh.lodIndices.assign(source.lodIndices, source.lodIndices + source.lodIndexCount);
+        mesh.lods.assign(source.lods, source.lods + source.lodCount);
+        mesh.meshlets.assign(source.meshlets, source.meshlets + source.meshletCount);
+        mesh.materialIndex = source.materialIndex < m_materials.size() ? source.materialIndex : 0;
+        mesh.sourceVertexCount = static_cast<size_t>(source.sourceVertexCount);
+        mesh.materialName = m_materials.empty() ? std::string() : m_materials[mesh.materialIndex].name;
+    }
+    m_asset->boundsMin = cached->boundsMin;
+    m_asset->boundsMax = cached->boundsMax;
+    m_cacheSource = std::move(cached);
+    
+    
+    // Cached geometry already went through the UV fix-up, only the images need decoding
+    finishTextureDecode(false);
+    m_transform = glm::mat4(1.0f);
+    
+    m_importTimings.totalMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+    std::cout << "Loaded " << m_name << " from mesh cache in " << m_importTimings.totalMs << " ms ("
+              << m_asset->meshes.size() << " meshes)" << std::endl;
+    return true;
+}
 
-    m_materials.reserve(other.m_materials.size());
-    for (const auto& otherMaterial : other.m_materials) {
-        Material material = otherMaterial;
-        
+bool Model::processImportedMeshes() {
+    if (!reportProgress("Welding vertices", 0.55f)) {
+        return false;
+    }
+    weldMeshes();
+    if (!reportProgress("Optimizing meshes", 0.6f)) {
+        return false;
+    }
+    optimizeMeshes();
+    if (!reportProgress("Building meshlets", 0.7f)) {
+        return false;
+    }
+    buildMeshlets();
+    if (!reportProgress("Generating LODs", 0.8f)) {
+        return false;
+    }
+    generateLods();
+    return true;
+}
 
-        material.textureImage = VK_NULL_HANDLE;
-        material.textureImageMemory = VK_NULL_HANDLE;
-        material.textureImageView = VK_NULL_HANDLE;
-        material.textureSampler = VK_NULL_HANDLE;
-        
+bool Model::reportProgress(const char* stage, float fraction) {
+    if (!m_progress) {
+        return true;
+    }
+    m_progress->stage = stage;
+    m_progress->fraction = fraction;
+    return !m_progress->cancel;
+}
 
-        if (otherMaterial.textureImage != VK_NULL_HANDLE && !material.diffuseTexture.empty()) {
-            if (!loadTextureToGPU(material, material.diffuseTexture, device)) {
-                std::cerr << "Failed to copy texture: " << material.diffuseTexture << std::endl;
-            }
+void Model::weldMeshes() {
+    auto startTime = std::chrono::high_resolution_clock::now();
+    
+    for (auto& mesh : m_asset->meshes) {
+        mesh.sourceVertexCount = mesh.vertices.size();
+    }
+    if (!m_importOptions.weldVertices) {
+        return;
+    }
+    
+    ThreadPool::get().parallelFor(m_asset->meshes.size(), [this](size_t i) {
+        VertexWelder::weld(m_asset->meshes[i].vertices, m_asset->meshes[i].indices, m_importOptions.weldEpsilon);
+    });
+    
+    m_importTimings.weldMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+}
+
+void Model::optimizeMeshes() {
+    m_asset->vertexCacheReport = VertexCacheReport{};
+    if (!m_importOptions.optimizeMeshes) {
+        return;
+    }
+    auto startTime = std::chrono::high_resolution_clock::now();
+    
+    std::vector<VertexCacheStats> before(m_asset->meshes.size());
+    std::vector<VertexCacheStats> after(m_asset->meshes.size());
+    ThreadPool::get().parallelFor(m_asset->meshes.size(), [&](size_t i) {
+        Mesh& mesh = m_asset->meshes[i];
+        if (mesh.indices.size() % 3 != 0) {
+            return;
         }
+        before[i] = MeshOptimizer::analyzeVertexCache(mesh.indices, mesh.vertices.size());
         
-        m_materials.push_back(material);
+        MeshOptimizer::optimizeVertexCache(mesh.indices, mesh.vertices.size());
+        MeshOptimizer::optimizeOverdraw(mesh.indices, mesh.vertices);
+        MeshOptimizer::optimizeVertexFetch(mesh.vertices, mesh.indices);
+        
+        after[i] = MeshOptimizer::analyzeVertexCache(mesh.indices, mesh.vertices.size());
+    });
+    
+    VertexCacheStats totalBefore;
+    VertexCacheStats totalAfter;
+    for (size_t i = 0; i < m_asset->meshes.size(); i++) {
+        totalBefore += before[i];
+        totalAfter += after[i];
     }
+    m_asset->vertexCacheReport.acmrBefore = totalBefore.getACMR();
+    m_asset->vertexCacheReport.acmrAfter = totalAfter.getACMR();
+    m_asset->vertexCacheReport.atvrBefore = totalBefore.getATVR();
+    m_asset->vertexCacheReport.atvrAfter = totalAfter.getATVR();
     
+    m_importTimings.optimizeMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+}
 
-    m_meshes.reserve(other.m_meshes.size());
-    for (const auto& otherMesh : other.m_meshes) {
-        Mesh mesh;
-        mesh.vertices = otherMesh.vertices;
-        mesh.indices = otherMesh.indices;
-        mesh.materialName = otherMesh.materialName;
-        mesh.materialIndex = otherMesh.materialIndex;
-        
+void Model::buildMeshlets() {
+    for (auto& mesh : m_asset->meshes) {
+        mesh.meshlets.clear();
+    }
+    if (!m_importOptions.buildMeshlets) {
+        return;
+    }
+    auto startTime = std::chrono::high_resolution_clock::now();
+    
+    
+    // Meshlets regroup the cache-optimized triangles, so fetch order and the ACMR report are redone afterwards
+    std::vector<VertexCacheStats> after(m_asset->meshes.size());
+    ThreadPool::get().parallelFor(m_asset->meshes.size(), [&](size_t i) {
+        Mesh& mesh = m_asset->meshes[i];
+        mesh.meshlets = MeshletBuilder::build(mesh.vertices, mesh.indices);
+        if (m_importOptions.optimizeMeshes && !mesh.meshlets.empty()) {
+            MeshOptimizer::optimizeVertexFetch(mesh.vertices, mesh.indices);
+        }
+        after[i] = MeshOptimizer::analyzeVertexCache(mesh.indices, mesh.vertices.size());
+    });
+    
+    VertexCacheStats totalAfter;
+    for (size_t i = 0; i < m_asset->meshes.size(); i++) {
+        totalAfter += after[i];
+    }
+    if (m_importOptions.optimizeMeshes) {
+        m_asset->vertexCacheReport.acmrAfter = totalAfter.getACMR();
+        m_asset->vertexCacheReport.atvrAfter = totalAfter.getATVR();
+    }
+    
+    m_importTimings.meshletMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+}
 
-        mesh.vertexBuffer = VK_NULL_HANDLE;
-        mesh.vertexBufferMemory = VK_NULL_HANDLE;
-        mesh.indexBuffer = VK_NULL_HANDLE;
-        mesh.indexBufferMemory = VK_NULL_HANDLE;
+void Model::generateLods() {
+    for (auto& mesh : m_asset->meshes) {
+        mesh.lodIndices.clear();
+        mesh.lods.clear();
+    }
+    if (!m_importOptions.generateLods) {
+        return;
+    }
+    auto startTime = std::chrono::high_resolution_clock::now();
+    
+    
+    // Each level halves the previous one; errors add up because every pass starts from fresh quadrics
+    ThreadPool::get().parallelFor(m_asset->meshes.size(), [this](size_t i) {
+        Mesh& mesh = m_asset->meshes[i];
+        if (mesh.indices.size() % 3 != 0 || mesh.indices.size() / 3 < MIN_LOD_TRIANGLES) {
+            return;
+        }
         
+        const std::vector<uint32_t>* previous = &mesh.indices;
+        std::vector<uint32_t> simplified;
+        float error = 0.0f;
+        for (size_t level = 0; level < MAX_LOD_LEVELS; level++) {
+            float levelError = 0.0f;
+            std::vector<uint32_t> next = MeshSimplifier::simplify(mesh.vertices, *previous, previous->size() / 6 * 3, levelError);
+            if (next.empty() || next.size() > previous->size() * 3 / 4) {
+                break;
+            }
+            if (m_importOptions.optimizeMeshes) {
+                MeshOptimizer::optimizeVertexCache(next, mesh.vertices.size());
+            }
+            
+            error += levelError;
+            MeshLod lod;
+            lod.firstIndex = static_cast<uint32_t>(mesh.indices.size() + mesh.lodIndices.size());
+            lod.indexCount = static_cast<uint32_t>(next.size());
+            lod.error = error;
+            mesh.lods.push_back(lod);
+            mesh.lodIndices.insert(mesh.lodIndices.end(), next.begin(), next.end());
+            
+            if (next.size() / 3 < MIN_LOD_TRIANGLES) {
+                break;
+            }
+            simplified = std::move(next);
+            previous = &simplified;
+        }
+    });
+    
+    m_importTimings.lodMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - startTime).count();
+}
 
-        createSingleMeshBuffers(mesh, device);
-        
-        m_meshes.push_back(mesh);
+void Model::computeBounds() {
+    glm::vec3 minBounds(FLT_MAX);
+    glm::vec3 maxBounds(-FLT_MAX);
+    
+    
+    // Bounds of each shared mesh once, then the corners of that box through every instance
+    std::vector<std::pair<glm::vec3, glm::vec3>> meshBounds(m_asset->meshes.size(), {glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)});
+    for (size_t i = 0; i < m_asset->meshes.size(); i++) {
+        for (const auto& vertex : m_asset->meshes[i].vertices) {
+            meshBounds[i].first = glm::min(meshBounds[i].first, vertex.pos);
+            meshBounds[i].second = glm::max(meshBounds[i].second, vertex.pos);
+        }
+    }
+    for (const auto& instance : m_asset->instances) {
+        if (instance.meshIndex >= meshBounds.size() || meshBounds[instance.meshIndex].first.x > meshBounds[instance.meshIndex].second.x) {
+            continue;
+        }
+        const auto& [low, high] = meshBounds[instance.meshIndex];
+        for (int corner = 0; corner < 8; corner++) {
+            glm::vec3 point((corner & 1) ? high.x : low.x, (corner & 2) ? high.y : low.y, (corner & 4) ? high.z : low.z);
+            point = glm::vec3(instance.transform * glm::vec4(point, 1.0f));
+            minBounds = glm::min(minBounds, point);
+            maxBounds = glm::max(maxBounds, point);
+        }
+    }
+    
+    if (minBounds.x > maxBounds.x) {
+        minBounds = maxBounds = glm::vec3(0.0f);
+    }
+    m_asset->boundsMin = minBounds;
+    m_asset->boundsMax = maxBounds;
+}
+
+bool Model::copyFrom(const Model& other, VulkanDevice& device) {
+
+    cleanup(device);
+    
+
+    m_name = other.m_name + "_copy";
+    m_directory = other.m_directory;
+    m_filepath = other.m_filepath;
+    m_transform = other.m_transform;
+    m_forceUVFlip = other.m_forceUVFlip;
+    m_importOptions = other.m_importOptions;
+    
+    
+    // Geometry is shared as is; only the transform and the materials belong to the copy
+    m_asset = other.m_asset;
+    m_uploadTicket = other.m_uploadTicket;
+    
+    // Copies share the source's images; the UVs were already fixed up when it was loaded
+    TextureCache* textureCache = device.getTextureCache();
+    m_materials = other.m_materials;
+    for (auto& material : m_materials) {
+        material.texture = textureCache ? textureCache->acquire(material.texture) : nullptr;
     }
     
     return true;
 }
 
-void Model::render(VkCommandBuffer commandBuffer) {
-    for (const auto& mesh : m_meshes) {
-        VkBuffer vertexBuffers[] = {mesh.vertexBuffer};
-        VkDeviceSize offsets[] = {0};
-        vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
-        vkCmdBindIndexBuffer(commandBuffer, mesh.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+void Model::render(VkCommandBuffer commandBuffer, const GeometryPool& pool,
+                   const std::function<void(const Mesh&, const glm::mat4&)>& beforeDraw) const {
+    uint32_t boundBlock = UINT32_MAX;
+    VkIndexType boundIndexType = VK_INDEX_TYPE_MAX_ENUM;
+    for (const auto& instance : m_asset->instances) {
+        if (instance.meshIndex >= m_asset->meshes.size() || !m_asset->meshes[instance.meshIndex].geometry) {
+            continue;
+        }
+        const Mesh& mesh = m_asset->meshes[instance.meshIndex];
+        if (mesh.geometry->block != boundBlock || mesh.geometry->getIndexType() != boundIndexType) {
+            boundBlock = mesh.geometry->block;
+            boundIndexType = mesh.geometry->getIndexType();
+            pool.bindBlock(commandBuffer, boundBlock, boundIndexType);
+        }
+        if (beforeDraw) {
+            beforeDraw(mesh, instance.transform);
+        }
         
-        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(mesh.indices.size()), 1, 0, 0, 0);
+        vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(mesh.indices.size()), 1,
+                         mesh.geometry->firstIndex, mesh.geometry->vertexOffset, 0);
     }
 }
 
-void Model::cleanup(VulkanDevice& device) {
-    for (auto& mesh : m_meshes) {
-        if (mesh.vertexBuffer != VK_NULL_HANDLE) {
-            vkDestroyBuffer(device.getDevice(), mesh.vertexBuffer, nullptr);
-            mesh.vertexBuffer = VK_NULL_HANDLE;
-        }
-        if (mesh.vertexBufferMemory != VK_NULL_HANDLE) {
-            vkFreeMemory(device.getDevice(), mesh.vertexBufferMemory, nullptr);
-            mesh.vertexBufferMemory = VK_NULL_HANDLE;
+void Model::setQuantizeVertices(bool quantize, VulkanDevice& device) {
+    if (m_importOptions.quantizeVertices == quantize) {
+        return;
+    }
+    m_importOptions.quantizeVertices = quantize;
+    
+    VkDeviceSize bytesBefore = 0;
+    for (const auto& mesh : m_asset->meshes) {
+        if (mesh.geometry) {
+            bytesBefore += mesh.geometry->vertexBytes;
         }
-        if (mesh.indexBuffer != VK_NULL_HANDLE) {
-            vkDestroyBuffer(device.getDevice(), mesh.indexBuffer, nullptr);
-            mesh.indexBuffer = VK_NULL_HANDLE;
+    }
+    
+    // Other copies keep the old layout; a private asset has its old ranges freed first
+    if (!detachAsset()) {
+        for (auto& mesh : m_asset->meshes) {
+            mesh.cleanup(device);
         }
-        if (mesh.indexBufferMemory != VK_NULL_HANDLE) {
-            vkFreeMemory(device.getDevice(), mesh.indexBufferMemory, nullptr);
-            mesh.indexBufferMemory = VK_NULL_HANDLE;
+    }
+    createBuffers(device);
+    
+    VkDeviceSize bytesAfter = 0;
+    for (const auto& mesh : m_asset->meshes) {
+        if (mesh.geometry) {
+            bytesAfter += mesh.geometry->vertexBytes;
         }
     }
-    m_meshes.clear();
+    std::cout << m_name << ": vertex data " << (bytesBefore / (1024.0 * 1024.0)) << " MB -> "
+              << (bytesAfter / (1024.0 * 1024.0)) << " MB (" << (quantize ? "quantized" : "full precision") << ")" << std::endl;
+}
+
+void Model::cleanup(VulkanDevice& device) {
+    // A cancelled or removed import may still have copies in flight into the ranges released below
+    device.waitForUpload(m_uploadTicket);
+    m_uploadTicket = 0;
+    for (auto& material : m_materials) {
+        releaseTexture(material, device);
+    }
+    
+    // The geometry goes back to the pool once the last model sharing it lets go
+    m_asset = std::make_shared<MeshAsset>();
     m_materials.clear();
+    m_uploadPending = false;
+    m_detachedUploadPending = false;
+    m_decodedTextures.clear();
+    m_cacheSource.reset();
+}
+
+void Model::instanceEachMeshOnce() {
+    m_asset->instances.resize(m_asset->meshes.size());
+    for (size_t i = 0; i < m_asset->meshes.size(); i++) {
+        m_asset->instances[i].meshIndex = static_cast<uint32_t>(i);
+        m_asset->instances[i].transform = glm::mat4(1.0f);
+    }
 }
 
-bool Model::loadWithAssimp(const std::string& filepath, VulkanDevice& device) {
+bool Model::loadWithAssimp(const std::string& filepath) {
     std::cout << "Loading model with transform pre-processing and UV analysis..." << std::endl;
     
+    m_importTimings = ImportTimings{};
+    auto importStart = std::chrono::high_resolution_clock::now();
+    auto stageStart = importStart;
+    auto endStage = [&stageStart](double& stageMs) {
+        auto now = std::chrono::high_resolution_clock::now();
+        stageMs = std::chrono::duration<double, std::milli>(now - stageStart).count();
+        stageStart = now;
+    };
+    
     Assimp::Importer importer;
     
 
@@ -201,6 +821,10 @@ bool Model::loadWithAssimp(const std::string& filepath, VulkanDevice& device) {
     importer.SetPropertyInteger(AI_CONFIG_PP_SLM_VERTEX_LIMIT, 10000000);      
     importer.SetPropertyFloat(AI_CONFIG_PP_GSN_MAX_SMOOTHING_ANGLE, 180.0f); 
     importer.SetPropertyBool(AI_CONFIG_IMPORT_FBX_PRESERVE_PIVOTS, true);    
+    if (m_progress) {
+        importer.SetProgressHandler(new AssimpProgressHandler(m_progress));
+    }
+    reportProgress("Reading file", 0.0f);
     
 
     const aiScene* scene = importer.ReadFile(filepath, 
@@ -209,10 +833,16 @@ bool Model::loadWithAssimp(const std::string& filepath, VulkanDevice& device) {
 
     );
     
+    if (isCancelled()) {
+        std::cout << "Import cancelled: " << filepath << std::endl;
+        return false;
+    }
     if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) {
         std::cerr << "Assimp Error: " << importer.GetErrorString() << std::endl;
         return false;
     }
+    endStage(m_importTimings.readMs);
+    reportProgress("Reading materials", READ_PROGRESS);
     
    
     m_materials.reserve(scene->mNumMaterials);
@@ -247,32 +877,35 @@ bool Model::loadWithAssimp(const std::string& filepath, VulkanDevice& device) {
         
         m_materials.push_back(material);
     }
+    endStage(m_importTimings.materialsMs);
     
     
-    processNode(scene->mRootNode, scene, device);
-    
-    
-    int textureCount = 0;
-    for (size_t i = 0; i < m_materials.size(); i++) {
-        auto& material = m_materials[i];
-        if (!material.diffuseTexture.empty()) {
-            if (loadTextureToGPU(material, material.diffuseTexture, device)) {
-                textureCount++;
-            } else {
-                std::cerr << "ERROR: Failed to load texture for material " << i << std::endl;
-            }
-        }
-    }
-    
-    if (textureCount > 0) {
-        std::cout << "Loaded " << textureCount << " textures to GPU" << std::endl;
+    // Texture paths are final here, so decoding runs alongside the mesh processing
+    startTextureDecode();
+    bool processed = processNodes(scene);
+    finishTextureDecode(processed);
+    if (!processed || isCancelled()) {
+        return false;
     }
     
     
     m_transform = glm::mat4(1.0f);
     
+    m_importTimings.totalMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - importStart).count();
+    
     std::cout << "Successfully loaded model: " << filepath << std::endl;
-    std::cout << "Meshes: " << m_meshes.size() << ", Materials: " << m_materials.size() << std::endl;
+    std::cout << "Meshes: " << m_asset->meshes.size() << ", Materials: " << m_materials.size() << std::endl;
+    std::cout << "Import timings (ms): read " << m_importTimings.readMs
+              << ", materials " << m_importTimings.materialsMs
+              << ", flatten " << m_importTimings.flattenMs
+              << ", convert " << m_importTimings.convertMs
+              << ", weld " << m_importTimings.weldMs
+              << ", optimize " << m_importTimings.optimizeMs
+              << ", meshlets " << m_importTimings.meshletMs
+              << ", lod " << m_importTimings.lodMs
+              << ", textures " << m_importTimings.texturesMs
+              << ", total " << m_importTimings.totalMs << std::endl;
     
 
     bool hasTextureIssues = false;
@@ -291,65 +924,92 @@ bool Model::loadWithAssimp(const std::string& filepath, VulkanDevice& device) {
     return true;
 }
 
-void Model::processNode(aiNode* node, const aiScene* scene, VulkanDevice& device) {
+bool Model::processNodes(const aiScene* scene) {
+    auto stageStart = std::chrono::high_resolution_clock::now();
+    auto endStage = [&stageStart](double& stageMs) {
+        auto now = std::chrono::high_resolution_clock::now();
+        stageMs = std::chrono::duration<double, std::milli>(now - stageStart).count();
+        stageStart = now;
+    };
+    
 
-    aiMatrix4x4 nodeTransform = node->mTransformation;
+    std::vector<std::pair<unsigned int, aiMatrix4x4>> workList;
+    collectMeshNodes(scene->mRootNode, aiMatrix4x4(), workList);
     
     
-    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
-        aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-        Mesh processedMesh = processMesh(mesh, scene, device);
-        
-      
-        if (!nodeTransform.IsIdentity()) {
-            for (auto& vertex : processedMesh.vertices) {
-                aiVector3D pos(vertex.pos.x, vertex.pos.y, vertex.pos.z);
-                pos = nodeTransform * pos;
-                vertex.pos = glm::vec3(pos.x, pos.y, pos.z);
-                
-               
-                aiVector3D normal(vertex.normal.x, vertex.normal.y, vertex.normal.z);
-                aiMatrix4x4 normalMatrix = nodeTransform;
-                normalMatrix.Inverse().Transpose();
-                normal = normalMatrix * normal;
-                vertex.normal = glm::normalize(glm::vec3(normal.x, normal.y, normal.z));
-            }
-            
-            
-            processedMesh.cleanup(device);
-            createSingleMeshBuffers(processedMesh, device);
+    // Every aiMesh is converted once, however many nodes use it; the nodes become instances
+    std::vector<uint32_t> meshSlot(scene->mNumMeshes, UINT32_MAX);
+    std::vector<unsigned int> uniqueMeshes;
+    uint32_t baseMesh = static_cast<uint32_t>(m_asset->meshes.size());
+    m_asset->instances.reserve(m_asset->instances.size() + workList.size());
+    for (const auto& [meshIndex, worldTransform] : workList) {
+        if (meshIndex >= scene->mNumMeshes) {
+            continue;
         }
-        
-        m_meshes.push_back(processedMesh);
+        if (meshSlot[meshIndex] == UINT32_MAX) {
+            meshSlot[meshIndex] = static_cast<uint32_t>(uniqueMeshes.size());
+            uniqueMeshes.push_back(meshIndex);
+        }
+        MeshInstance instance;
+        instance.meshIndex = baseMesh + meshSlot[meshIndex];
+        instance.transform = toGlm(worldTransform);
+        m_asset->instances.push_back(instance);
     }
     
+    
+    if (m_materials.empty() && !workList.empty()) {
+        Material defaultMaterial;
+        defaultMaterial.name = "default";
+        defaultMaterial.diffuse = glm::vec3(0.7f, 0.7f, 0.7f);
+        m_materials.push_back(defaultMaterial);
+        std::cout << "    Created default material" << std::endl;
+    }
+    endStage(m_importTimings.flattenMs);
+    if (!reportProgress("Converting meshes", 0.45f)) {
+        return false;
+    }
+    
+    
+    // Each work item writes only its own slot, so the mesh order follows first use in depth-first node order
+    std::vector<Mesh> converted(uniqueMeshes.size());
+    ThreadPool::get().parallelFor(uniqueMeshes.size(), [&](size_t i) {
+        converted[i] = processMesh(scene->mMeshes[uniqueMeshes[i]]);
+    });
+    endStage(m_importTimings.convertMs);
+    
+    
+    m_asset->meshes.reserve(m_asset->meshes.size() + converted.size());
+    for (auto& mesh : converted) {
+        m_asset->meshes.push_back(std::move(mesh));
+    }
+    std::cout << "Converted " << uniqueMeshes.size() << " unique meshes for " << workList.size() << " instances on "
+              << (ThreadPool::get().getThreadCount() + 1) << " threads" << std::endl;
+    return processImportedMeshes();
+}
 
+void Model::collectMeshNodes(const aiNode* node, const aiMatrix4x4& parentTransform,
+                             std::vector<std::pair<unsigned int, aiMatrix4x4>>& workList) const {
+    aiMatrix4x4 worldTransform = parentTransform * node->mTransformation;
+    for (unsigned int i = 0; i < node->mNumMeshes; i++) {
+        workList.emplace_back(node->mMeshes[i], worldTransform);
+    }
+    
     for (unsigned int i = 0; i < node->mNumChildren; i++) {
-        processNode(node->mChildren[i], scene, device);
+        collectMeshNodes(node->mChildren[i], worldTransform, workList);
     }
 }
 
-Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, VulkanDevice& device) {
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-    
-    std::cout << "  Processing mesh with " << mesh->mNumVertices << " vertices, " << mesh->mNumFaces << " faces" << std::endl;
-    
-    
+Mesh Model::processMesh(const aiMesh* mesh) const {
+    Mesh resultMesh;
+    resultMesh.vertices.resize(mesh->mNumVertices);
     
-   
     for (unsigned int i = 0; i < mesh->mNumVertices; i++) {
-        Vertex vertex;
-        
-       
-        vertex.pos = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+        Vertex& vertex = resultMesh.vertices[i];
         
-       
-        if (mesh->HasNormals()) {
-            vertex.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
-        } else {
-            vertex.normal = glm::vec3(0.0f, 1.0f, 0.0f);
-        }
+        const aiVector3D& pos = mesh->mVertices[i];
+        aiVector3D normal = mesh->HasNormals() ? mesh->mNormals[i] : aiVector3D(0.0f, 1.0f, 0.0f);
+        vertex.pos = glm::vec3(pos.x, pos.y, pos.z);
+        vertex.normal = glm::vec3(normal.x, normal.y, normal.z);
         
        
         if (mesh->mTextureCoords[0]) {
@@ -358,51 +1018,25 @@ Mesh Model::processMesh(aiMesh* mesh, const aiScene* scene, VulkanDevice& device
         } else {
             vertex.texCoord = glm::vec2(0.0f, 0.0f);
         }
-        
-        vertices.push_back(vertex);
     }
     
    
+    resultMesh.indices.reserve(static_cast<size_t>(mesh->mNumFaces) * 3);
     for (unsigned int i = 0; i < mesh->mNumFaces; i++) {
-        aiFace face = mesh->mFaces[i];
+        const aiFace& face = mesh->mFaces[i];
         for (unsigned int j = 0; j < face.mNumIndices; j++) {
-            indices.push_back(face.mIndices[j]);
+            resultMesh.indices.push_back(face.mIndices[j]);
         }
     }
     
     
-    Mesh resultMesh;
-    resultMesh.vertices = vertices;
-    resultMesh.indices = indices;
-    
-    
-    if (!m_materials.empty() && mesh->mMaterialIndex < m_materials.size()) {
-        resultMesh.materialName = m_materials[mesh->mMaterialIndex].name;
+    // Materials are created before conversion starts, so workers only read m_materials
+    if (mesh->mMaterialIndex < m_materials.size()) {
         resultMesh.materialIndex = mesh->mMaterialIndex;
-        std::cout << "    Material: " << mesh->mMaterialIndex << " (" << resultMesh.materialName << ")" << std::endl;
     } else {
-        
-        if (m_materials.empty()) {
-            Material defaultMaterial;
-            defaultMaterial.name = "default";
-            defaultMaterial.diffuse = glm::vec3(0.7f, 0.7f, 0.7f);
-            m_materials.push_back(defaultMaterial);
-            std::cout << "    Created default material" << std::endl;
-        }
-        
-        resultMesh.materialName = m_materials[0].name;
         resultMesh.materialIndex = 0;
-        
-        if (mesh->mMaterialIndex >= m_materials.size()) {
-            std::cout << "    WARNING: Invalid material index " << mesh->mMaterialIndex 
-                      << ", using material 0" << std::endl;
-        }
     }
-    
- 
-    
-    
-    createSingleMeshBuffers(resultMesh, device);
+    resultMesh.materialName = m_materials[resultMesh.materialIndex].name;
     
     return resultMesh;
 }
@@ -411,45 +1045,9 @@ void Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std:
     for (unsigned int i = 0; i < mat->GetTextureCount(type); i++) {
         aiString str;
         mat->GetTexture(type, i, &str);
-        std::string textureFilename = str.C_Str();
-        
-       
-        
-
-        std::vector<std::string> possiblePaths = {
-            m_directory + textureFilename,                          
-            m_directory + "../textures/" + textureFilename,          
-            m_directory + "textures/" + textureFilename,            
-            m_directory + "../" + textureFilename,                   
-        };
-        
-
-        size_t dotPos = textureFilename.find_last_of('.');
-        if (dotPos == std::string::npos) {
-
-            std::vector<std::string> extensions = {".png", ".jpg", ".jpeg", ".tga", ".bmp"};
-            for (const auto& basePath : possiblePaths) {
-                for (const auto& ext : extensions) {
-                    possiblePaths.push_back(basePath + ext);
-                }
-            }
-        }
-        
-        std::string finalTexturePath;
-        bool found = false;
-        
-
-        for (const auto& path : possiblePaths) {
-            std::ifstream file(path);
-            if (file.good()) {
-                finalTexturePath = path;
-                found = true;
-               
-                break;
-            }
-        }
         
-        if (!found) {
+        std::string finalTexturePath = resolveTexturePath(str.C_Str());
+        if (finalTexturePath.empty()) {
 
             return;
         }
@@ -464,234 +1062,222 @@ void Model::loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std:
     }
 }
 
-bool Model::loadOBJ(const std::string& filepath, VulkanDevice& device) {
-    std::ifstream file(filepath);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open file: " << filepath << std::endl;
-        return false;
+std::string Model::resolveTexturePath(const std::string& textureFilename) {
+    if (textureFilename.empty()) {
+        return std::string();
     }
-
-
-    size_t lastSlash = filepath.find_last_of("/\\");
-    size_t lastDot = filepath.find_last_of('.');
-    m_name = filepath.substr(lastSlash + 1, lastDot - lastSlash - 1);
     
+    
+    // The model directory and its texture folders are listed once per directory, not probed per candidate
+    if (!m_textureIndex) {
+        m_textureIndex = TexturePathResolver::get().getIndex(m_directory);
+    }
+    TexturePathLookup lookup;
+    std::string path = m_textureIndex->resolve(textureFilename, &lookup);
+    TexturePathResolver::get().recordLookup(lookup, !path.empty());
+    m_importTimings.texturePathLookups++;
+    m_importTimings.texturePathProbesAvoided += lookup.probesAvoided;
+    return path;
+}
 
-    m_directory = filepath.substr(0, lastSlash + 1);
-
-    std::vector<glm::vec3> positions;
-    std::vector<glm::vec3> normals;
-    std::vector<glm::vec2> texCoords;
+bool Model::loadOBJ(const std::string& filepath) {
+    m_importTimings = ImportTimings{};
+    auto importStart = std::chrono::high_resolution_clock::now();
+    auto stageStart = importStart;
+    auto endStage = [&stageStart](double& stageMs) {
+        auto now = std::chrono::high_resolution_clock::now();
+        stageMs = std::chrono::duration<double, std::milli>(now - stageStart).count();
+        stageStart = now;
+    };
+    
+    reportProgress("Parsing OBJ", 0.0f);
+    ObjData data;
+    if (!ObjParser::parse(filepath, data) || !reportProgress("Reading materials", READ_PROGRESS)) {
+        return false;
+    }
+    endStage(m_importTimings.readMs);
     
-    std::vector<Vertex> vertices;
-    std::vector<uint32_t> indices;
-    std::unordered_map<std::string, uint32_t> uniqueVertices;
     
-    std::string line;
-    while (std::getline(file, line)) {
-        std::istringstream iss(line);
-        std::string prefix;
-        iss >> prefix;
-        
-        if (prefix == "v") {
-
-            glm::vec3 pos;
-            iss >> pos.x >> pos.y >> pos.z;
-            positions.push_back(pos);
-        } else if (prefix == "vn") {
-           
-            glm::vec3 normal;
-            iss >> normal.x >> normal.y >> normal.z;
-            normals.push_back(normal);
-        } else if (prefix == "vt") {
-
-            glm::vec2 texCoord;
-            iss >> texCoord.x >> texCoord.y;
-            texCoords.push_back(texCoord);
-        } else if (prefix == "f") {
-
-            std::string vertexStr;
-            std::vector<std::string> faceVertices;
-            
-            while (iss >> vertexStr) {
-                faceVertices.push_back(vertexStr);
+    // mtllib may name several space-separated libraries; try the whole string first since names can contain spaces
+    for (const auto& library : data.materialLibraries) {
+        std::vector<std::string> candidates = {library};
+        std::istringstream names(library);
+        std::string name;
+        while (names >> name) {
+            if (name != library) {
+                candidates.push_back(name);
             }
-            
-
-            for (size_t i = 1; i < faceVertices.size() - 1; i++) {
-                for (size_t j = 0; j < 3; j++) {
-                    size_t idx = (j == 0) ? 0 : i + j - 1;
-                    std::string vertex = faceVertices[idx];
-                    
-                    if (uniqueVertices.count(vertex) == 0) {
-                        uniqueVertices[vertex] = static_cast<uint32_t>(vertices.size());
-                        
-                        Vertex v{};
-                        
-                        
-                        std::istringstream viss(vertex);
-                        std::string posStr, texStr, normalStr;
-                        
-                        std::getline(viss, posStr, '/');
-                        std::getline(viss, texStr, '/');
-                        std::getline(viss, normalStr, '/');
-                        
-                      
-                        int posIdx = std::stoi(posStr) - 1;
-                        if (posIdx >= 0 && posIdx < positions.size()) {
-                            v.pos = positions[posIdx];
-                        }
-                        
-                    
-                        if (!texStr.empty()) {
-                            int texIdx = std::stoi(texStr) - 1;
-                            if (texIdx >= 0 && texIdx < texCoords.size()) {
-                                v.texCoord = texCoords[texIdx];
-                            }
-                        }
-                        
-                     
-                        if (!normalStr.empty()) {
-                            int normalIdx = std::stoi(normalStr) - 1;
-                            if (normalIdx >= 0 && normalIdx < normals.size()) {
-                                v.normal = normals[normalIdx];
-                            }
-                        } else {
-                           
-                            v.normal = glm::vec3(0.0f, 1.0f, 0.0f);
-                        }
-                        
-                        vertices.push_back(v);
-                    }
-                    
-                    indices.push_back(uniqueVertices[vertex]);
+        }
+        for (const auto& candidate : candidates) {
+            if (std::ifstream(m_directory + candidate).good()) {
+                ObjParser::parseMaterialLibrary(m_directory + candidate, m_materials);
+                if (candidate == library) {
+                    break;
                 }
             }
         }
     }
     
-    file.close();
-    
-    if (vertices.empty()) {
-        std::cerr << "No vertices found in OBJ file: " << filepath << std::endl;
-        return false;
+    for (auto& material : m_materials) {
+        material.diffuseTexture = resolveTexturePath(material.diffuseTexture);
+        material.normalTexture = resolveTexturePath(material.normalTexture);
+        material.specularTexture = resolveTexturePath(material.specularTexture);
     }
     
-
-    Mesh mesh;
-    mesh.vertices = vertices;
-    mesh.indices = indices;
-    mesh.materialName = "default";
-    
-    m_meshes.push_back(mesh);
+    std::unordered_map<std::string, uint32_t> materialByName;
+    for (size_t i = 0; i < m_materials.size(); i++) {
+        materialByName.emplace(m_materials[i].name, static_cast<uint32_t>(i));
+    }
     
-
-    Material defaultMaterial;
-    defaultMaterial.name = "default";
-    defaultMaterial.ambient = glm::vec3(0.2f);
-    defaultMaterial.diffuse = glm::vec3(0.8f);
-    defaultMaterial.specular = glm::vec3(1.0f);
-    defaultMaterial.shininess = 32.0f;
-    m_materials.push_back(defaultMaterial);
+    m_asset->meshes.resize(data.meshes.size());
+    for (size_t i = 0; i < data.meshes.size(); i++) {
+        ObjMesh& source = data.meshes[i];
+        Mesh& mesh = m_asset->meshes[i];
+        mesh.vertices = std::move(source.vertices);
+        mesh.indices = std::move(source.indices);
+        mesh.materialName = source.materialName;
+        
+        auto it = materialByName.find(source.materialName);
+        if (it == materialByName.end()) {
+            Material material;
+            material.name = source.materialName;
+            material.ambient = glm::vec3(0.2f);
+            it = materialByName.emplace(source.materialName, static_cast<uint32_t>(m_materials.size())).first;
+            m_materials.push_back(material);
+        }
+        mesh.materialIndex = it->second;
+    }
+    instanceEachMeshOnce();
+    endStage(m_importTimings.materialsMs);
     
-
-    createBuffers(device);
+    startTextureDecode();
+    bool processed = processImportedMeshes();
+    finishTextureDecode(processed);
+    if (!processed || isCancelled()) {
+        return false;
+    }
     
-
     m_transform = glm::mat4(1.0f);  
     
+    m_importTimings.totalMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - importStart).count();
+    
+    size_t vertexCount = 0;
+    size_t indexCount = 0;
+    for (const auto& mesh : m_asset->meshes) {
+        vertexCount += mesh.vertices.size();
+        indexCount += mesh.indices.size();
+    }
     std::cout << "Successfully loaded OBJ file: " << filepath << std::endl;
-    std::cout << "Vertices: " << vertices.size() << ", Indices: " << indices.size() << std::endl;
+    std::cout << "Meshes: " << m_asset->meshes.size() << ", Materials: " << m_materials.size()
+              << ", Vertices: " << vertexCount << ", Indices: " << indexCount << std::endl;
+    std::cout << "Import timings (ms): parse " << m_importTimings.readMs
+              << ", materials " << m_importTimings.materialsMs
+              << ", weld " << m_importTimings.weldMs
+              << ", optimize " << m_importTimings.optimizeMs
+              << ", meshlets " << m_importTimings.meshletMs
+              << ", lod " << m_importTimings.lodMs
+              << ", textures " << m_importTimings.texturesMs
+              << ", total " << m_importTimings.totalMs << std::endl;
     
     return true;
 }
 
-void Model::createSingleMeshBuffers(Mesh& mesh, VulkanDevice& device) {
-
-    VkDeviceSize vertexBufferSize = sizeof(mesh.vertices[0]) * mesh.vertices.size();
-    
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    device.createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                      stagingBuffer, stagingBufferMemory);
-    
-    void* data;
-    vkMapMemory(device.getDevice(), stagingBufferMemory, 0, vertexBufferSize, 0, &data);
-    memcpy(data, mesh.vertices.data(), static_cast<size_t>(vertexBufferSize));
-    vkUnmapMemory(device.getDevice(), stagingBufferMemory);
-    
-    device.createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.vertexBuffer, mesh.vertexBufferMemory);
-    
-    device.copyBuffer(stagingBuffer, mesh.vertexBuffer, vertexBufferSize);
-    
-    vkDestroyBuffer(device.getDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(device.getDevice(), stagingBufferMemory, nullptr);
+void Model::createMeshBuffers(Mesh& mesh, VulkanDevice& device, UploadBatcher& batcher,
+                              const void* vertexSource, const void* indexSource) {
+    if (mesh.vertices.empty() || mesh.indices.empty()) {
+        return;
+    }
     
+    GeometryPool* pool = device.getGeometryPool();
+    if (!pool) {
+        throw std::runtime_error("no geometry pool registered with the device!");
+    }
 
-    VkDeviceSize indexBufferSize = sizeof(mesh.indices[0]) * mesh.indices.size();
-    
-    device.createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                      stagingBuffer, stagingBufferMemory);
-    
-    vkMapMemory(device.getDevice(), stagingBufferMemory, 0, indexBufferSize, 0, &data);
-    memcpy(data, mesh.indices.data(), static_cast<size_t>(indexBufferSize));
-    vkUnmapMemory(device.getDevice(), stagingBufferMemory);
-    
-    device.createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                      VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.indexBuffer, mesh.indexBufferMemory);
+    const Vertex* vertices = vertexSource ? static_cast<const Vertex*>(vertexSource) : mesh.vertices.data();
+    mesh.quantized = m_importOptions.quantizeVertices;
+    uint32_t vertexStride = mesh.quantized ? sizeof(QuantizedVertex) : sizeof(Vertex);
+    VkDeviceSize vertexBufferSize = static_cast<VkDeviceSize>(vertexStride) * mesh.vertices.size();
+    
+    
+    // The CPU copy always keeps 32-bit indices, they are narrowed only for the GPU
+    bool compactIndices = m_importOptions.compactIndices && mesh.vertices.size() < 65536;
+    uint32_t indexSize = compactIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+    size_t indexCount = mesh.indices.size() + mesh.lodIndices.size();
+    VkDeviceSize indexBufferSize = static_cast<VkDeviceSize>(indexSize) * indexCount;
+    mesh.geometry = pool->allocate(vertexBufferSize, vertexStride, indexBufferSize, indexSize);
+    mesh.dirtyBegin = mesh.dirtyEnd = 0;
+    m_asset->device = &device;
+    
+    VkBuffer buffer = pool->getBuffer(mesh.geometry->block);
+    if (mesh.quantized) {
+        glm::vec3 boundsMin(FLT_MAX);
+        glm::vec3 boundsMax(-FLT_MAX);
+        for (size_t i = 0; i < mesh.vertices.size(); i++) {
+            boundsMin = glm::min(boundsMin, vertices[i].pos);
+            boundsMax = glm::max(boundsMax, vertices[i].pos);
+        }
+        mesh.quantOffset = boundsMin;
+        mesh.quantScale = boundsMax - boundsMin;
+        
+        glm::vec3 inverseScale(0.0f);
+        for (int axis = 0; axis < 3; axis++) {
+            inverseScale[axis] = mesh.quantScale[axis] > 0.0f ? 1.0f / mesh.quantScale[axis] : 0.0f;
+        }
+        
+        std::vector<uint8_t> packed(static_cast<size_t>(vertexBufferSize));
+        QuantizedVertex* output = reinterpret_cast<QuantizedVertex*>(packed.data());
+        for (size_t i = 0; i < mesh.vertices.size(); i++) {
+            output[i] = quantizeVertex(vertices[i], mesh.quantOffset, inverseScale);
+        }
+        batcher.enqueueBufferCopy(std::move(packed), buffer, mesh.geometry->vertexByteOffset);
+    } else {
+        mesh.quantOffset = glm::vec3(0.0f);
+        mesh.quantScale = glm::vec3(1.0f);
+        batcher.enqueueBufferCopy(vertices, vertexBufferSize, buffer, mesh.geometry->vertexByteOffset);
+    }
     
-    device.copyBuffer(stagingBuffer, mesh.indexBuffer, indexBufferSize);
     
-    vkDestroyBuffer(device.getDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(device.getDevice(), stagingBufferMemory, nullptr);
+    // LOD levels go right behind the full-detail indices so they share the allocation
+    auto enqueueIndices = [&](const uint32_t* indices, size_t count, VkDeviceSize byteOffset) {
+        if (count == 0) {
+            return;
+        }
+        if (compactIndices) {
+            std::vector<uint8_t> narrowed(count * sizeof(uint16_t));
+            uint16_t* output = reinterpret_cast<uint16_t*>(narrowed.data());
+            for (size_t i = 0; i < count; i++) {
+                output[i] = static_cast<uint16_t>(indices[i]);
+            }
+            batcher.enqueueBufferCopy(std::move(narrowed), buffer, byteOffset);
+        } else {
+            batcher.enqueueBufferCopy(indices, count * sizeof(uint32_t), buffer, byteOffset);
+        }
+    };
+    const uint32_t* indices = indexSource ? static_cast<const uint32_t*>(indexSource) : mesh.indices.data();
+    enqueueIndices(indices, mesh.indices.size(), mesh.geometry->indexByteOffset);
+    enqueueIndices(mesh.lodIndices.data(), mesh.lodIndices.size(),
+                   mesh.geometry->indexByteOffset + static_cast<VkDeviceSize>(indexSize) * mesh.indices.size());
 }
 
-void Model::createBuffers(VulkanDevice& device) {
-    for (auto& mesh : m_meshes) {
-
-        VkDeviceSize vertexBufferSize = sizeof(mesh.vertices[0]) * mesh.vertices.size();
-        
-        VkBuffer stagingBuffer;
-        VkDeviceMemory stagingBufferMemory;
-        device.createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                          stagingBuffer, stagingBufferMemory);
-        
-        void* data;
-        vkMapMemory(device.getDevice(), stagingBufferMemory, 0, vertexBufferSize, 0, &data);
-        memcpy(data, mesh.vertices.data(), static_cast<size_t>(vertexBufferSize));
-        vkUnmapMemory(device.getDevice(), stagingBufferMemory);
-        
-        device.createBuffer(vertexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.vertexBuffer, mesh.vertexBufferMemory);
-        
-        device.copyBuffer(stagingBuffer, mesh.vertexBuffer, vertexBufferSize);
-        
-        vkDestroyBuffer(device.getDevice(), stagingBuffer, nullptr);
-        vkFreeMemory(device.getDevice(), stagingBufferMemory, nullptr);
-        
+bool Model::detachAsset() {
+    if (m_asset.use_count() <= 1) {
+        return false;
+    }
+    m_asset = m_asset->clone();
+    return true;
+}
 
-        VkDeviceSize indexBufferSize = sizeof(mesh.indices[0]) * mesh.indices.size();
-        
-        device.createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                          VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                          stagingBuffer, stagingBufferMemory);
-        
-        vkMapMemory(device.getDevice(), stagingBufferMemory, 0, indexBufferSize, 0, &data);
-        memcpy(data, mesh.indices.data(), static_cast<size_t>(indexBufferSize));
-        vkUnmapMemory(device.getDevice(), stagingBufferMemory);
-        
-        device.createBuffer(indexBufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                          VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, mesh.indexBuffer, mesh.indexBufferMemory);
-        
-        device.copyBuffer(stagingBuffer, mesh.indexBuffer, indexBufferSize);
-        
-        vkDestroyBuffer(device.getDevice(), stagingBuffer, nullptr);
-        vkFreeMemory(device.getDevice(), stagingBufferMemory, nullptr);
+void Model::createBuffers(VulkanDevice& device) {
+    m_detachedUploadPending = false;
+    UploadBatcher batcher(device);
+    for (auto& mesh : m_asset->meshes) {
+        createMeshBuffers(mesh, device, batcher);
     }
+    m_uploadStats = batcher.flush();
+    
+    std::cout << "Uploaded " << (m_uploadStats.bytes / (1024.0 * 1024.0)) << " MB of geometry in "
+              << m_uploadStats.copies << " copies, " << m_uploadStats.milliseconds << " ms" << std::endl;
 }
 
 void Model::subdivideMesh(Mesh& mesh, int subdivisionLevels) {
@@ -778,187 +1364,183 @@ void Model::setMaterialTexture(size_t materialIndex, const std::string& textureT
 }
 
 bool Model::loadTextureToGPU(Material& material, const std::string& filepath, VulkanDevice& device) {
-    std::cout << "Loading texture with AUTO-UV-FIX: " << filepath << std::endl;
-    
+    return loadTextureToGPU(material, filepath, device, true);
+}
 
-    int texWidth, texHeight, texChannels;
-    stbi_uc* pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+bool Model::loadTextureToGPU(Material& material, const std::string& filepath, VulkanDevice& device, bool fixUVs) {
+    std::cout << "Loading texture" << (fixUVs ? " with AUTO-UV-FIX: " : ": ") << filepath << std::endl;
     
-    if (!pixels) {
-        std::cerr << "Failed to load texture: " << filepath << std::endl;
+    
+    // A resident copy skips the decode and upload; the old image is released either way
+    TextureCache* cache = device.getTextureCache();
+    CachedTexture* resident = cache ? cache->acquire(filepath) : nullptr;
+    DecodedTexture texture;
+    if (!resident && !decodeTexture(filepath, texture)) {
         return false;
     }
     
     
-    std::cout << "=== AUTOMATIC UV FIX: Trying all variants to find the best one ===" << std::endl;
-    autoFixUVsForMaterial(material, device);
-    std::cout << "=== UV FIX COMPLETE! Texture should now map correctly ===" << std::endl;
-    
-    VkDeviceSize imageSize = texWidth * texHeight * 4;
+    if (fixUVs) {
+        std::cout << "=== AUTOMATIC UV FIX: Trying all variants to find the best one ===" << std::endl;
+        autoFixUVsForMaterial(material, device);
+        std::cout << "=== UV FIX COMPLETE! Texture should now map correctly ===" << std::endl;
+    }
     
+    if (resident) {
+        releaseTexture(material, device);
+        material.texture = resident;
+        m_uploadTicket = std::max(m_uploadTicket, resident->uploadTicket);
+        return true;
+    }
+    return uploadTexture(material, filepath, texture, device);
+}
 
-    VkBuffer stagingBuffer;
-    VkDeviceMemory stagingBufferMemory;
-    device.createBuffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                       stagingBuffer, stagingBufferMemory);
+void Model::startTextureDecode() {
+    auto decode = std::make_unique<TextureDecode>();
     
+    // Materials sharing a file decode it once; the upload finds the others in the texture cache
+    std::unordered_set<std::string> seen;
+    decode->paths.reserve(m_materials.size());
+    for (const auto& material : m_materials) {
+        bool first = seen.insert(material.diffuseTexture).second;
+        decode->paths.push_back(first ? material.diffuseTexture : std::string());
+    }
+    decode->textures.resize(m_materials.size());
+    decode->start = std::chrono::high_resolution_clock::now();
+    
+    TextureDecode* state = decode.get();
+    decode->batch = ThreadPool::get().parallelForAsync(decode->paths.size(), [this, state](size_t i) {
+        if (state->paths[i].empty() || isCancelled()) {
+            return;
+        }
+        if (!decodeTexture(state->paths[i], state->textures[i])) {
+            std::cerr << "ERROR: Failed to load texture for material " << i << std::endl;
+        } else if (m_importOptions.mipmapsOnCPU) {
+            MipGenerator::generate(state->textures[i]);
+        }
+        int64_t finished = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::high_resolution_clock::now() - state->start).count();
+        int64_t latest = state->finishedNs.load();
+        while (finished > latest && !state->finishedNs.compare_exchange_weak(latest, finished)) {
+        }
+    });
+    m_textureDecode = std::move(decode);
+}
 
-    void* data;
-    vkMapMemory(device.getDevice(), stagingBufferMemory, 0, imageSize, 0, &data);
-    memcpy(data, pixels, static_cast<size_t>(imageSize));
-    vkUnmapMemory(device.getDevice(), stagingBufferMemory);
+void Model::finishTextureDecode(bool fixUVs) {
+    if (!m_textureDecode) {
+        return;
+    }
+    reportProgress("Decoding textures", 0.9f);
+    auto waitStart = std::chrono::high_resolution_clock::now();
+    std::unique_ptr<TextureDecode> decode = std::move(m_textureDecode);
+    decode->batch.wait();
+    auto waitEnd = std::chrono::high_resolution_clock::now();
+    
+    m_decodedTextures = std::move(decode->textures);
+    m_decodedTextures.resize(m_materials.size());
+    size_t textureCount = 0;
+    m_importTimings.textureBytes = 0;
+    for (const auto& texture : m_decodedTextures) {
+        textureCount += texture.pixels.empty() ? 0 : 1;
+        m_importTimings.textureBytes += texture.pixels.size();
+    }
+    m_importTimings.textureDecodeMs = decode->finishedNs.load() / 1.0e6;
     
-    stbi_image_free(pixels);
     
-
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = static_cast<uint32_t>(texWidth);
-    imageInfo.extent.height = static_cast<uint32_t>(texHeight);
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
-    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    
-    if (vkCreateImage(device.getDevice(), &imageInfo, nullptr, &material.textureImage) != VK_SUCCESS) {
-        std::cerr << "Failed to create texture image!" << std::endl;
-        vkDestroyBuffer(device.getDevice(), stagingBuffer, nullptr);
-        vkFreeMemory(device.getDevice(), stagingBufferMemory, nullptr);
-        return false;
+    // Geometry is not on the GPU yet, so the fix-up only has to touch the CPU copy
+    if (fixUVs && !isCancelled()) {
+        std::unordered_set<std::string> decodedPaths;
+        for (size_t i = 0; i < m_decodedTextures.size(); i++) {
+            if (!m_decodedTextures[i].pixels.empty()) {
+                decodedPaths.insert(m_materials[i].diffuseTexture);
+            }
+        }
+        for (size_t i = 0; i < m_materials.size(); i++) {
+            if (!m_materials[i].diffuseTexture.empty() && decodedPaths.count(m_materials[i].diffuseTexture)) {
+                clampMaterialUVs(i);
+            }
+        }
     }
     
+    m_importTimings.texturesMs = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - waitStart).count();
+    if (textureCount > 0) {
+        double megabytes = m_importTimings.textureBytes / (1024.0 * 1024.0);
+        double seconds = m_importTimings.textureDecodeMs / 1000.0;
+        std::cout << "Decoded " << textureCount << " textures (" << megabytes << " MB) in "
+                  << m_importTimings.textureDecodeMs << " ms, "
+                  << (seconds > 0.0 ? megabytes / seconds : 0.0) << " MB/s on "
+                  << (ThreadPool::get().getThreadCount() + 1) << " threads; blocked "
+                  << std::chrono::duration<double, std::milli>(waitEnd - waitStart).count()
+                  << " ms waiting for them" << std::endl;
+    }
+}
 
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(device.getDevice(), material.textureImage, &memRequirements);
-    
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = device.findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+bool Model::decodeTexture(const std::string& filepath, DecodedTexture& texture) {
+    int texWidth, texHeight, texChannels;
+    stbi_uc* pixels = stbi_load(filepath.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
     
-    if (vkAllocateMemory(device.getDevice(), &allocInfo, nullptr, &material.textureImageMemory) != VK_SUCCESS) {
-        std::cerr << "Failed to allocate texture image memory!" << std::endl;
-        vkDestroyImage(device.getDevice(), material.textureImage, nullptr);
-        vkDestroyBuffer(device.getDevice(), stagingBuffer, nullptr);
-        vkFreeMemory(device.getDevice(), stagingBufferMemory, nullptr);
+    if (!pixels) {
+        std::cerr << "Failed to load texture: " << filepath << std::endl;
         return false;
     }
     
-    vkBindImageMemory(device.getDevice(), material.textureImage, material.textureImageMemory, 0);
-    
+    texture.width = static_cast<uint32_t>(texWidth);
+    texture.height = static_cast<uint32_t>(texHeight);
+    texture.mipLevels = 1;
+    texture.pixels.assign(pixels, pixels + static_cast<size_t>(texWidth) * texHeight * 4);
+    stbi_image_free(pixels);
+    return true;
+}
 
-    VkCommandBuffer commandBuffer = device.beginSingleTimeCommands();
-    
-   
-    VkImageMemoryBarrier barrier{};
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.image = material.textureImage;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.srcAccessMask = 0;
-    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    
-    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
-                        0, 0, nullptr, 0, nullptr, 1, &barrier);
-    
-
-    VkBufferImageCopy region{};
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-    region.imageOffset = {0, 0, 0};
-    region.imageExtent = {static_cast<uint32_t>(texWidth), static_cast<uint32_t>(texHeight), 1};
-    
-    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, material.textureImage, 
-                          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-    
-
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    
-    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                        0, 0, nullptr, 0, nullptr, 1, &barrier);
-    
-    device.endSingleTimeCommands(commandBuffer);
-    
-
-    VkImageViewCreateInfo viewInfo{};
-    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = material.textureImage;
-    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
-    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
-    viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = 1;
-    
-    if (vkCreateImageView(device.getDevice(), &viewInfo, nullptr, &material.textureImageView) != VK_SUCCESS) {
-        std::cerr << "Failed to create texture image view!" << std::endl;
+bool Model::uploadTexture(Material& material, const std::string& filepath, DecodedTexture& texture, VulkanDevice& device) {
+    UploadBatcher batcher(device);
+    if (!createTextureImage(material, filepath, texture, device, batcher)) {
         return false;
     }
     
+    // Queued like an import's textures; the model is drawn again once the ticket completes
+    UploadStats stats;
+    UploadTicket ticket = batcher.submit(stats);
+    material.texture->uploadTicket = ticket;
+    m_uploadTicket = std::max(m_uploadTicket, ticket);
+    return true;
+}
 
-    VkSamplerCreateInfo samplerInfo{};
-    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-    samplerInfo.magFilter = VK_FILTER_LINEAR;
-    samplerInfo.minFilter = VK_FILTER_LINEAR;
-    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-    samplerInfo.anisotropyEnable = VK_TRUE;
-    samplerInfo.maxAnisotropy = 16.0f;
-    samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-    samplerInfo.unnormalizedCoordinates = VK_FALSE;
-    samplerInfo.compareEnable = VK_FALSE;
-    samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-    
-    if (vkCreateSampler(device.getDevice(), &samplerInfo, nullptr, &material.textureSampler) != VK_SUCCESS) {
-        std::cerr << "Failed to create texture sampler!" << std::endl;
+bool Model::createTextureImage(Material& material, const std::string& filepath, DecodedTexture& texture,
+                               VulkanDevice& device, UploadBatcher& batcher) {
+    TextureCache* cache = device.getTextureCache();
+    if (!cache) {
+        std::cerr << "No texture cache, cannot upload " << filepath << std::endl;
         return false;
     }
-    
+    releaseTexture(material, device);
+    material.texture = cache->create(filepath, texture, batcher);
+    return material.texture != nullptr;
+}
 
-    vkDestroyBuffer(device.getDevice(), stagingBuffer, nullptr);
-    vkFreeMemory(device.getDevice(), stagingBufferMemory, nullptr);
-    
-    
-    return true;
+void Model::releaseTexture(Material& material, VulkanDevice& device) {
+    if (material.texture && device.getTextureCache()) {
+        device.getTextureCache()->release(material.texture);
+    }
+    material.texture = nullptr;
 }
 
 VkImageView Model::getMaterialTextureView(size_t materialIndex) const {
     if (materialIndex >= m_materials.size()) {
         return VK_NULL_HANDLE;
     }
-    return m_materials[materialIndex].textureImageView;
+    const CachedTexture* texture = m_materials[materialIndex].texture;
+    return texture ? texture->view : VK_NULL_HANDLE;
 }
 
 VkSampler Model::getMaterialTextureSampler(size_t materialIndex) const {
     if (materialIndex >= m_materials.size()) {
         return VK_NULL_HANDLE;
     }
-    return m_materials[materialIndex].textureSampler;
+    const CachedTexture* texture = m_materials[materialIndex].texture;
+    return texture ? texture->sampler : VK_NULL_HANDLE;
 }
 
 bool Model::analyzeUVPattern(aiMesh* mesh) {
@@ -1020,328 +1602,138 @@ bool Model::analyzeUVPattern(aiMesh* mesh) {
     return needsFlip;
 }
 
-void Model::reprocessUVCoordinates(VulkanDevice& device) {
-    std::cout << "Reprocessing UV coordinates with flip=" << m_forceUVFlip << " for model: " << m_name << std::endl;
-    
-
-    glm::mat4 savedTransform = m_transform;
-    std::string savedName = m_name;
-    
-
-    cleanup(device);
-    
-
-    m_meshes.clear();
-    
-
-    std::string extension = m_filepath.substr(m_filepath.find_last_of('.'));
-    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
-    
-    if (extension == ".obj") {
-        loadWithAssimp(m_filepath, device);
-    } else {
-        loadWithAssimp(m_filepath, device);
+void Model::setMaterialUVTransform(size_t materialIndex, const UVTransform& transform) {
+    if (materialIndex < m_materials.size()) {
+        m_materials[materialIndex].uvTransform = transform;
     }
-    
-
-    m_transform = savedTransform;
-    m_name = savedName;
-    
-    std::cout << "UV reprocessing complete for model: " << m_name << std::endl;
 }
 
-void Model::setForceUVFlip(bool flip, VulkanDevice& device) {
-    if (m_forceUVFlip != flip) {
-        m_forceUVFlip = flip;
-        reprocessUVCoordinates(device);
-    }
+UVTransform Model::getMaterialUVTransform(size_t materialIndex) const {
+    UVTransform transform = materialIndex < m_materials.size() ? m_materials[materialIndex].uvTransform : UVTransform();
+    return m_forceUVFlip ? transform.flippedV() : transform;
 }
 
 void Model::autoFixUVsForMaterial(Material& material, VulkanDevice& device) {
-    std::cout << "SIMPLE UV FIX: Applying basic UV mapping for material: " << material.name << std::endl;
-
-    for (size_t meshIndex = 0; meshIndex < m_meshes.size(); meshIndex++) {
-        auto& mesh = m_meshes[meshIndex];
-        if (mesh.materialIndex < m_materials.size() && &m_materials[mesh.materialIndex] == &material) {
-            std::cout << "  Processing mesh " << meshIndex << " with " << mesh.vertices.size() << " vertices" << std::endl;
-            
-            // Simple UV normalization - ensure UVs are in 0-1 range
-            for (auto& vertex : mesh.vertices) {
-                // Clamp UV coordinates to 0-1 range
-                vertex.texCoord.x = std::max(0.0f, std::min(1.0f, vertex.texCoord.x));
-                vertex.texCoord.y = std::max(0.0f, std::min(1.0f, vertex.texCoord.y));
-                
-                // Optional: flip Y coordinate if needed (common for different texture coordinate systems)
-                // vertex.texCoord.y = 1.0f - vertex.texCoord.y;
-            }
-            
-            // Update GPU buffers
-            mesh.cleanup(device);
-            createSingleMeshBuffers(mesh, device);
-            
-            std::cout << "  UV coordinates normalized for mesh " << meshIndex << std::endl;
-        }
+    if (&material < m_materials.data() || &material >= m_materials.data() + m_materials.size()) {
+        return;
     }
+    size_t materialIndex = static_cast<size_t>(&material - m_materials.data());
     
-    std::cout << "Simple UV fix complete for material: " << material.name << std::endl;
-}
-
-std::vector<glm::vec2> Model::generateUVVariant(const Mesh& mesh, int variant) {
-    std::vector<glm::vec2> uvs;
-    uvs.reserve(mesh.vertices.size());
-    
-    std::cout << "      Generating UV variant " << variant << " from " << mesh.vertices.size() << " vertices" << std::endl;
-    
-    for (const auto& vertex : mesh.vertices) {
-        glm::vec2 uv = vertex.texCoord;
-        glm::vec2 originalUV = uv;  
-        
-        switch (variant) {
-            case 0: 
-                break;
-            case 1: 
-                uv.y = 1.0f - uv.y;
-                break;
-            case 2: 
-                uv.x = 1.0f - uv.x;
-                break;
-            case 3: 
-                uv.x = 1.0f - uv.x;
-                uv.y = 1.0f - uv.y;
-                break;
-        }
-        
-
-        if (uvs.empty() && variant > 0) {
-            std::cout << "        First UV: (" << originalUV.x << "," << originalUV.y 
-                      << ") -> (" << uv.x << "," << uv.y << ")" << std::endl;
-        }
-        
-        uvs.push_back(uv);
+    // A shared asset is cloned before its UVs change. The clone has no ranges yet; they are allocated
+    // and filled with the other edits in the next flush, while the old asset keeps drawing until then.
+    if (detachAsset()) {
+        m_detachedUploadPending = true;
     }
     
-    return uvs;
+    // Only the clamped vertices are marked; they go out with every other edit in the next flush
+    clampMaterialUVs(materialIndex);
 }
 
-int Model::detectBestUVVariant(const Mesh& mesh, const std::vector<std::vector<glm::vec2>>& uvVariants) {
-
-    
-    float bestScore = -1.0f;
-    int bestVariant = 0;  
-    
-    std::cout << "    ADVANCED ANALYSIS: Testing " << uvVariants.size() << " UV variants..." << std::endl;
-    
-    for (int v = 0; v < uvVariants.size(); v++) {
-        const auto& uvs = uvVariants[v];
-        
-
-        float coherenceScore = calculateUVCoherence(mesh, uvs);
-        
-
-        float clusterScore = calculateUVClustering(uvs);
-        
-
-        float geometryScore = calculateGeometricConsistency(mesh, uvs);
-        
-
-        float coverageScore = calculateTextureCoverage(uvs);
-        
-
-        float scramblingPenalty = detectUVScrambling(mesh, uvs);
-        
-
-        float score = coherenceScore * 0.4f + clusterScore * 0.2f + 
-                      geometryScore * 0.2f + coverageScore * 0.1f - scramblingPenalty * 0.1f;
-        
-        std::cout << "    Variant " << v << ": coherence=" << coherenceScore 
-                  << " cluster=" << clusterScore << " geometry=" << geometryScore 
-                  << " coverage=" << coverageScore << " scrambling=" << scramblingPenalty
-                  << " TOTAL=" << score << std::endl;
-        
-        if (score > bestScore) {
-            bestScore = score;
-            bestVariant = v;
-        }
+VkDeviceSize Model::flushDirtyVertices(VulkanDevice& device, UploadBatcher& batcher) {
+    GeometryPool* pool = device.getGeometryPool();
+    VkDeviceSize bytes = 0;
+    if (!pool) {
+        return bytes;
     }
     
-    std::cout << "    ADVANCED RESULT: Best variant = " << bestVariant << " (score: " << bestScore << ")" << std::endl;
-    return bestVariant;
-}
-
-float Model::calculateUVCoherence(const Mesh& mesh, const std::vector<glm::vec2>& uvs) {
-    
-    
-    float totalCoherence = 0.0f;
-    int coherentPairs = 0;
-    
-
-    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
-        if (i + 2 < mesh.indices.size()) {
-            uint32_t idx1 = mesh.indices[i];
-            uint32_t idx2 = mesh.indices[i + 1];
-            uint32_t idx3 = mesh.indices[i + 2];
-            
-            if (idx1 < uvs.size() && idx2 < uvs.size() && idx3 < uvs.size()) {
-                glm::vec2 uv1 = uvs[idx1];
-                glm::vec2 uv2 = uvs[idx2];
-                glm::vec2 uv3 = uvs[idx3];
-                
-
-                float dist12 = glm::length(uv2 - uv1);
-                float dist23 = glm::length(uv3 - uv2);
-                float dist31 = glm::length(uv1 - uv3);
-                
-
-                float triangleCoherence = 1.0f / (1.0f + dist12 + dist23 + dist31);
-                totalCoherence += triangleCoherence;
-                coherentPairs++;
+    if (m_detachedUploadPending) {
+        m_detachedUploadPending = false;
+        for (auto& mesh : m_asset->meshes) {
+            createMeshBuffers(mesh, device, batcher);
+            if (mesh.geometry) {
+                bytes += mesh.geometry->vertexBytes + mesh.geometry->indexBytes;
             }
         }
+        return bytes;
     }
     
-    return coherentPairs > 0 ? totalCoherence / coherentPairs : 0.0f;
-}
-
-float Model::calculateUVClustering(const std::vector<glm::vec2>& uvs) {
-
-    
-    const int gridSize = 8;
-    int grid[gridSize][gridSize] = {0};
-    int totalUVs = 0;
-    
-
-    for (const auto& uv : uvs) {
-        if (uv.x >= 0.0f && uv.x <= 1.0f && uv.y >= 0.0f && uv.y <= 1.0f) {
-            int gx = std::min(gridSize-1, (int)(uv.x * gridSize));
-            int gy = std::min(gridSize-1, (int)(uv.y * gridSize));
-            grid[gx][gy]++;
-            totalUVs++;
-        }
+    // The graphics queue must not overtake the import's own copies of the same ranges; a model whose
+    // import is still in flight keeps its dirty ranges for a later frame instead of stalling this one
+    bool dirty = std::any_of(m_asset->meshes.begin(), m_asset->meshes.end(), [](const Mesh& mesh) {
+        return mesh.dirtyBegin < mesh.dirtyEnd && mesh.geometry;
+    });
+    if (!dirty || !device.isUploadComplete(m_uploadTicket)) {
+        return bytes;
     }
     
-    if (totalUVs == 0) return 0.0f;
-    
-   
-    float clusterScore = 0.0f;
-    int activeCells = 0;
-    
-    for (int x = 0; x < gridSize; x++) {
-        for (int y = 0; y < gridSize; y++) {
-            if (grid[x][y] > 0) {
-                activeCells++;
-                
-                float density = (float)grid[x][y] / totalUVs;
-                clusterScore += density * density; 
+    for (auto& mesh : m_asset->meshes) {
+        if (mesh.dirtyBegin >= mesh.dirtyEnd || !mesh.geometry) {
+            continue;
+        }
+        uint32_t begin = mesh.dirtyBegin;
+        uint32_t end = std::min(mesh.dirtyEnd, static_cast<uint32_t>(mesh.vertices.size()));
+        mesh.dirtyBegin = mesh.dirtyEnd = 0;
+        if (begin >= end) {
+            continue;
+        }
+        
+        VkBuffer buffer = pool->getBuffer(mesh.geometry->block);
+        VkDeviceSize offset = mesh.geometry->vertexByteOffset + static_cast<VkDeviceSize>(begin) * mesh.geometry->vertexStride;
+        if (mesh.quantized) {
+            // Positions did not move, so the bounds the mesh was quantized against still hold
+            glm::vec3 inverseScale(0.0f);
+            for (int axis = 0; axis < 3; axis++) {
+                inverseScale[axis] = mesh.quantScale[axis] > 0.0f ? 1.0f / mesh.quantScale[axis] : 0.0f;
+            }
+            std::vector<uint8_t> packed((end - begin) * sizeof(QuantizedVertex));
+            QuantizedVertex* output = reinterpret_cast<QuantizedVertex*>(packed.data());
+            for (uint32_t i = begin; i < end; i++) {
+                output[i - begin] = quantizeVertex(mesh.vertices[i], mesh.quantOffset, inverseScale);
             }
+            bytes += packed.size();
+            batcher.enqueueBufferUpdate(std::move(packed), buffer, offset);
+        } else {
+            VkDeviceSize size = static_cast<VkDeviceSize>(end - begin) * sizeof(Vertex);
+            batcher.enqueueBufferUpdate(&mesh.vertices[begin], size, buffer, offset);
+            bytes += size;
         }
     }
-    
-
-    float scatterPenalty = (float)activeCells / (gridSize * gridSize);
-    return clusterScore - scatterPenalty * 0.5f;
+    return bytes;
 }
 
-float Model::calculateGeometricConsistency(const Mesh& mesh, const std::vector<glm::vec2>& uvs) {
-
-    
-    float totalConsistency = 0.0f;
-    int consistentPairs = 0;
+void Model::clampMaterialUVs(size_t materialIndex) {
+    const Material& material = m_materials[materialIndex];
+    std::cout << "SIMPLE UV FIX: Applying basic UV mapping for material: " << material.name << std::endl;
 
-    for (size_t i = 0; i < mesh.indices.size() && i < 300; i += 3) {
-        if (i + 2 < mesh.indices.size()) {
-            uint32_t idx1 = mesh.indices[i];
-            uint32_t idx2 = mesh.indices[i + 1];
+    for (size_t meshIndex = 0; meshIndex < m_asset->meshes.size(); meshIndex++) {
+        auto& mesh = m_asset->meshes[meshIndex];
+        if (mesh.materialIndex == materialIndex) {
             
-            if (idx1 < mesh.vertices.size() && idx2 < mesh.vertices.size() && 
-                idx1 < uvs.size() && idx2 < uvs.size()) {
-                
-
-                glm::vec3 pos1 = mesh.vertices[idx1].pos;
-                glm::vec3 pos2 = mesh.vertices[idx2].pos;
-                float geoDist = glm::length(pos2 - pos1);
-                
-
-                glm::vec2 uv1 = uvs[idx1];
-                glm::vec2 uv2 = uvs[idx2];
-                float uvDist = glm::length(uv2 - uv1);
-                
-                
-                if (geoDist > 0.001f && uvDist > 0.001f) {
-                    float ratio = std::min(geoDist / uvDist, uvDist / geoDist);
-                    totalConsistency += ratio;
-                    consistentPairs++;
+            // Clamp UV coordinates to 0-1 range, remembering which vertices actually moved
+            uint32_t firstChanged = UINT32_MAX;
+            uint32_t lastChanged = 0;
+            for (size_t i = 0; i < mesh.vertices.size(); i++) {
+                glm::vec2& texCoord = mesh.vertices[i].texCoord;
+                glm::vec2 clamped(std::max(0.0f, std::min(1.0f, texCoord.x)), std::max(0.0f, std::min(1.0f, texCoord.y)));
+                if (clamped != texCoord) {
+                    texCoord = clamped;
+                    firstChanged = std::min(firstChanged, static_cast<uint32_t>(i));
+                    lastChanged = static_cast<uint32_t>(i) + 1;
                 }
             }
+            mesh.markDirty(firstChanged, lastChanged);
+            
+            std::cout << "  UV coordinates normalized for mesh " << meshIndex << " ("
+                      << (firstChanged < lastChanged ? lastChanged - firstChanged : 0) << " of "
+                      << mesh.vertices.size() << " vertices in the dirty range)" << std::endl;
         }
     }
     
-    return consistentPairs > 0 ? totalConsistency / consistentPairs : 0.0f;
-}
-
-float Model::calculateTextureCoverage(const std::vector<glm::vec2>& uvs) {
-
-    
-    const int gridSize = 16;
-    bool grid[gridSize][gridSize] = {false};
-    int validUVs = 0;
-    
-    for (const auto& uv : uvs) {
-        if (uv.x >= 0.0f && uv.x <= 1.0f && uv.y >= 0.0f && uv.y <= 1.0f) {
-            int gx = std::min(gridSize-1, (int)(uv.x * gridSize));
-            int gy = std::min(gridSize-1, (int)(uv.y * gridSize));
-            grid[gx][gy] = true;
-            validUVs++;
-        }
-    }
-    
-
-    int usedCells = 0;
-    for (int x = 0; x < gridSize; x++) {
-        for (int y = 0; y < gridSize; y++) {
-            if (grid[x][y]) usedCells++;
-        }
-    }
-    
-    float coverage = (float)usedCells / (gridSize * gridSize);
-    float validRatio = uvs.empty() ? 0.0f : (float)validUVs / uvs.size();
-    
-    return coverage * validRatio;
+    std::cout << "Simple UV fix complete for material: " << material.name << std::endl;
 }
 
-float Model::detectUVScrambling(const Mesh& mesh, const std::vector<glm::vec2>& uvs) {
-
-    
-    float totalVariance = 0.0f;
-    int varianceSamples = 0;
-    
-    
-    for (size_t i = 0; i < mesh.indices.size() && i < 600; i += 3) { 
-        if (i + 2 < mesh.indices.size()) {
-            uint32_t idx1 = mesh.indices[i];
-            uint32_t idx2 = mesh.indices[i + 1];
-            uint32_t idx3 = mesh.indices[i + 2];
-            
-            if (idx1 < uvs.size() && idx2 < uvs.size() && idx3 < uvs.size()) {
-                glm::vec2 uv1 = uvs[idx1];
-                glm::vec2 uv2 = uvs[idx2];
-                glm::vec2 uv3 = uvs[idx3];
-                
-
-                glm::vec2 center = (uv1 + uv2 + uv3) / 3.0f;
-                float variance = glm::length(uv1 - center) + 
-                                glm::length(uv2 - center) + 
-                                glm::length(uv3 - center);
-                
-                totalVariance += variance;
-                varianceSamples++;
-            }
+UVAnalysis Model::detectBestUVVariant(size_t materialIndex) const {
+    std::vector<const Mesh*> meshes;
+    for (const auto& mesh : m_asset->meshes) {
+        if (mesh.materialIndex == materialIndex) {
+            meshes.push_back(&mesh);
         }
     }
-    
-    float avgVariance = varianceSamples > 0 ? totalVariance / varianceSamples : 0.0f;
-    
-
-    return avgVariance > 0.3f ? avgVariance : 0.0f;
+    UVAnalysis analysis = UVAnalyzer::analyze(meshes);
+    std::cout << "UV analysis of " << analysis.triangles << " triangles in " << analysis.milliseconds
+              << " ms: best variant " << analysis.bestVariant << " (score "
+              << analysis.variants[analysis.bestVariant].total << ")" << std::endl;
+    return analysis;
 }
 
 }
\ No newline at end of file
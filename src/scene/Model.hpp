@@ -3,15 +3,27 @@
 #include <string>
 #include <vector>
 #include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include "../core/UploadBatcher.hpp"
+
 namespace VulkanViewer {
 
 class VulkanDevice;
+class GeometryPool;
+struct GeometryAllocation;
+struct CachedModel;
+struct TextureDecode;
+struct CachedTexture;
+class TextureDirectoryIndex;
+struct UVAnalysis;
 
 struct Vertex {
     glm::vec3 pos;
@@ -22,20 +34,185 @@ struct Vertex {
     static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
 };
 
+// Compact 16-byte GPU layout: positions as 16-bit unorm relative to the mesh bounds,
+// octahedral snorm normals and half-float UVs. Decoded in model_quantized.vert.
+struct QuantizedVertex {
+    uint16_t pos[4];
+    int16_t normal[2];
+    uint16_t texCoord[2];
+    
+    static VkVertexInputBindingDescription getBindingDescription();
+    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions();
+};
+
+// A simplified level that reuses the mesh's vertices. Its indices follow the full-detail
+// ones in the same index range; `error` is the geometric deviation in model units.
+struct MeshLod {
+    uint32_t firstIndex = 0;
+    uint32_t indexCount = 0;
+    float error = 0.0f;
+};
+
+// A run of at most 124 triangles over at most 64 vertices, drawn as one contiguous slice of
+// the full-detail indices. Bounds and normal cone are in model space; the cluster faces away
+// from the camera when dot(center - eye, coneAxis) >= coneCutoff * |center - eye| + radius.
+struct Meshlet {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+    glm::vec3 coneAxis = glm::vec3(0.0f);
+    float coneCutoff = 1.0f;
+    uint32_t firstIndex = 0;
+    uint32_t triangleCount = 0;
+};
+
 struct Mesh {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    
+    // Partition of `indices` in draw order; empty when the mesh was imported without meshlets
+    std::vector<Meshlet> meshlets;
+    
+    // Coarser levels, finest first; lodIndices holds their indices back to back
+    std::vector<uint32_t> lodIndices;
+    std::vector<MeshLod> lods;
     std::string materialName;
     uint32_t materialIndex = 0;
     
-    VkBuffer vertexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory vertexBufferMemory = VK_NULL_HANDLE;
-    VkBuffer indexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory indexBufferMemory = VK_NULL_HANDLE;
+    // Vertex count as imported, before welding
+    size_t sourceVertexCount = 0;
+    
+    GeometryAllocation* geometry = nullptr;
     
+    // Set when the GPU copy uses QuantizedVertex; position = quantOffset + unorm * quantScale
+    bool quantized = false;
+    glm::vec3 quantOffset = glm::vec3(0.0f);
+    glm::vec3 quantScale = glm::vec3(1.0f);
+    
+    // Vertices edited on the CPU since the last upload, [dirtyBegin, dirtyEnd). Edits from several
+    // materials merge into one range, which Model::flushDirtyVertices writes into the existing allocation.
+    uint32_t dirtyBegin = 0;
+    uint32_t dirtyEnd = 0;
+    
+    void markDirty(uint32_t begin, uint32_t end);
     void cleanup(VulkanDevice& device);
 };
 
+// One node's use of a mesh. Geometry stays in mesh space and is shared by every instance;
+// the transform places it relative to the model.
+struct MeshInstance {
+    uint32_t meshIndex = 0;
+    glm::mat4 transform = glm::mat4(1.0f);
+};
+
+struct ImportTimings {
+    double readMs = 0.0;
+    double materialsMs = 0.0;
+    double flattenMs = 0.0;
+    double convertMs = 0.0;
+    double weldMs = 0.0;
+    double optimizeMs = 0.0;
+    double meshletMs = 0.0;
+    double lodMs = 0.0;
+    double uploadMs = 0.0;
+    double textureDecodeMs = 0.0;
+    double textureUploadMs = 0.0;
+    double texturesMs = 0.0;
+    double totalMs = 0.0;
+    uint64_t textureBytes = 0;
+    uint32_t texturePathLookups = 0;
+    uint32_t texturePathProbesAvoided = 0;
+};
+
+// Settings that change the imported geometry; hash() is part of the mesh cache key
+struct ImportOptions {
+    bool useMeshCache = true;
+    
+    // Merge duplicate vertices after import; an epsilon of 0 only merges bit-identical ones
+    bool weldVertices = true;
+    float weldEpsilon = 0.0f;
+    
+    // Upload meshes with fewer than 65536 vertices with 16-bit indices
+    bool compactIndices = true;
+    
+    // Reorder indices and vertices for the post-transform cache, overdraw and vertex fetch
+    bool optimizeMeshes = true;
+    
+    // Regroup the full-detail triangles into meshlets for per-cluster culling
+    bool buildMeshlets = true;
+    
+    // Build up to MAX_LOD_LEVELS simplified levels per mesh for distance-based selection
+    bool generateLods = true;
+    
+    // Upload QuantizedVertex instead of Vertex; the CPU copy keeps full precision
+    bool quantizeVertices = false;
+    
+    // Build texture mip chains on the decode threads, for upload queues that cannot blit.
+    // Only affects textures, so it is not part of the mesh cache key.
+    bool mipmapsOnCPU = false;
+    
+    uint64_t hash() const;
+};
+
+// Shared between a background import and whoever watches it. The importer publishes the stage
+// name and a 0..1 fraction, and gives up at its next check once cancel is set.
+struct ImportProgress {
+    std::atomic<const char*> stage{"Queued"};
+    std::atomic<float> fraction{0.0f};
+    std::atomic<bool> cancel{false};
+};
+
+// Whole-model post-transform cache figures around the optimization stage (FIFO cache of 16)
+struct VertexCacheReport {
+    float acmrBefore = 0.0f;
+    float acmrAfter = 0.0f;
+    float atvrBefore = 0.0f;
+    float atvrAfter = 0.0f;
+};
+
+// Geometry of one import, shared by the asset browser entry and every scene copy made from it.
+// Treat it as immutable once uploaded: a Model that edits its geometry first detaches a private clone.
+// The GPU ranges go back to the geometry pool when the last Model lets go of the asset.
+struct MeshAsset {
+    std::vector<Mesh> meshes;
+    std::vector<MeshInstance> instances;
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    VertexCacheReport vertexCacheReport;
+    
+    // Set by the first upload; the pool is looked up through it on release
+    VulkanDevice* device = nullptr;
+    
+    MeshAsset() = default;
+    ~MeshAsset();
+    MeshAsset(const MeshAsset&) = delete;
+    MeshAsset& operator=(const MeshAsset&) = delete;
+    
+    // CPU copy without GPU geometry
+    std::shared_ptr<MeshAsset> clone() const;
+};
+
+// Texture coordinate transform applied in the vertex shader, so changing it never rewrites vertex data:
+// uv' = (swap ? uv.yx : uv) * scale + offset
+struct UVTransform {
+    glm::vec2 scale = glm::vec2(1.0f);
+    glm::vec2 offset = glm::vec2(0.0f);
+    bool swap = false;
+    
+    // The same transform followed by a mirror, u' = 1 - u or v' = 1 - v
+    UVTransform flippedU() const {
+        UVTransform result = *this;
+        result.scale.x = -scale.x;
+        result.offset.x = 1.0f - offset.x;
+        return result;
+    }
+    UVTransform flippedV() const {
+        UVTransform result = *this;
+        result.scale.y = -scale.y;
+        result.offset.y = 1.0f - offset.y;
+        return result;
+    }
+};
+
 struct Material {
     std::string name;
     glm::vec3 ambient = glm::vec3(0.1f);
@@ -45,12 +222,19 @@ struct Material {
     std::string diffuseTexture;
     std::string normalTexture;
     std::string specularTexture;
+    UVTransform uvTransform;
     
+    // Shared diffuse image from the device's TextureCache; the model holds one reference
+    CachedTexture* texture = nullptr;
+};
 
-    VkImage textureImage = VK_NULL_HANDLE;
-    VkDeviceMemory textureImageMemory = VK_NULL_HANDLE;
-    VkImageView textureImageView = VK_NULL_HANDLE;
-    VkSampler textureSampler = VK_NULL_HANDLE;
+// RGBA8 pixels decoded on the CPU and waiting for upload
+struct DecodedTexture {
+    // RGBA8, `mipLevels` levels packed one after another starting at full size
+    std::vector<uint8_t> pixels;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 1;
 };
 
 class Model {
@@ -58,9 +242,22 @@ public:
     Model();
     ~Model();
     
-    bool loadFromFile(const std::string& filepath, VulkanDevice& device);
+    bool loadFromFile(const std::string& filepath, VulkanDevice& device, const ImportOptions& options = ImportOptions());
+    
+    // CPU half of loadFromFile: parsing, mesh processing and texture decoding, with no GPU access,
+    // so it can run on a worker thread. Returns false on failure or once progress->cancel is set.
+    bool importFromFile(const std::string& filepath, const ImportOptions& options = ImportOptions(),
+                        ImportProgress* progress = nullptr);
+    // GPU half: uploads whole meshes, then textures, until about byteBudget bytes went out in this call.
+    // Returns true once everything is resident; call it on the render thread between frames.
+    bool uploadPending(VulkanDevice& device, VkDeviceSize byteBudget = VK_WHOLE_SIZE);
+    // Runs generated geometry through the same post-import stages as a file, with one default material
+    bool loadFromMeshes(const std::string& name, std::vector<Mesh> meshes, VulkanDevice& device,
+                        const ImportOptions& options = ImportOptions());
     bool copyFrom(const Model& other, VulkanDevice& device);
-    void render(VkCommandBuffer commandBuffer);
+    // beforeDraw runs ahead of each instance's draw so the caller can pick the pipeline and push constants
+    void render(VkCommandBuffer commandBuffer, const GeometryPool& pool,
+                const std::function<void(const Mesh&, const glm::mat4&)>& beforeDraw = nullptr) const;
     void cleanup(VulkanDevice& device);
     
     glm::mat4 getTransform() const { return m_transform; }
@@ -69,7 +266,20 @@ public:
     const std::string& getName() const { return m_name; }
     void setName(const std::string& name) { m_name = name; }
     
-    const std::vector<Mesh>& getMeshes() const { return m_meshes; }
+    static constexpr size_t MAX_LOD_LEVELS = 4;
+    
+    const std::vector<Mesh>& getMeshes() const { return m_asset->meshes; }
+    const std::vector<MeshInstance>& getInstances() const { return m_asset->instances; }
+    const glm::vec3& getBoundsMin() const { return m_asset->boundsMin; }
+    const glm::vec3& getBoundsMax() const { return m_asset->boundsMax; }
+    // Number of models drawing this model's geometry, itself included
+    long getAssetShareCount() const { return m_asset.use_count(); }
+    const ImportOptions& getImportOptions() const { return m_importOptions; }
+    const ImportTimings& getImportTimings() const { return m_importTimings; }
+    const UploadStats& getUploadStats() const { return m_uploadStats; }
+    // Covers the geometry and textures this model draws; it must not be drawn before this completes
+    UploadTicket getUploadTicket() const { return m_uploadTicket; }
+    const VertexCacheReport& getVertexCacheReport() const { return m_asset->vertexCacheReport; }
     const std::vector<Material>& getMaterials() const { return m_materials; }
     std::vector<Material>& getMaterials() { return m_materials; }
     
@@ -81,34 +291,66 @@ public:
     VkSampler getMaterialTextureSampler(size_t materialIndex) const;
     
 
-    void reprocessUVCoordinates(VulkanDevice& device);
+    // Re-uploads every mesh in the requested layout; the GPU must not be using the old geometry
+    bool getQuantizeVertices() const { return m_importOptions.quantizeVertices; }
+    void setQuantizeVertices(bool quantize, VulkanDevice& device);
     
 
+    // Both only change what the renderer pushes per draw; vertex data and textures stay as they are
     bool getForceUVFlip() const { return m_forceUVFlip; }
-    void setForceUVFlip(bool flip, VulkanDevice& device);
+    void setForceUVFlip(bool flip) { m_forceUVFlip = flip; }
+    void setMaterialUVTransform(size_t materialIndex, const UVTransform& transform);
+    
+    // The material's transform with the model-wide flip applied
+    UVTransform getMaterialUVTransform(size_t materialIndex) const;
     
 
     void autoFixUVsForMaterial(Material& material, VulkanDevice& device);
-    std::vector<glm::vec2> generateUVVariant(const Mesh& mesh, int variant);
-    int detectBestUVVariant(const Mesh& mesh, const std::vector<std::vector<glm::vec2>>& uvVariants);
     
-
-    float calculateUVCoherence(const Mesh& mesh, const std::vector<glm::vec2>& uvs);
-    float calculateUVClustering(const std::vector<glm::vec2>& uvs);
-    float calculateGeometricConsistency(const Mesh& mesh, const std::vector<glm::vec2>& uvs);
-    float calculateTextureCoverage(const std::vector<glm::vec2>& uvs);
-    float detectUVScrambling(const Mesh& mesh, const std::vector<glm::vec2>& uvs);
+    // Queues the dirty vertex ranges of every mesh into `batcher` and clears them. Meshes without
+    // GPU geometry are skipped; their next full upload picks the edits up. A clone detached by a UV
+    // fix gets its ranges and its whole upload here. Ranges the import may still be copying into
+    // stay dirty until its ticket completes.
+    VkDeviceSize flushDirtyVertices(VulkanDevice& device, UploadBatcher& batcher);
+    
+    // Scores the flip variants of every mesh that uses the material, over all of their triangles
+    UVAnalysis detectBestUVVariant(size_t materialIndex) const;
 
 private:
-    bool loadOBJ(const std::string& filepath, VulkanDevice& device);
-    bool loadWithAssimp(const std::string& filepath, VulkanDevice& device);
-    void processNode(aiNode* node, const aiScene* scene, VulkanDevice& device);
-    Mesh processMesh(aiMesh* mesh, const aiScene* scene, VulkanDevice& device);
+    bool loadFromCache(const std::string& filepath);
+    bool loadOBJ(const std::string& filepath);
+    bool loadWithAssimp(const std::string& filepath);
+    bool processNodes(const aiScene* scene);
+    bool processImportedMeshes();
+    bool reportProgress(const char* stage, float fraction);
+    bool isCancelled() const { return m_progress && m_progress->cancel; }
+    void collectMeshNodes(const aiNode* node, const aiMatrix4x4& parentTransform,
+                          std::vector<std::pair<unsigned int, aiMatrix4x4>>& workList) const;
+    Mesh processMesh(const aiMesh* mesh) const;
+    void instanceEachMeshOnce();
     void subdivideMesh(Mesh& mesh, int subdivisionLevels = 2);
     void loadMaterialTextures(aiMaterial* mat, aiTextureType type, const std::string& typeName, Material& material);
+    std::string resolveTexturePath(const std::string& textureFilename);
     bool analyzeUVPattern(aiMesh* mesh);  
     void createBuffers(VulkanDevice& device);
-    void createSingleMeshBuffers(Mesh& mesh, VulkanDevice& device);
+    // Swaps a shared asset for a private clone; true when the clone still needs buffers
+    bool detachAsset();
+    void createMeshBuffers(Mesh& mesh, VulkanDevice& device, UploadBatcher& batcher,
+                           const void* vertexSource = nullptr, const void* indexSource = nullptr);
+    void weldMeshes();
+    void optimizeMeshes();
+    void buildMeshlets();
+    void generateLods();
+    void computeBounds();
+    bool loadTextureToGPU(Material& material, const std::string& filepath, VulkanDevice& device, bool fixUVs);
+    void startTextureDecode();
+    void finishTextureDecode(bool fixUVs);
+    static bool decodeTexture(const std::string& filepath, DecodedTexture& texture);
+    bool uploadTexture(Material& material, const std::string& filepath, DecodedTexture& texture, VulkanDevice& device);
+    bool createTextureImage(Material& material, const std::string& filepath, DecodedTexture& texture,
+                            VulkanDevice& device, UploadBatcher& batcher);
+    void releaseTexture(Material& material, VulkanDevice& device);
+    void clampMaterialUVs(size_t materialIndex);
     void createTexture(const std::string& texturePath, VulkanDevice& device, Material& material);
     void splitMeshByMaterials(const aiScene* scene, VulkanDevice& device); 
     
@@ -118,8 +360,27 @@ private:
     glm::mat4 m_transform = glm::mat4(1.0f);
     bool m_forceUVFlip = false;
     
-    std::vector<Mesh> m_meshes;
+    ImportOptions m_importOptions;
+    
+    // Never null; copies of this model point at the same asset
+    std::shared_ptr<MeshAsset> m_asset = std::make_shared<MeshAsset>();
     std::vector<Material> m_materials;
+    
+    ImportTimings m_importTimings;
+    UploadStats m_uploadStats;
+    UploadTicket m_uploadTicket = 0;
+    // Set when a UV fix detached the asset; flushDirtyVertices uploads the clone with the frame's edits
+    bool m_detachedUploadPending = false;
+    
+    // Import state between importFromFile and the last uploadPending call
+    ImportProgress* m_progress = nullptr;
+    bool m_uploadPending = false;
+    size_t m_uploadedMeshes = 0;
+    size_t m_uploadedTextures = 0;
+    std::vector<DecodedTexture> m_decodedTextures;
+    std::unique_ptr<TextureDecode> m_textureDecode;
+    std::unique_ptr<CachedModel> m_cacheSource;
+    std::shared_ptr<const TextureDirectoryIndex> m_textureIndex;
 };
 
 }
\ No newline at end of file
@@ -67,13 +67,17 @@ void Scene::addModel(std::unique_ptr<Model> model) {
     m_models.push_back(std::move(model));
 }
 
-void Scene::removeModel(int index) {
+void Scene::removeModel(int index, VulkanDevice& device) {
     if (index >= 0 && index < static_cast<int>(m_models.size())) {
+        m_models[index]->cleanup(device);
         m_models.erase(m_models.begin() + index);
     }
 }
 
-void Scene::clearModels() {
+void Scene::clearModels(VulkanDevice& device) {
+    for (auto& model : m_models) {
+        model->cleanup(device);
+    }
     m_models.clear();
 }
 
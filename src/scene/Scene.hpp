@@ -9,6 +9,7 @@ namespace VulkanViewer {
 class Model;
 class Camera;
 class Light;
+class VulkanDevice;
 
 class Scene {
 public:
@@ -19,8 +20,9 @@ public:
     
     void loadModel(const std::string& filepath);
     void addModel(std::unique_ptr<Model> model);
-    void removeModel(int index);
-    void clearModels();
+    // Removed models release their geometry and texture references; the device has to be idle
+    void removeModel(int index, VulkanDevice& device);
+    void clearModels(VulkanDevice& device);
     
     Camera& getCamera() { return *m_camera; }
     const Camera& getCamera() const { return *m_camera; }
@@ -2,6 +2,13 @@
 #include "../core/VulkanDevice.hpp"
 #include "../rendering/Renderer.hpp"
 #include "../rendering/ThumbnailRenderer.hpp"
+#include "../rendering/GeometryPool.hpp"
+#include "../rendering/TextureCache.hpp"
+#include "../rendering/PipelineLibrary.hpp"
+#include "../assets/MeshCache.hpp"
+#include "../assets/ObjParser.hpp"
+#include "../assets/TexturePathResolver.hpp"
+#include "../assets/UVAnalyzer.hpp"
 #include "../scene/Scene.hpp"
 #include "../scene/Camera.hpp"
 #include "../scene/Model.hpp"
@@ -15,6 +22,8 @@
 
 #include <stdexcept>
 #include <array>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <filesystem>
 #include <windows.h>
@@ -25,8 +34,77 @@
 
 namespace VulkanViewer {
 
+namespace {
+
+// A bumpy sphere split into patches, standing in for a dense scan when benchmarking culling
+std::vector<Mesh> makeDenseScanMeshes(uint32_t rings, uint32_t segments, uint32_t patchesPerSide) {
+    const float pi = 3.14159265358979f;
+    auto surface = [pi](float u, float v) {
+        float theta = u * pi;
+        float phi = v * 2.0f * pi;
+        float radius = 1.0f + 0.04f * std::sin(9.0f * theta) * std::sin(13.0f * phi) +
+                       0.01f * std::sin(47.0f * theta + 3.0f * phi) * std::cos(61.0f * phi);
+        return radius * glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+    };
+    
+    std::vector<Mesh> meshes;
+    uint32_t patchRings = rings / patchesPerSide;
+    uint32_t patchSegments = segments / patchesPerSide;
+    for (uint32_t patchRow = 0; patchRow < patchesPerSide; patchRow++) {
+        for (uint32_t patchColumn = 0; patchColumn < patchesPerSide; patchColumn++) {
+            Mesh mesh;
+            mesh.vertices.reserve(static_cast<size_t>(patchRings + 1) * (patchSegments + 1));
+            for (uint32_t r = 0; r <= patchRings; r++) {
+                for (uint32_t s = 0; s <= patchSegments; s++) {
+                    float u = static_cast<float>(patchRow * patchRings + r) / rings;
+                    float v = static_cast<float>(patchColumn * patchSegments + s) / segments;
+                    
+                    // Central differences, clamped away from the poles where the parameterization collapses
+                    const float e = 0.25f / segments;
+                    float uc = glm::clamp(u, e, 1.0f - e);
+                    glm::vec3 normal = glm::cross(surface(uc, v + e) - surface(uc, v - e), surface(uc + e, v) - surface(uc - e, v));
+                    float length = glm::length(normal);
+                    
+                    Vertex vertex;
+                    vertex.pos = surface(u, v);
+                    vertex.normal = length > 0.0f ? normal / length : glm::vec3(0.0f, u < 0.5f ? 1.0f : -1.0f, 0.0f);
+                    vertex.texCoord = glm::vec2(v, u);
+                    mesh.vertices.push_back(vertex);
+                }
+            }
+            
+            mesh.indices.reserve(static_cast<size_t>(patchRings) * patchSegments * 6);
+            for (uint32_t r = 0; r < patchRings; r++) {
+                for (uint32_t s = 0; s < patchSegments; s++) {
+                    uint32_t a = r * (patchSegments + 1) + s;
+                    uint32_t b = a + 1;
+                    uint32_t c = a + patchSegments + 1;
+                    uint32_t d = c + 1;
+                    mesh.indices.insert(mesh.indices.end(), {a, b, c, b, d, c});
+                }
+            }
+            meshes.push_back(std::move(mesh));
+        }
+    }
+    return meshes;
+}
+
+const char* meshletCullingName(MeshletCulling culling) {
+    switch (culling) {
+    case MeshletCulling::Off:
+        return "Off";
+    case MeshletCulling::Frustum:
+        return "Frustum";
+    case MeshletCulling::FrustumAndCone:
+        return "Frustum + Cone";
+    }
+    return "";
+}
+
+}
+
 UI::UI(VulkanDevice& device, GLFWwindow* window, Renderer& renderer) 
-    : m_device(device), m_window(window), m_renderer(renderer) {
+    : m_device(device), m_window(window), m_renderer(renderer), m_importJobs(device) {
     initImGui();
 }
 
@@ -52,6 +130,13 @@ void UI::render(Scene& scene) {
     renderAssetBrowser(scene);
     renderSceneViewport(scene);
     
+    if (m_quantizationBenchmark.active) {
+        updateQuantizationBenchmark(scene);
+    }
+    if (m_meshletBenchmark.active) {
+        updateMeshletBenchmark();
+    }
+    
     ImGui::Render();
     ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_renderer.getCurrentCommandBuffer());
 }
@@ -135,7 +220,9 @@ void UI::renderMainMenuBar(Scene& scene) {
                 std::cout << "Drag & drop model files (OBJ, FBX, GLTF, DAE, BLEND, STL, etc.) into the window" << std::endl;
             }
             if (ImGui::MenuItem("Clear Scene")) {
-                scene.clearModels();
+                // Models that held the last reference to an asset or texture free it
+                m_device.waitIdle();
+                scene.clearModels(m_device);
             }
             ImGui::Separator();
             if (ImGui::MenuItem("Exit")) {
@@ -144,6 +231,32 @@ void UI::renderMainMenuBar(Scene& scene) {
             ImGui::EndMenu();
         }
         
+        if (ImGui::BeginMenu("Tools")) {
+            if (ImGui::MenuItem("Benchmark OBJ Parser...")) {
+                std::string filepath = openFileDialog();
+                if (!filepath.empty()) {
+                    ObjParser::benchmark(filepath);
+                }
+            }
+            if (ImGui::MenuItem("Benchmark Vertex Quantization", nullptr, false,
+                                m_renderer.supportsQuantizedVertices() && m_renderer.hasGpuTimestamps() &&
+                                !m_quantizationBenchmark.active)) {
+                startQuantizationBenchmark(scene);
+            }
+            ImGui::Separator();
+            if (ImGui::MenuItem("Add Dense Scan Test Model")) {
+                auto model = std::make_unique<Model>();
+                if (model->loadFromMeshes("DenseScan", makeDenseScanMeshes(1024, 2048, 4), m_device)) {
+                    scene.addModel(std::move(model));
+                }
+            }
+            if (ImGui::MenuItem("Benchmark Meshlet Culling", nullptr, false,
+                                m_renderer.hasGpuTimestamps() && !m_meshletBenchmark.active)) {
+                startMeshletBenchmark(scene);
+            }
+            ImGui::EndMenu();
+        }
+        
         ImGui::EndMainMenuBar();
     }
 }
@@ -170,9 +283,7 @@ void UI::renderSceneHierarchy(Scene& scene) {
             size_t sourceIndex = *(const size_t*)payload->Data;
             
             if (sourceIndex < m_loadedModels.size()) {
-                // Wait for any pending rendering to complete before modifying descriptor sets
-                m_device.waitIdle();
-                
+                // The copy only references the source's geometry and textures, nothing on the GPU changes
                 auto newModel = std::make_unique<Model>();
                 if (newModel->copyFrom(*m_loadedModels[sourceIndex], m_device)) {
                     newModel->setTransform(glm::mat4(1.0f));
@@ -224,7 +335,8 @@ void UI::renderSceneHierarchy(Scene& scene) {
                 if (ImGui::IsItemHovered()) {
                     ImGui::BeginTooltip();
                     ImGui::Text("Model: %s", modelName.c_str());
-                    ImGui::Text("Meshes: %zu", models[i]->getMeshes().size());
+                    ImGui::Text("Meshes: %zu unique, %zu instances", models[i]->getMeshes().size(),
+                                models[i]->getInstances().size());
                     ImGui::EndTooltip();
                 }
             }
@@ -243,9 +355,6 @@ void UI::renderSceneHierarchy(Scene& scene) {
                 size_t sourceIndex = *(const size_t*)payload->Data;
                 
                 if (sourceIndex < m_loadedModels.size()) {
-                    // Wait for any pending rendering to complete before modifying descriptor sets
-                    m_device.waitIdle();
-                    
                     auto newModel = std::make_unique<Model>();
                     if (newModel->copyFrom(*m_loadedModels[sourceIndex], m_device)) {
                         newModel->setTransform(glm::mat4(1.0f));
@@ -273,14 +382,94 @@ void UI::renderStatistics() {
     
 
     ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x - 280, 30), ImGuiCond_Always);
-    ImGui::SetNextWindowSize(ImVec2(270, 120), ImGuiCond_Always);
+    ImGui::SetNextWindowSize(ImVec2(270, 275), ImGuiCond_Always);
     
     ImGui::Begin("Statistics", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse);
     
     ImGui::Text("FPS: %.1f", io.Framerate);
     ImGui::Text("Frame Time: %.3f ms", 1000.0f / io.Framerate);
-    ImGui::Text("Triangles: %d", m_triangleCount);
-    ImGui::Text("Draw Calls: %d", m_drawCalls);
+    
+    const RenderStats& renderStats = m_renderer.getRenderStats();
+    ImGui::Text("Triangles: %llu / %llu", (unsigned long long)renderStats.submittedTriangles,
+                (unsigned long long)renderStats.fullDetailTriangles);
+    if (renderStats.fullDetailTriangles > 0) {
+        ImGui::Text("LOD Reduction: %.1f%%",
+                    100.0 * (1.0 - (double)renderStats.submittedTriangles / renderStats.fullDetailTriangles));
+    }
+    ImGui::Text("Draw Calls: %u", renderStats.drawCalls);
+    if (renderStats.streamingModels > 0) {
+        ImGui::Text("Streaming: %u models waiting for uploads", renderStats.streamingModels);
+    }
+    ImGui::Text("Meshlets Culled: %llu / %llu (%llu tris)", (unsigned long long)renderStats.meshletsCulled,
+                (unsigned long long)renderStats.meshletsTested, (unsigned long long)renderStats.culledTriangles);
+    if (!m_meshletBenchmark.active) {
+        MeshletCulling culling = m_renderer.getMeshletCulling();
+        if (ImGui::BeginCombo("Culling", meshletCullingName(culling))) {
+            for (MeshletCulling option : {MeshletCulling::Off, MeshletCulling::Frustum, MeshletCulling::FrustumAndCone}) {
+                if (ImGui::Selectable(meshletCullingName(option), option == culling)) {
+                    m_renderer.setMeshletCulling(option);
+                }
+            }
+            ImGui::EndCombo();
+        }
+    }
+    float lodErrorPixels = m_renderer.getLodErrorPixels();
+    if (ImGui::SliderFloat("LOD Error (px)", &lodErrorPixels, 0.0f, 8.0f, "%.1f")) {
+        m_renderer.setLodErrorPixels(lodErrorPixels);
+    }
+    
+    GeometryPoolStats poolStats = m_renderer.getGeometryPool().getStats();
+    ImGui::Text("Geometry: %.1f / %.1f MB", poolStats.usedBytes / (1024.0f * 1024.0f), poolStats.capacityBytes / (1024.0f * 1024.0f));
+    ImGui::Text("Blocks: %u, Meshes: %u", poolStats.blockCount, poolStats.allocationCount);
+    MeshCacheStats cacheStats = MeshCache::get().getStats();
+    ImGui::Text("Mesh Cache: %llu hits, %llu misses", (unsigned long long)cacheStats.hits, (unsigned long long)cacheStats.misses);
+    TexturePathResolverStats pathStats = TexturePathResolver::get().getStats();
+    ImGui::Text("Texture Paths: %llu lookups, %llu probes avoided", (unsigned long long)pathStats.lookups,
+                (unsigned long long)pathStats.probesAvoided);
+    TextureCacheStats textureStats = m_renderer.getTextureCache().getStats();
+    ImGui::Text("Textures: %u, %.1f MB, %u samplers", textureStats.textureCount,
+                textureStats.residentBytes / (1024.0f * 1024.0f), textureStats.samplerCount);
+    ImGui::Text("Texture Cache: %.0f%% hit rate (%llu lookups)", textureStats.getHitRate() * 100.0f,
+                (unsigned long long)textureStats.lookups);
+    DeviceMemoryStats memoryStats = m_device.getMemoryStats();
+    ImGui::Text("Device Memory: %.1f / %.1f MB in %u allocations (%u dedicated, limit %u)",
+                memoryStats.usedBytes / (1024.0f * 1024.0f), memoryStats.blockBytes / (1024.0f * 1024.0f),
+                memoryStats.deviceAllocations, memoryStats.dedicatedAllocations, memoryStats.maxDeviceAllocations);
+    for (size_t i = 0; i < memoryStats.categories.size(); i++) {
+        const MemoryCategoryStats& category = memoryStats.categories[i];
+        ImGui::Text("  %s: %u, %.1f MB", getMemoryCategoryName(static_cast<MemoryCategory>(i)),
+                    category.allocations, category.bytes / (1024.0f * 1024.0f));
+    }
+
+    StagingRingStats stagingStats = m_device.getStagingStats();
+    double now = ImGui::GetTime();
+    if (now - m_stagingSampleTime >= 1.0) {
+        m_stagingThroughput = static_cast<float>((stagingStats.stagedBytes - m_stagingSampleBytes) / (now - m_stagingSampleTime));
+        m_stagingSampleBytes = stagingStats.stagedBytes;
+        m_stagingSampleTime = now;
+    }
+    ImGui::Text("Staging Ring: %.1f / %.1f MB in flight (peak %.1f), %.1f MB/s",
+                stagingStats.inFlightBytes / (1024.0f * 1024.0f), stagingStats.capacity / (1024.0f * 1024.0f),
+                stagingStats.peakInFlightBytes / (1024.0f * 1024.0f), m_stagingThroughput / (1024.0f * 1024.0f));
+    ImGui::Text("  %llu submissions, %llu wraps, %llu stalls (%.1f ms)",
+                (unsigned long long)stagingStats.submissions, (unsigned long long)stagingStats.wraps,
+                (unsigned long long)stagingStats.stalls, stagingStats.stallMilliseconds);
+    PipelineLibraryStats pipelineStats = m_renderer.getPipelineLibrary().getStats();
+    ImGui::Text("Pipelines: %u built in %.1f ms, %u shader modules (%s cache, %.1f KB loaded)",
+                pipelineStats.pipelines, pipelineStats.buildMilliseconds, pipelineStats.shaderModules,
+                pipelineStats.warmCache ? "warm" : "cold", pipelineStats.cacheBytesLoaded / 1024.0f);
+    int lightCount = static_cast<int>(m_renderer.getLightCount());
+    if (ImGui::SliderInt("Lights", &lightCount, 0, static_cast<int>(MAX_MODEL_LIGHTS))) {
+        m_renderer.setLightCount(static_cast<uint32_t>(lightCount));
+    }
+    ImGui::Text("Model Variants: %zu built", m_renderer.getModelVariantCount());
+    for (const VariantGpuTime& variant : m_renderer.getVariantGpuTimes()) {
+        ImGui::Text("  %s: %.3f ms GPU, %u draws", describeModelVariant(variant.key).c_str(),
+                    variant.milliseconds, variant.drawCalls);
+    }
+    if (ImGui::SmallButton("Compact Geometry")) {
+        m_pendingCompaction = true;
+    }
     
     ImGui::End();
 }
@@ -297,12 +486,18 @@ void UI::renderAssetBrowser(Scene& scene) {
     ImGui::Begin("Asset Browser", nullptr, ImGuiWindowFlags_NoResize | ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoCollapse);
     
 
-    ImGui::SetCursorPosX(ImGui::GetWindowWidth() - 120.0f);
+    ImGui::SetCursorPosX(ImGui::GetWindowWidth() - 200.0f);
+    if (ImGui::Button("Options", ImVec2(70, 30))) {
+        ImGui::OpenPopup("Import Options");
+    }
+    renderImportOptions();
+    ImGui::SameLine();
     if (ImGui::Button("Import Model", ImVec2(110, 30))) {
         loadModelToAssetBrowser();
     }
     
     ImGui::Separator();
+    renderImportJobs();
     
 
     ImGui::BeginChild("AssetList", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
@@ -389,7 +584,8 @@ void UI::renderAssetBrowser(Scene& scene) {
             if (ImGui::IsItemHovered() || ImGui::IsItemHovered()) {
                 ImGui::BeginTooltip();
                 ImGui::Text("Model: %s", modelName.c_str());
-                ImGui::Text("Meshes: %zu", m_loadedModels[i]->getMeshes().size());
+                ImGui::Text("Meshes: %zu unique, %zu instances", m_loadedModels[i]->getMeshes().size(),
+                            m_loadedModels[i]->getInstances().size());
                 ImGui::Text("Materials: %zu", m_loadedModels[i]->getMaterials().size());
                 ImGui::EndTooltip();
             }
@@ -435,7 +631,7 @@ void UI::openFileDialog(Scene& scene) {
     if (!filepath.empty()) {
 
         auto model = std::make_unique<Model>();
-        if (model->loadFromFile(filepath, m_device)) {
+        if (model->loadFromFile(filepath, m_device, m_importOptions)) {
 
             model->setTransform(glm::mat4(1.0f)); 
             scene.addModel(std::move(model));
@@ -449,14 +645,7 @@ void UI::openFileDialog(Scene& scene) {
 void UI::loadModelToAssetBrowser() {
     std::string filepath = openFileDialog();
     if (!filepath.empty()) {
-
-        auto model = std::make_unique<Model>();
-        if (model->loadFromFile(filepath, m_device)) {
-            m_loadedModels.push_back(std::move(model));
-            std::cout << "Successfully loaded model to asset browser: " << filepath << std::endl;
-        } else {
-            std::cerr << "Failed to load model: " << filepath << std::endl;
-        }
+        importModel(filepath);
     }
 }
 
@@ -464,6 +653,51 @@ void UI::addLoadedModel(std::unique_ptr<Model> model) {
     m_loadedModels.push_back(std::move(model));
 }
 
+void UI::importModel(const std::string& filepath) {
+    m_importJobs.submit(filepath, m_importOptions);
+}
+
+void UI::renderImportOptions() {
+    if (!ImGui::BeginPopup("Import Options")) {
+        return;
+    }
+    
+    // Only affects imports started after the change; loaded models keep the options they were built with
+    ImGui::Checkbox("Weld Vertices", &m_importOptions.weldVertices);
+    ImGui::Checkbox("Optimize Meshes", &m_importOptions.optimizeMeshes);
+    ImGui::Checkbox("Build Meshlets", &m_importOptions.buildMeshlets);
+    ImGui::Checkbox("Generate LODs", &m_importOptions.generateLods);
+    ImGui::Checkbox("Compact Indices", &m_importOptions.compactIndices);
+    if (m_renderer.supportsQuantizedVertices()) {
+        ImGui::Checkbox("Quantize Vertices", &m_importOptions.quantizeVertices);
+    }
+    ImGui::Checkbox("Use Mesh Cache", &m_importOptions.useMeshCache);
+    ImGui::EndPopup();
+}
+
+void UI::renderImportJobs() {
+    const auto& jobs = m_importJobs.getJobs();
+    if (jobs.empty()) {
+        return;
+    }
+    
+    for (const auto& job : jobs) {
+        ImGui::PushID(job.get());
+        ImGui::Text("%s", job->name.c_str());
+        ImGui::SameLine();
+        ImGui::ProgressBar(job->progress.fraction.load(), ImVec2(ImGui::GetContentRegionAvail().x - 70.0f, 0.0f),
+                           job->progress.stage.load());
+        ImGui::SameLine();
+        if (job->progress.cancel) {
+            ImGui::TextDisabled("Cancelling");
+        } else if (ImGui::SmallButton("Cancel")) {
+            m_importJobs.cancel(*job);
+        }
+        ImGui::PopID();
+    }
+    ImGui::Separator();
+}
+
 void UI::renderProperties(Scene& scene) {
 
     ImGuiIO& io = ImGui::GetIO();
@@ -554,8 +788,25 @@ void UI::renderProperties(Scene& scene) {
         
 
         if (ImGui::CollapsingHeader("Model Info", ImGuiTreeNodeFlags_DefaultOpen)) {
-            ImGui::Text("Meshes: %zu", selectedModel->getMeshes().size());
+            ImGui::Text("Meshes: %zu unique, %zu instances", selectedModel->getMeshes().size(),
+                        selectedModel->getInstances().size());
             ImGui::Text("Materials: %zu", selectedModel->getMaterials().size());
+            if (selectedModel->getAssetShareCount() > 1) {
+                ImGui::Text("Geometry shared by %ld models", selectedModel->getAssetShareCount());
+            }
+            
+            if (m_renderer.supportsQuantizedVertices() && !m_quantizationBenchmark.active) {
+                bool quantize = selectedModel->getQuantizeVertices();
+                if (ImGui::Checkbox("Quantized vertices (16 B)", &quantize)) {
+                    m_pendingQuantization.emplace_back(selectedModel.get(), quantize);
+                }
+            }
+            
+            const auto& cacheReport = selectedModel->getVertexCacheReport();
+            if (cacheReport.acmrBefore > 0.0f) {
+                ImGui::Text("ACMR: %.3f -> %.3f", cacheReport.acmrBefore, cacheReport.acmrAfter);
+                ImGui::Text("ATVR: %.3f -> %.3f", cacheReport.atvrBefore, cacheReport.atvrAfter);
+            }
             
 
             const auto& meshes = selectedModel->getMeshes();
@@ -564,6 +815,23 @@ void UI::renderProperties(Scene& scene) {
                 ImGui::Indent();
                 ImGui::Text("  Vertices: %zu", meshes[i].vertices.size());
                 ImGui::Text("  Indices: %zu", meshes[i].indices.size());
+                if (!meshes[i].meshlets.empty()) {
+                    ImGui::Text("  Meshlets: %zu", meshes[i].meshlets.size());
+                }
+                if (!meshes[i].lods.empty()) {
+                    ImGui::Text("  LODs: %zu (coarsest %u triangles, error %.4g)", meshes[i].lods.size(),
+                                meshes[i].lods.back().indexCount / 3, meshes[i].lods.back().error);
+                }
+                
+                
+                // Before: vertices as imported with 32-bit indices; after: what the GPU actually holds
+                if (meshes[i].geometry) {
+                    double beforeKB = (meshes[i].sourceVertexCount * sizeof(Vertex) +
+                                       meshes[i].indices.size() * sizeof(uint32_t)) / 1024.0;
+                    double afterKB = (meshes[i].geometry->vertexBytes + meshes[i].geometry->indexBytes) / 1024.0;
+                    ImGui::Text("  GPU: %.1f KB -> %.1f KB (%s indices)", beforeKB, afterKB,
+                                meshes[i].geometry->indexSize == sizeof(uint16_t) ? "16-bit" : "32-bit");
+                }
                 ImGui::Unindent();
             }
         }
@@ -608,13 +876,50 @@ void UI::renderProperties(Scene& scene) {
         if (ImGui::CollapsingHeader("UV Controls (Advanced)")) {
             bool forceUVFlip = selectedModel->getForceUVFlip();
             if (ImGui::Checkbox("Force UV Flip Override", &forceUVFlip)) {
-                selectedModel->setForceUVFlip(forceUVFlip, m_device);
+                selectedModel->setForceUVFlip(forceUVFlip);
                 std::cout << "UV Flip override " << (forceUVFlip ? "ENABLED" : "DISABLED") 
                           << " for model: " << selectedModel->getName() << std::endl;
             }
             
             ImGui::TextWrapped("Advanced: Manual override for UV coordinates. The engine automatically detects and fixes UV mapping issues.");
             ImGui::TextWrapped("Only use this if automatic detection fails.");
+            
+            
+            // Pushed per draw, so edits show up on the next frame without touching the vertex buffers
+            const auto& materials = selectedModel->getMaterials();
+            for (size_t i = 0; i < materials.size(); i++) {
+                ImGui::PushID(static_cast<int>(i));
+                ImGui::Text("%s", materials[i].name.c_str());
+                UVTransform transform = materials[i].uvTransform;
+                bool changed = false;
+                if (ImGui::SmallButton("Flip U")) {
+                    transform = transform.flippedU();
+                    changed = true;
+                }
+                ImGui::SameLine();
+                if (ImGui::SmallButton("Flip V")) {
+                    transform = transform.flippedV();
+                    changed = true;
+                }
+                ImGui::SameLine();
+                changed |= ImGui::Checkbox("Swap UV", &transform.swap);
+                changed |= ImGui::DragFloat2("Scale", &transform.scale.x, 0.01f);
+                changed |= ImGui::DragFloat2("Offset", &transform.offset.x, 0.01f);
+                if (ImGui::SmallButton("Reset")) {
+                    transform = UVTransform();
+                    changed = true;
+                }
+                ImGui::SameLine();
+                // Adds a flip only when the mapping looks mirrored; the user's scale and offset stay
+                if (ImGui::SmallButton("Detect Orientation")) {
+                    transform = UVAnalyzer::orient(transform, selectedModel->detectBestUVVariant(i));
+                    changed = true;
+                }
+                if (changed) {
+                    selectedModel->setMaterialUVTransform(i, transform);
+                }
+                ImGui::PopID();
+            }
         }
         
 
@@ -629,7 +934,8 @@ void UI::renderProperties(Scene& scene) {
             }
             
             if (ImGui::Button("Remove from Scene", ImVec2(-1, 0))) {
-                scene.removeModel(m_selectedModelIndex);
+                m_device.waitIdle();
+                scene.removeModel(m_selectedModelIndex, m_device);
                 m_selectedModelIndex = -1;
                 m_transformInitialized = false;
             }
@@ -662,6 +968,161 @@ std::string UI::openTextureFileDialog() {
     return "";
 }
 
+void UI::processDeferredActions(Scene& scene) {
+    m_importJobs.update([this](std::unique_ptr<Model> model) { addLoadedModel(std::move(model)); });
+    
+    
+    // Vertex edits from every model and material go out in one batch, ordered after the frames in flight
+    UploadBatcher geometryUpdates(m_device);
+    for (const auto& model : scene.getModels()) {
+        model->flushDirtyVertices(m_device, geometryUpdates);
+    }
+    for (const auto& model : m_loadedModels) {
+        model->flushDirtyVertices(m_device, geometryUpdates);
+    }
+    if (!geometryUpdates.empty()) {
+        geometryUpdates.flush();
+    }
+    
+    // The frame recorded before this used the old blocks, so it has to finish before they are freed
+    if (m_pendingCompaction) {
+        m_pendingCompaction = false;
+        m_device.waitIdle();
+        m_renderer.getGeometryPool().compact();
+    }
+    
+    if (m_pendingQuantization.empty()) {
+        return;
+    }
+    
+    m_device.waitIdle();
+    const auto& models = scene.getModels();
+    for (const auto& [model, quantize] : m_pendingQuantization) {
+        
+        // The model may have been removed since the toggle was queued
+        bool alive = std::any_of(models.begin(), models.end(),
+                                 [model = model](const std::unique_ptr<Model>& m) { return m.get() == model; });
+        if (alive) {
+            model->setQuantizeVertices(quantize, m_device);
+        }
+    }
+    m_pendingQuantization.clear();
+}
+
+void UI::startQuantizationBenchmark(Scene& scene) {
+    const auto& models = scene.getModels();
+    if (models.empty()) {
+        std::cout << "Quantization benchmark: scene is empty" << std::endl;
+        return;
+    }
+    
+    m_quantizationBenchmark = QuantizationBenchmark{};
+    m_quantizationBenchmark.active = true;
+    for (const auto& model : models) {
+        m_quantizationBenchmark.originalSettings.emplace_back(model.get(), model->getQuantizeVertices());
+        m_pendingQuantization.emplace_back(model.get(), false);
+    }
+    m_quantizationBenchmark.frame = -QuantizationBenchmark::WARMUP_FRAMES;
+}
+
+void UI::updateQuantizationBenchmark(Scene& scene) {
+    auto& bench = m_quantizationBenchmark;
+    
+    if (bench.frame == 0) {
+        VkDeviceSize vertexBytes = 0;
+        for (const auto& model : scene.getModels()) {
+            for (const auto& mesh : model->getMeshes()) {
+                if (mesh.geometry) {
+                    vertexBytes += mesh.geometry->vertexBytes;
+                }
+            }
+        }
+        bench.vertexMB[bench.phase] = vertexBytes / (1024.0 * 1024.0);
+    }
+    
+    // GPU time of the model draws; frame time would only show the vsync interval. Timestamps come back
+    // a couple of frames late, which the warmup frames cover.
+    if (bench.frame >= 0) {
+        bench.gpuTimeMs[bench.phase] += m_renderer.getModelGpuMilliseconds();
+    }
+    if (++bench.frame < QuantizationBenchmark::MEASURE_FRAMES) {
+        return;
+    }
+    
+    bench.gpuTimeMs[bench.phase] /= QuantizationBenchmark::MEASURE_FRAMES;
+    if (bench.phase == 0) {
+        bench.phase = 1;
+        bench.frame = -QuantizationBenchmark::WARMUP_FRAMES;
+        for (const auto& model : scene.getModels()) {
+            m_pendingQuantization.emplace_back(model.get(), true);
+        }
+        return;
+    }
+    
+    std::cout << "Quantization benchmark (" << QuantizationBenchmark::MEASURE_FRAMES << " frames per mode, GPU time of the model draws):" << std::endl;
+    std::cout << "  Full precision: " << bench.vertexMB[0] << " MB vertex data, " << bench.gpuTimeMs[0] << " ms/frame" << std::endl;
+    std::cout << "  Quantized:      " << bench.vertexMB[1] << " MB vertex data, " << bench.gpuTimeMs[1] << " ms/frame" << std::endl;
+    
+    m_pendingQuantization.insert(m_pendingQuantization.end(), bench.originalSettings.begin(), bench.originalSettings.end());
+    bench.active = false;
+}
+
+void UI::startMeshletBenchmark(Scene& scene) {
+    if (scene.getModels().empty()) {
+        std::cout << "Meshlet culling benchmark: scene is empty" << std::endl;
+        return;
+    }
+    
+    
+    // LOD selection is switched off so every mode draws the same full-detail geometry
+    m_meshletBenchmark = MeshletBenchmark{};
+    m_meshletBenchmark.active = true;
+    m_meshletBenchmark.originalCulling = m_renderer.getMeshletCulling();
+    m_meshletBenchmark.originalLodErrorPixels = m_renderer.getLodErrorPixels();
+    m_renderer.setLodErrorPixels(0.0f);
+    m_renderer.setMeshletCulling(MeshletBenchmark::MODES[0]);
+    m_meshletBenchmark.frame = -MeshletBenchmark::WARMUP_FRAMES;
+}
+
+void UI::updateMeshletBenchmark() {
+    auto& bench = m_meshletBenchmark;
+    
+    if (bench.frame >= 0) {
+        // Model draw span on the GPU, from a few frames back; the warmup frames keep it within one mode
+        const RenderStats& stats = m_renderer.getRenderStats();
+        bench.gpuTimeMs[bench.phase] += m_renderer.getModelGpuMilliseconds();
+        bench.submittedTriangles[bench.phase] += static_cast<double>(stats.submittedTriangles);
+        bench.culledTriangles[bench.phase] += static_cast<double>(stats.culledTriangles);
+        bench.drawCalls[bench.phase] += stats.drawCalls;
+    }
+    if (++bench.frame < MeshletBenchmark::MEASURE_FRAMES) {
+        return;
+    }
+    
+    bench.gpuTimeMs[bench.phase] /= MeshletBenchmark::MEASURE_FRAMES;
+    bench.submittedTriangles[bench.phase] /= MeshletBenchmark::MEASURE_FRAMES;
+    bench.culledTriangles[bench.phase] /= MeshletBenchmark::MEASURE_FRAMES;
+    bench.drawCalls[bench.phase] /= MeshletBenchmark::MEASURE_FRAMES;
+    if (++bench.phase < MeshletBenchmark::MODE_COUNT) {
+        bench.frame = -MeshletBenchmark::WARMUP_FRAMES;
+        m_renderer.setMeshletCulling(MeshletBenchmark::MODES[bench.phase]);
+        return;
+    }
+    
+    std::cout << "Meshlet culling benchmark (" << MeshletBenchmark::MEASURE_FRAMES
+              << " frames per mode at the current camera, GPU time of the model draws):" << std::endl;
+    for (int mode = 0; mode < MeshletBenchmark::MODE_COUNT; mode++) {
+        std::cout << "  " << meshletCullingName(MeshletBenchmark::MODES[mode]) << ": "
+                  << static_cast<uint64_t>(bench.submittedTriangles[mode]) << " triangles drawn, "
+                  << static_cast<uint64_t>(bench.culledTriangles[mode]) << " culled, "
+                  << bench.drawCalls[mode] << " draws, " << bench.gpuTimeMs[mode] << " ms GPU" << std::endl;
+    }
+    
+    m_renderer.setMeshletCulling(bench.originalCulling);
+    m_renderer.setLodErrorPixels(bench.originalLodErrorPixels);
+    bench.active = false;
+}
+
 void UI::loadTextureForMesh(Model* model, size_t meshIndex, const std::string& textureType) {
     std::string filepath = openTextureFileDialog();
     if (!filepath.empty()) {
@@ -671,6 +1132,8 @@ void UI::loadTextureForMesh(Model* model, size_t meshIndex, const std::string& t
 
         auto& materials = model->getMaterials();
         if (meshIndex < materials.size()) {
+            // The material's previous image is released, and may still be in use by a frame in flight
+            m_device.waitIdle();
             if (model->loadTextureToGPU(materials[meshIndex], filepath, m_device)) {
                 std::cout << "Successfully loaded " << textureType << " texture to GPU for material " << meshIndex << std::endl;
                 
@@ -722,9 +1185,6 @@ void UI::renderSceneViewport(Scene& scene) {
             std::cout << "Received drop payload, index: " << sourceIndex << ", loaded models count: " << m_loadedModels.size() << std::endl;
             
             if (sourceIndex < m_loadedModels.size()) {
-                // Wait for any pending rendering to complete before modifying descriptor sets
-                m_device.waitIdle();
-
                 auto newModel = std::make_unique<Model>();
                 std::cout << "Attempting to copy model: " << m_loadedModels[sourceIndex]->getName() << std::endl;
                 if (newModel->copyFrom(*m_loadedModels[sourceIndex], m_device)) {
@@ -3,14 +3,18 @@
 #include <vulkan/vulkan.h>
 #include <string>
 #include <memory>
+#include <vector>
+#include <utility>
 #include <glm/glm.hpp>
 
+#include "../rendering/Renderer.hpp"
+#include "../assets/ImportJobs.hpp"
+
 struct GLFWwindow;
 
 namespace VulkanViewer {
 
 class VulkanDevice;
-class Renderer;
 class Scene;
 class Model;
 
@@ -21,8 +25,13 @@ public:
 
     void render(Scene& scene);
     
+    // Applies changes that re-upload geometry and advances background imports; call before the frame starts recording
+    void processDeferredActions(Scene& scene);
+    
     int getSelectedModelIndex() const { return m_selectedModelIndex; }
     void addLoadedModel(std::unique_ptr<Model> model);
+    // Imports in the background; the model shows up in the asset browser once it is on the GPU
+    void importModel(const std::string& filepath);
 
 private:
     void initImGui();
@@ -32,15 +41,23 @@ private:
     void renderSceneHierarchy(Scene& scene);
     void renderStatistics();
     void renderAssetBrowser(Scene& scene);
+    void renderImportJobs();
     void renderProperties(Scene& scene);
     void renderSceneViewport(Scene& scene);
     
     std::string openFileDialog();
     void openFileDialog(Scene& scene);
+    void renderImportOptions();
     void loadModelToAssetBrowser();
     
     std::string openTextureFileDialog();
     void loadTextureForMesh(class Model* model, size_t meshIndex, const std::string& textureType);
+    
+    void startQuantizationBenchmark(Scene& scene);
+    void updateQuantizationBenchmark(Scene& scene);
+    
+    void startMeshletBenchmark(Scene& scene);
+    void updateMeshletBenchmark();
 
     VulkanDevice& m_device;
     GLFWwindow* m_window;
@@ -49,8 +66,11 @@ private:
     VkDescriptorPool m_descriptorPool;
     
     float m_frameRate = 0.0f;
-    int m_triangleCount = 0;
-    int m_drawCalls = 0;
+
+    // Staging ring throughput, sampled about once a second
+    uint64_t m_stagingSampleBytes = 0;
+    double m_stagingSampleTime = 0.0;
+    float m_stagingThroughput = 0.0f;
     
 
     int m_selectedModelIndex = -1;
@@ -63,6 +83,47 @@ private:
     
 
     std::vector<std::unique_ptr<Model>> m_loadedModels;
+    ImportJobQueue m_importJobs;
+    // Applied to every import started from the UI, edited in the asset browser's Options popup
+    ImportOptions m_importOptions;
+    
+    
+    // Quantization toggles queued from the UI, applied by processDeferredActions
+    std::vector<std::pair<Model*, bool>> m_pendingQuantization;
+    // Set by the Compact Geometry button; compaction moves meshes, so it waits for the next frame
+    bool m_pendingCompaction = false;
+    
+    struct QuantizationBenchmark {
+        static constexpr int WARMUP_FRAMES = 30;
+        static constexpr int MEASURE_FRAMES = 120;
+        
+        bool active = false;
+        int phase = 0;
+        int frame = 0;
+        double gpuTimeMs[2] = {0.0, 0.0};
+        double vertexMB[2] = {0.0, 0.0};
+        std::vector<std::pair<Model*, bool>> originalSettings;
+    };
+    QuantizationBenchmark m_quantizationBenchmark;
+    
+    struct MeshletBenchmark {
+        static constexpr int WARMUP_FRAMES = 30;
+        static constexpr int MEASURE_FRAMES = 120;
+        static constexpr int MODE_COUNT = 3;
+        static constexpr MeshletCulling MODES[MODE_COUNT] = {
+            MeshletCulling::Off, MeshletCulling::Frustum, MeshletCulling::FrustumAndCone};
+        
+        bool active = false;
+        int phase = 0;
+        int frame = 0;
+        double gpuTimeMs[MODE_COUNT] = {};
+        double submittedTriangles[MODE_COUNT] = {};
+        double culledTriangles[MODE_COUNT] = {};
+        double drawCalls[MODE_COUNT] = {};
+        MeshletCulling originalCulling = MeshletCulling::Frustum;
+        float originalLodErrorPixels = 1.0f;
+    };
+    MeshletBenchmark m_meshletBenchmark;
 };
 
 }
\ No newline at end of file